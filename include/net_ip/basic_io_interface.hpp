@@ -20,12 +20,20 @@
 #include <string_view>
 #include <system_error>
 #include <cstddef> // std::size_t, std::byte
+#include <cstdint> // std::uint64_t
 #include <utility> // std::forward, std::move
+#include <chrono>
+#include <array>
+#include <functional> // std::less
+#include <type_traits> // std::is_convertible_v
+
+#include "asio/io_context.hpp"
 
 #include "utility/shared_buffer.hpp"
 
 #include "net_ip/net_ip_error.hpp"
 #include "net_ip/queue_stats.hpp"
+#include "net_ip/intrusive_buffer.hpp"
 
 namespace chops {
 namespace net {
@@ -45,6 +53,9 @@ namespace net {
  *  accessing the same network IO handler. Internally, a @c std::weak pointer is used 
  *  to link the @c basic_io_interface object with a network IO handler.
  *
+ *  The @c basic_io_interface passed to a message handler refers directly to the IO 
+ *  handler for the duration of the call; copies of it hold a @c std::weak_ptr.
+ *
  *  An @c basic_io_interface object is provided for application use through a state change 
  *  function object callback. This occurs when a @c net_entity creates the underlying 
  *  network IO handler, or the network IO handler is being closed and destructed. 
@@ -78,6 +89,54 @@ template <typename IOT>
 class basic_io_interface {
 private:
   std::weak_ptr<IOT> m_ioh_wptr;
+  IOT*               m_ioh_borrowed = nullptr; // see the IO handler reference constructor
+
+  // holds a std::shared_ptr only when the weak pointer was locked
+  class ioh_ref {
+  private:
+    std::shared_ptr<IOT> m_sp;
+    IOT*                 m_p;
+
+  public:
+    explicit ioh_ref(IOT* p) noexcept : m_sp(), m_p(p) { }
+    explicit ioh_ref(std::shared_ptr<IOT> sp) noexcept : m_sp(std::move(sp)), m_p(m_sp.get()) { }
+
+    explicit operator bool() const noexcept { return m_p != nullptr; }
+    IOT* operator->() const noexcept { return m_p; }
+    IOT* get() const noexcept { return m_p; }
+  };
+
+  ioh_ref lock() const noexcept {
+    return m_ioh_borrowed ? ioh_ref(m_ioh_borrowed) : ioh_ref(m_ioh_wptr.lock());
+  }
+
+  // a copy never borrows, since it may outlive the handler call
+  std::weak_ptr<IOT> get_weak_ptr() const noexcept {
+    if (!m_ioh_borrowed) {
+      return m_ioh_wptr;
+    }
+    if constexpr (std::is_convertible_v<decltype(m_ioh_borrowed->weak_from_this()), 
+                                        std::weak_ptr<IOT> >) {
+      return m_ioh_borrowed->weak_from_this();
+    }
+    else { // the handler derives from a class that is shared from this (e.g. a test mock)
+      return std::weak_ptr<IOT>(std::static_pointer_cast<IOT>(m_ioh_borrowed->shared_from_this()));
+    }
+  }
+
+  static expected<void> no_io_handler() {
+    return nonstd::make_unexpected(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+  // every try_send overload forwards to the IO handler send with the same arguments
+  template <typename... Args>
+  expected<void> try_send_impl(Args&&... args) const {
+    if (auto p = lock()) {
+      p->send(std::forward<Args>(args)...);
+      return { };
+    }
+    return no_io_handler();
+  }
 
 public:
   using endpoint_type = typename IOT::endpoint_type;
@@ -93,11 +152,27 @@ public:
  */
   basic_io_interface() = default;
 
-  basic_io_interface(const basic_io_interface&) = default;
-  basic_io_interface(basic_io_interface&&) = default;
+/**
+ *  @brief Copy (or move) construct an @c basic_io_interface.
+ *
+ *  The copy always refers to the IO handler through a @c std::weak_ptr, even if the
+ *  source was passed to a message handler (see the IO handler reference constructor),
+ *  so copies can be kept and used after the message handler returns.
+ */
+  basic_io_interface(const basic_io_interface& rhs) noexcept : m_ioh_wptr(rhs.get_weak_ptr()) { }
+  basic_io_interface(basic_io_interface&& rhs) noexcept : 
+    m_ioh_wptr(rhs.m_ioh_borrowed ? rhs.get_weak_ptr() : std::move(rhs.m_ioh_wptr)) { }
 
-  basic_io_interface<IOT>& operator=(const basic_io_interface&) = default;
-  basic_io_interface<IOT>& operator=(basic_io_interface&&) = default;
+  basic_io_interface<IOT>& operator=(const basic_io_interface& rhs) noexcept {
+    m_ioh_wptr = rhs.get_weak_ptr();
+    m_ioh_borrowed = nullptr;
+    return *this;
+  }
+  basic_io_interface<IOT>& operator=(basic_io_interface&& rhs) noexcept {
+    m_ioh_wptr = rhs.m_ioh_borrowed ? rhs.get_weak_ptr() : std::move(rhs.m_ioh_wptr);
+    m_ioh_borrowed = nullptr;
+    return *this;
+  }
   
 /**
  *  @brief Construct with a shared weak pointer to an internal IO handler, this is an
@@ -106,6 +181,15 @@ public:
  */
   explicit basic_io_interface(std::weak_ptr<IOT> p) noexcept : m_ioh_wptr(p) { }
 
+/**
+ *  @brief Construct with a reference to an internal IO handler, this is an internal
+ *  constructor only and not to be used by application code.
+ *
+ *  The IO handler is borrowed for the duration of a message handler call. Copies of the
+ *  object hold a @c std::weak_ptr.
+ */
+  explicit basic_io_interface(IOT& ioh) noexcept : m_ioh_wptr(), m_ioh_borrowed(&ioh) { }
+
 /**
  *  @brief Query whether an IO handler is associated with this object.
  *
@@ -114,7 +198,7 @@ public:
  *
  *  @return @c true if associated with an IO handler.
  */
-  bool is_valid() const noexcept { return !m_ioh_wptr.expired(); }
+  bool is_valid() const noexcept { return m_ioh_borrowed || !m_ioh_wptr.expired(); }
 
 /**
  *  @brief Query whether @c start_io on an IO handler has been called or not.
@@ -124,7 +208,7 @@ public:
  *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
  */
   bool is_io_started() const {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->is_io_started();
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
@@ -139,7 +223,7 @@ public:
  *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
  */
   typename IOT::socket_type& get_socket() const {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->get_socket();
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
@@ -154,12 +238,89 @@ public:
  *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
  */
   output_queue_stats get_output_queue_stats() const {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->get_output_queue_stats();
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
   }
 
+/**
+ *  @brief Return input statistics, such as message and byte totals, allowing 
+ *  applications to find the busiest connections.
+ *
+ *  @return @c input_stats if network IO handler is available.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  input_stats get_input_stats() const {
+    if (auto p = lock()) {
+      return p->get_input_stats();
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Set a per-turn read budget, so that one busy connection cannot monopolize
+ *  the @c io_context.
+ *
+ *  After @c max_msgs messages or @c max_bytes bytes have been delivered, the next read
+ *  is posted instead of started. Yields are counted in @c input_stats.
+ *
+ *  @param max_msgs Number of messages per turn, zero for no message limit.
+ *
+ *  @param max_bytes Number of bytes per turn, zero for no byte limit. Zero for both
+ *  (the default) disables the read budget.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void set_read_budget(std::size_t max_msgs, std::size_t max_bytes = 0) const {
+    if (auto p = lock()) {
+      p->set_read_budget(max_msgs, max_bytes);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Move the connection to another @c io_context, implemented only for TCP IO 
+ *  handlers.
+ *
+ *  Reads and writes resume where they left off, without losing or reordering data. The
+ *  migration is asynchronous and is ignored if one is already in progress. If the socket
+ *  cannot be moved the connection stays where it is.
+ *
+ *  @param ioc The @c io_context to move to, which must outlive the connection.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void migrate_to(asio::io_context& ioc) const {
+    if (auto p = lock()) {
+      p->migrate_to(ioc);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Set a maximum age for buffers waiting in the output queue.
+ *
+ *  A buffer older than the maximum age (measured from the @c send call) when it reaches
+ *  the front of the output queue is discarded and counted in @c output_queue_stats. 
+ *  Applies to subsequent @c send calls without their own maximum age.
+ *
+ *  @param max_age Maximum time a buffer can wait in the output queue, zero (the 
+ *  default) disables expiry.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void set_output_max_age(std::chrono::steady_clock::duration max_age) const {
+    if (auto p = lock()) {
+      p->set_output_max_age(max_age);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
 /**
  *  @brief Send a buffer of data through the associated network IO handler.
  *
@@ -184,7 +345,7 @@ public:
  *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
  */
   void send(chops::const_shared_buffer buf) const {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       p->send(buf);
       return;
     }
@@ -215,6 +376,268 @@ public:
     send(chops::const_shared_buffer(std::move(buf)));
   }
 
+/**
+ *  @brief Send an @c intrusive_buffer through the associated network IO handler.
+ *
+ *  A buffer created with @c refcount_mode::single_thread must only be sent from the 
+ *  thread that runs the IO handler. This is a non-blocking call.
+ *
+ *  @param buf @c intrusive_buffer containing data.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(intrusive_buffer buf) const {
+    if (auto p = lock()) {
+      p->send(std::move(buf));
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a reference counted buffer through the associated network IO handler,
+ *  discarding it if it waits in the output queue longer than the maximum age.
+ *
+ *  The maximum age overrides @c set_output_max_age for this buffer. This is a 
+ *  non-blocking call.
+ *
+ *  @param buf @c chops::const_shared_buffer containing data.
+ *
+ *  @param max_age Maximum time the buffer can wait in the output queue.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(chops::const_shared_buffer buf, std::chrono::steady_clock::duration max_age) const {
+    if (auto p = lock()) {
+      p->send(buf, max_age);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Set a function object that is called each time a write completes, e.g. for
+ *  credit based flow control.
+ *
+ *  The function object is called within the IO handler with the number of buffers and
+ *  bytes handed to the operating system, once per write. Its signature is:
+ *
+ *  @code
+ *    void (std::size_t num_bufs, std::size_t num_bytes);
+ *  @endcode
+ *
+ *  @param cb Function object for write completions, an empty function object 
+ *  disables notification.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  template <typename F>
+  void set_write_completion_handler(F&& cb) const {
+    if (auto p = lock()) {
+      p->set_write_completion_handler(std::forward<F>(cb));
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Set an output coalescing window, implemented only for TCP IO handlers.
+ *
+ *  The first buffer sent on an idle connection is held for up to @c max_delay (or until
+ *  @c byte_threshold bytes are waiting), and buffers sent in the meantime are written
+ *  with it in one gathered write. Windows and added delay are counted in 
+ *  @c output_queue_stats.
+ *
+ *  @param max_delay Maximum time the first buffer is held, zero (the default) disables
+ *  coalescing.
+ *
+ *  @param byte_threshold If non-zero, the window is closed early when this many bytes 
+ *  are waiting.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void set_output_coalescing(std::chrono::steady_clock::duration max_delay, 
+                             std::size_t byte_threshold = 0) const {
+    if (auto p = lock()) {
+      p->set_output_coalescing(max_delay, byte_threshold);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Enable or disable speculative writes, implemented only for TCP IO handlers.
+ *
+ *  Each write is first attempted inline with a non-blocking write, and an asynchronous 
+ *  write is only started for what the socket send buffer cannot take. Attempts are 
+ *  counted in @c output_queue_stats.
+ *
+ *  @param enable @c true to attempt writes inline, @c false (the default) to always
+ *  use asynchronous writes.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void set_speculative_write(bool enable) const {
+    if (auto p = lock()) {
+      p->set_speculative_write(enable);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Enable speculative reads with a per-turn budget, implemented only for TCP IO 
+ *  handlers.
+ *
+ *  Each time an asynchronous read completes, up to @c budget further reads are attempted
+ *  inline with a non-blocking read before going back through the event loop.
+ *
+ *  @param budget Number of inline reads per asynchronous read completion, zero (the
+ *  default) disables speculative reads.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void set_speculative_read(std::size_t budget) const {
+    if (auto p = lock()) {
+      p->set_speculative_read(budget);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Set the weight of a priority lane of the output queue.
+ *
+ *  There are @c max_output_lanes lanes, lane 0 the highest priority. A non-zero weight is
+ *  the number of consecutive buffers written from the lane before a lower lane gets one.
+ *
+ *  @param lane Priority lane, 0 is highest.
+ *
+ *  @param weight Zero for strict priority (the default), otherwise the number of 
+ *  consecutive buffers before a lower lane gets a turn.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void set_output_lane_weight(std::size_t lane, std::size_t weight) const {
+    if (auto p = lock()) {
+      p->set_output_lane_weight(lane, weight);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a reference counted buffer on a priority lane of the output queue.
+ *
+ *  Buffers sent without a lane use lane 0, and a lane number past the maximum is the 
+ *  lowest priority lane. This is a non-blocking call.
+ *
+ *  @param buf @c chops::const_shared_buffer containing data.
+ *
+ *  @param lane Priority lane, 0 is highest.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(chops::const_shared_buffer buf, std::size_t lane) const {
+    if (auto p = lock()) {
+      p->send(buf, lane);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a reference counted buffer with a conflation key through the associated 
+ *  network IO handler.
+ *
+ *  A buffer with the same key still waiting in the output queue is replaced by this one,
+ *  keeping its queue position. Replacements are counted in @c output_queue_stats. This 
+ *  is a non-blocking call.
+ *
+ *  @param key Application defined conflation key.
+ *
+ *  @param buf @c chops::const_shared_buffer containing data.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(std::uint64_t key, chops::const_shared_buffer buf) const {
+    if (auto p = lock()) {
+      p->send(key, buf);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a reference counted buffer with a conflation key on a priority lane of
+ *  the output queue.
+ *
+ *  Conflation applies within a lane, see documentation for @c send with a conflation 
+ *  key and @c send with a lane. This is a non-blocking call.
+ *
+ *  @param key Application defined conflation key.
+ *
+ *  @param buf @c chops::const_shared_buffer containing data.
+ *
+ *  @param lane Priority lane, 0 is highest.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(std::uint64_t key, chops::const_shared_buffer buf, std::size_t lane) const {
+    if (auto p = lock()) {
+      p->send(key, buf, lane);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a multi-part message (e.g. a header and a body) through the associated 
+ *  network IO handler, implemented only for TCP IO handlers.
+ *
+ *  The parts are queued as one unit and written with a single gathered write. This is a
+ *  non-blocking call.
+ *
+ *  @code
+ *    std::array<chops::const_shared_buffer, 2> msg { hdr_buf, body_buf };
+ *    an_io_interface.send(msg);
+ *  @endcode
+ *
+ *  @param parts @c std::array of @c chops::const_shared_buffer objects, 1 to 64 parts.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  template <std::size_t N>
+  void send(const std::array<chops::const_shared_buffer, N>& parts) const {
+    if (auto p = lock()) {
+      p->send(parts);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a multi-part message on a priority lane of the output queue, implemented 
+ *  only for TCP IO handlers.
+ *
+ *  See documentation for @c send with multiple parts and @c send with a lane. This is a 
+ *  non-blocking call.
+ *
+ *  @param parts @c std::array of @c chops::const_shared_buffer objects, 1 to 64 parts.
+ *
+ *  @param lane Priority lane, 0 is highest.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  template <std::size_t N>
+  void send(const std::array<chops::const_shared_buffer, N>& parts, std::size_t lane) const {
+    if (auto p = lock()) {
+      p->send(parts, lane);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
 /**
  *  @brief Send a buffer to a specific destination endpoint (address and port), implemented
  *  only for UDP IO handlers.
@@ -249,13 +672,81 @@ public:
  *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
  */
   void send(chops::const_shared_buffer buf, const endpoint_type& endp) const {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       p->send(buf, endp);
       return;
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
   }
 
+/**
+ *  @brief Send a reference counted buffer to a specific destination endpoint, discarding 
+ *  it if it waits in the output queue longer than the maximum age, implemented only for 
+ *  UDP IO handlers.
+ *
+ *  This is a non-blocking call.
+ *
+ *  @param buf @c chops::const_shared_buffer containing data.
+ *
+ *  @param endp Destination @c asio::ip::udp::endpoint for the buffer.
+ *
+ *  @param max_age Maximum time the buffer can wait in the output queue.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(chops::const_shared_buffer buf, const endpoint_type& endp,
+            std::chrono::steady_clock::duration max_age) const {
+    if (auto p = lock()) {
+      p->send(buf, endp, max_age);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a reference counted buffer to a specific destination endpoint on a 
+ *  priority lane of the output queue, implemented only for UDP IO handlers.
+ *
+ *  See documentation for @c send with a lane. This is a non-blocking call.
+ *
+ *  @param buf @c chops::const_shared_buffer containing data.
+ *
+ *  @param endp Destination @c asio::ip::udp::endpoint for the buffer.
+ *
+ *  @param lane Priority lane, 0 is highest.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(chops::const_shared_buffer buf, const endpoint_type& endp, std::size_t lane) const {
+    if (auto p = lock()) {
+      p->send(buf, endp, lane);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Send a reference counted buffer with a conflation key to a specific destination
+ *  endpoint, implemented only for UDP IO handlers.
+ *
+ *  See documentation for @c send with a conflation key. This is a non-blocking call.
+ *
+ *  @param key Application defined conflation key.
+ *
+ *  @param buf @c chops::const_shared_buffer containing data.
+ *
+ *  @param endp Destination @c asio::ip::udp::endpoint for the buffer.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(std::uint64_t key, chops::const_shared_buffer buf, const endpoint_type& endp) const {
+    if (auto p = lock()) {
+      p->send(key, buf, endp);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
 /**
  *  @brief Move a reference counted buffer and send it through the associated network
  *  IO handler, implemented only for UDP IO handlers.
@@ -273,6 +764,26 @@ public:
     send(chops::const_shared_buffer(std::move(buf)), endp);
   }
 
+/**
+ *  @brief Send an @c intrusive_buffer to a specific destination endpoint, implemented
+ *  only for UDP IO handlers.
+ *
+ *  See documentation for @c send with an @c intrusive_buffer. This is a non-blocking call.
+ *
+ *  @param buf @c intrusive_buffer containing data.
+ *
+ *  @param endp Destination @c asio::ip::udp::endpoint for the buffer.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  void send(intrusive_buffer buf, const endpoint_type& endp) const {
+    if (auto p = lock()) {
+      p->send(std::move(buf), endp);
+      return;
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
 
 /**
  *  @brief Enable IO processing for the associated network IO handler with message 
@@ -344,7 +855,7 @@ public:
  */
   template <typename MH, typename MF>
   bool start_io(std::size_t header_size, MH&& msg_handler, MF&& msg_frame) {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->start_io(header_size, std::forward<MH>(msg_handler), std::forward<MF>(msg_frame));
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
@@ -390,7 +901,7 @@ public:
  */
   template <typename MH>
   bool start_io(std::string_view delimiter, MH&& msg_handler) {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->start_io(delimiter, std::forward<MH>(msg_handler));
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
@@ -441,7 +952,7 @@ public:
 
   template <typename MH>
   bool start_io(std::size_t read_size, MH&& msg_handler) {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->start_io(read_size, std::forward<MH>(msg_handler));
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
@@ -488,7 +999,7 @@ public:
 
   template <typename MH>
   bool start_io(const endpoint_type& endp, std::size_t max_size, MH&& msg_handler) {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->start_io(endp, max_size, std::forward<MH>(msg_handler));
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
@@ -513,7 +1024,7 @@ public:
  */
 
   bool start_io() {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->start_io();
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
@@ -538,11 +1049,117 @@ public:
  */
 
   bool start_io(const endpoint_type& endp) {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->start_io(endp);
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
   }
+
+/**
+ *  @brief Enable IO processing with message frame logic, delivering messages to the
+ *  handler in batches.
+ *
+ *  This method is not implemented for UDP IO handlers.
+ *
+ *  This is the same as the corresponding @c start_io method, except that the TCP IO 
+ *  handler reads as much as is available (up to an internal buffer size) and invokes
+ *  the batch handler once with every complete message framed from that read. The 
+ *  message frame function object is called on each header and body in the same 
+ *  sequence as the non-batch @c start_io method.
+ *
+ *  @param header_size The initial read size (in bytes) of each incoming message, which
+ *  must be non-zero.
+ *
+ *  @param batch_handler A batch handler function object callback. The signature of
+ *  the callback is:
+ *
+ *  @code
+ *    bool (const std::vector<asio::const_buffer>&,
+ *          chops::net::tcp_io_interface, // basic_io_interface<tcp_io>
+ *          asio::ip::tcp::endpoint);
+ *  @endcode
+ *
+ *  Each buffer references a full message, in the order received. The buffers are only
+ *  valid for the duration of the callback. Returning @c false causes the connection to 
+ *  be closed.
+ *
+ *  @param msg_frame A message frame function object callback, as in @c start_io.
+ *
+ *  @return @c false if already started or the header size is zero, otherwise @c true.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  template <typename MH, typename MF>
+  bool start_io_batch(std::size_t header_size, MH&& batch_handler, MF&& msg_frame) {
+    if (auto p = lock()) {
+      return p->start_io_batch(header_size, std::forward<MH>(batch_handler), 
+                               std::forward<MF>(msg_frame));
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Enable IO processing with delimiter logic, delivering messages to the
+ *  handler in batches.
+ *
+ *  This method is not implemented for UDP IO handlers.
+ *
+ *  The batch handler is invoked once with every delimited message from one read. The
+ *  batch handler signature is the same as the message frame @c start_io_batch method, 
+ *  and each buffer includes the delimiter bytes.
+ *
+ *  @param delimiter Delimiter characters, as in the corresponding @c start_io method.
+ *
+ *  @param batch_handler A batch handler function object callback.
+ *
+ *  @return @c false if already started or the delimiter is empty, otherwise @c true.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  template <typename MH>
+  bool start_io_batch(std::string_view delimiter, MH&& batch_handler) {
+    if (auto p = lock()) {
+      return p->start_io_batch(delimiter, std::forward<MH>(batch_handler));
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Enable IO processing with a maximum datagram size, delivering datagrams to 
+ *  the handler in batches.
+ *
+ *  This method is not implemented for TCP IO handlers (only for UDP IO handlers).
+ *
+ *  When a datagram arrives, any other datagrams already waiting on the socket are
+ *  received as well (up to an internal limit), and the batch handler is invoked once 
+ *  for all of them.
+ *
+ *  @param max_size Maximum UDP datagram size.
+ *
+ *  @param batch_handler A batch handler function object callback. The signature of
+ *  the callback is:
+ *
+ *  @code
+ *    bool (const std::vector<asio::const_buffer>&,
+ *          chops::net::udp_io_interface, // basic_io_interface<udp_entity_io>
+ *          const std::vector<asio::ip::udp::endpoint>&);
+ *  @endcode
+ *
+ *  The endpoints correspond by index to the buffers, each being the sender of that
+ *  datagram. The buffers are only valid for the duration of the callback. Returning 
+ *  @c false causes the UDP entity to be stopped.
+ *
+ *  @return @c false if already started, otherwise @c true.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
+ */
+  template <typename MH>
+  bool start_io_batch(std::size_t max_size, MH&& batch_handler) {
+    if (auto p = lock()) {
+      return p->start_io_batch(max_size, std::forward<MH>(batch_handler));
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
  
 /**
  *  @brief Stop IO processing and close the associated network IO handler.
@@ -557,12 +1174,138 @@ public:
  *  @throw A @c net_ip_exception is thrown if there is not an associated IO handler.
  */
   bool stop_io() {
-    if (auto p = m_ioh_wptr.lock()) {
+    if (auto p = lock()) {
       return p->stop_io();
     }
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
   }
 
+/**
+ *  @brief Non-throwing versions of the @c send methods.
+ *
+ *  Each @c try_send method takes the same parameters as the corresponding @c send 
+ *  method, but returns an error instead of throwing when there is not an associated IO
+ *  handler.
+ *
+ *  @return An @c expected with no value on success, otherwise the 
+ *  @c net_ip_errc::weak_ptr_expired error code.
+ */
+  expected<void> try_send(const void* buf, std::size_t sz) const {
+    return try_send_impl(chops::const_shared_buffer(buf, sz));
+  }
+
+  expected<void> try_send(chops::const_shared_buffer buf) const {
+    return try_send_impl(buf);
+  }
+
+  expected<void> try_send(chops::mutable_shared_buffer&& buf) const { 
+    return try_send_impl(chops::const_shared_buffer(std::move(buf)));
+  }
+
+  expected<void> try_send(intrusive_buffer buf) const {
+    return try_send_impl(std::move(buf));
+  }
+
+  expected<void> try_send(chops::const_shared_buffer buf, 
+                          std::chrono::steady_clock::duration max_age) const {
+    return try_send_impl(buf, max_age);
+  }
+
+  expected<void> try_send(chops::const_shared_buffer buf, std::size_t lane) const {
+    return try_send_impl(buf, lane);
+  }
+
+  expected<void> try_send(std::uint64_t key, chops::const_shared_buffer buf) const {
+    return try_send_impl(key, buf);
+  }
+
+  expected<void> try_send(std::uint64_t key, chops::const_shared_buffer buf, 
+                          std::size_t lane) const {
+    return try_send_impl(key, buf, lane);
+  }
+
+  template <std::size_t N>
+  expected<void> try_send(const std::array<chops::const_shared_buffer, N>& parts) const {
+    return try_send_impl(parts);
+  }
+
+  template <std::size_t N>
+  expected<void> try_send(const std::array<chops::const_shared_buffer, N>& parts, 
+                          std::size_t lane) const {
+    return try_send_impl(parts, lane);
+  }
+
+  expected<void> try_send(const void* buf, std::size_t sz, const endpoint_type& endp) const {
+    return try_send_impl(chops::const_shared_buffer(buf, sz), endp);
+  }
+
+  expected<void> try_send(chops::const_shared_buffer buf, const endpoint_type& endp) const {
+    return try_send_impl(buf, endp);
+  }
+
+  expected<void> try_send(chops::const_shared_buffer buf, const endpoint_type& endp,
+                          std::chrono::steady_clock::duration max_age) const {
+    return try_send_impl(buf, endp, max_age);
+  }
+
+  expected<void> try_send(chops::const_shared_buffer buf, const endpoint_type& endp, 
+                          std::size_t lane) const {
+    return try_send_impl(buf, endp, lane);
+  }
+
+  expected<void> try_send(std::uint64_t key, chops::const_shared_buffer buf, 
+                          const endpoint_type& endp) const {
+    return try_send_impl(key, buf, endp);
+  }
+
+  expected<void> try_send(chops::mutable_shared_buffer&& buf, const endpoint_type& endp) const { 
+    return try_send_impl(chops::const_shared_buffer(std::move(buf)), endp);
+  }
+
+  expected<void> try_send(intrusive_buffer buf, const endpoint_type& endp) const {
+    return try_send_impl(std::move(buf), endp);
+  }
+
+/**
+ *  @brief Non-throwing version of the @c start_io methods.
+ *
+ *  The parameters are the same as for the corresponding @c start_io method, and are
+ *  forwarded to it.
+ *
+ *  @return An @c expected with no value on success, otherwise the 
+ *  @c net_ip_errc::io_already_started error code if @c start_io has already been called,
+ *  or the @c net_ip_errc::weak_ptr_expired error code if there is not an associated IO
+ *  handler.
+ */
+  template <typename... Args>
+  expected<void> try_start_io(Args&&... args) {
+    if (auto p = lock()) {
+      if (p->start_io(std::forward<Args>(args)...)) {
+        return { };
+      }
+      return nonstd::make_unexpected(std::make_error_code(net_ip_errc::io_already_started));
+    }
+    return no_io_handler();
+  }
+
+/**
+ *  @brief Non-throwing version of @c stop_io.
+ *
+ *  @return An @c expected with no value on success, otherwise the 
+ *  @c net_ip_errc::io_not_started error code if IO is already stopped (or was never 
+ *  started), or the @c net_ip_errc::weak_ptr_expired error code if there is not an 
+ *  associated IO handler.
+ */
+  expected<void> try_stop_io() {
+    if (auto p = lock()) {
+      if (p->stop_io()) {
+        return { };
+      }
+      return nonstd::make_unexpected(std::make_error_code(net_ip_errc::io_not_started));
+    }
+    return no_io_handler();
+  }
+
 
 /**
  *  @brief Compare two @c basic_io_interface objects for equality.
@@ -576,9 +1319,9 @@ public:
  */
 
   bool operator==(const basic_io_interface<IOT>& rhs) const noexcept {
-    auto lp = m_ioh_wptr.lock();
-    auto rp = rhs.m_ioh_wptr.lock();
-    return (lp && rp && lp == rp) || (!lp && !rp);
+    auto lp = lock();
+    auto rp = rhs.lock();
+    return (lp && rp && lp.get() == rp.get()) || (!lp && !rp);
   }
 
 /**
@@ -595,9 +1338,9 @@ public:
  *  @return As described in the comments.
  */
   bool operator<(const basic_io_interface<IOT>& rhs) const noexcept {
-    auto lp = m_ioh_wptr.lock();
-    auto rp = rhs.m_ioh_wptr.lock();
-    return (lp && rp && lp < rp) || (!lp && rp);
+    auto lp = lock();
+    auto rp = rhs.lock();
+    return (lp && rp && std::less<IOT*>()(lp.get(), rp.get())) || (!lp && rp);
   }
 
 /**
@@ -607,7 +1350,7 @@ public:
  *  @return A @c std::shared_ptr, which may be empty if there is not an associated IO handler.
  */
   auto get_shared_ptr() const noexcept {
-    return m_ioh_wptr.lock();
+    return get_weak_ptr().lock();
   }
 
 };
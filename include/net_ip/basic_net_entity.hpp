@@ -21,10 +21,12 @@
 #include <cstddef> // std::size_t 
 #include <utility> // std::move, std::forward
 #include <system_error> // std::make_error, std::error_code
+#include <vector>
 
 #include "net_ip/net_ip_error.hpp"
 
 #include "net_ip/basic_io_interface.hpp"
+#include "net_ip/queue_stats.hpp"
 
 namespace chops {
 namespace net {
@@ -139,6 +141,85 @@ public:
     throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
   }
 
+/**
+ *  @brief Return the input and output statistics of each socket of a sharded UDP
+ *  net entity.
+ *
+ *  This method is only available for a @c udp_sharded_net_entity. The same statistics
+ *  are available through the @c basic_io_interface of each shard, but this method 
+ *  gathers them in one call, e.g. to check how evenly incoming flows are spread.
+ *
+ *  @return A @c std::vector of @c shard_stats, one element per shard.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated net entity.
+ */
+  std::vector<shard_stats> get_shard_stats() const {
+    if (auto p = m_eh_wptr.lock()) {
+      return p->get_shard_stats();
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Return statistics on the CPU-affine placement of accepted connections.
+ *
+ *  This method is only available for a @c tcp_acceptor_net_entity. The statistics are
+ *  all zero unless the acceptor was created with a set of @c cpu_placement entries.
+ *
+ *  @return A @c placement_stats object.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated net entity.
+ */
+  placement_stats get_placement_stats() const {
+    if (auto p = m_eh_wptr.lock()) {
+      return p->get_placement_stats();
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Recycle the memory of the TCP IO handlers created by this net entity, instead
+ *  of allocating and freeing it for each connection.
+ *
+ *  This method is only available for a @c tcp_acceptor_net_entity or a 
+ *  @c tcp_connector_net_entity, and must be called before @c start. It reduces 
+ *  allocator churn and page faults when many connections are made and broken, e.g. in a
+ *  reconnect storm. Each IO handler is still constructed fresh for each connection.
+ *
+ *  @param num_prealloc Number of IO handler memory blocks allocated up front.
+ *
+ *  @param max_free Maximum number of free blocks kept for reuse, zero (default) for no 
+ *  limit. Blocks freed beyond this are returned to the allocator.
+ *
+ *  @return @c false if the net entity has already been started.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated net entity.
+ */
+  bool enable_io_pool(std::size_t num_prealloc, std::size_t max_free = 0u) const {
+    if (auto p = m_eh_wptr.lock()) {
+      return p->enable_io_pool(num_prealloc, max_free);
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
+/**
+ *  @brief Return statistics on the IO handler memory pool.
+ *
+ *  This method is only available for a @c tcp_acceptor_net_entity or a 
+ *  @c tcp_connector_net_entity. The statistics are all zero unless @c enable_io_pool
+ *  has been called.
+ *
+ *  @return An @c object_pool_stats object.
+ *
+ *  @throw A @c net_ip_exception is thrown if there is not an associated net entity.
+ */
+  object_pool_stats get_io_pool_stats() const {
+    if (auto p = m_eh_wptr.lock()) {
+      return p->get_io_pool_stats();
+    }
+    throw net_ip_exception(std::make_error_code(net_ip_errc::weak_ptr_expired));
+  }
+
 /**
  *  @brief Start network processing on the associated net entity with the application
  *  providing IO state change and error function objects.
@@ -0,0 +1,447 @@
+/** @file
+ *
+ *  @ingroup net_ip_component_module
+ *
+ *  @brief A class that starts a large number of TCP connectors with a limit on the
+ *  number of connect attempts in flight and a start-up ramp rate.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef CONNECTOR_GROUP_HPP_INCLUDED
+#define CONNECTOR_GROUP_HPP_INCLUDED
+
+#include "asio/io_context.hpp"
+#include "asio/steady_timer.hpp"
+#include "asio/post.hpp"
+
+#include <cstddef> // std::size_t
+#include <system_error>
+#include <functional> // std::function, std::greater
+#include <memory> // std::shared_ptr, std::make_shared
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <utility> // std::move, std::pair
+#include <algorithm> // std::max
+
+#include "net_ip/net_entity.hpp"
+#include "net_ip/io_interface.hpp"
+#include "net_ip/net_ip_error.hpp"
+
+namespace chops {
+namespace net {
+
+/**
+ *  @brief Statistics for a @c connector_group.
+ *
+ *  A connector is in flight from the time it is started until it connects or gives up
+ *  (it may make multiple connect attempts in between, each failure is counted as a
+ *  connect error). A connection that drops is restarted, and is in flight again until
+ *  it reconnects. The time to all connected is measured from the @c start call, and is
+ *  only valid once @c all_connected is @c true; @c all_connected is cleared whenever
+ *  fewer than all of the connectors are connected.
+ */
+struct connector_group_stats {
+  std::size_t                           num_connectors = 0;
+  std::size_t                           num_pending = 0;
+  std::size_t                           num_in_flight = 0;
+  std::size_t                           num_connected = 0;
+  std::size_t                           num_failed = 0;
+  std::size_t                           peak_in_flight = 0;
+  std::size_t                           connect_errors = 0;
+  bool                                  all_connected = false;
+  std::chrono::steady_clock::duration   time_to_all_connected { };
+};
+
+/**
+ *  @brief Start a fleet of TCP connectors in a controlled way, instead of all at once.
+ *
+ *  Starting thousands of TCP connectors at once fires thousands of simultaneous
+ *  resolves and connects, which overflows listen backlogs on the remote side and leads
+ *  to SYN retries that take seconds. A @c connector_group starts connectors in priority
+ *  order (higher priority first, then in the order added), with at most a configured
+ *  number of connects in flight, and at most a configured number of starts per second.
+ *
+ *  Connectors are added with the IO state change and error function objects that would
+ *  otherwise be passed to @c start; the group wraps them to track progress, so the
+ *  application sees the same callbacks.
+ *
+ *  This class is thread-safe for concurrent access.
+ */
+class connector_group {
+public:
+  using io_state_chg_cb = std::function<void (tcp_io_interface, std::size_t, bool)>;
+  using err_cb = std::function<void (tcp_io_interface, std::error_code)>;
+
+private:
+  using clock = std::chrono::steady_clock;
+  using lock_guard = std::lock_guard<std::mutex>;
+
+  enum class conn_state { pending, connecting, connected, done };
+
+  // the run is bumped each time the connector is started or the group is stopped, so
+  // callbacks from an earlier run of the connector are ignored
+  struct entry {
+    tcp_connector_net_entity  conn;
+    io_state_chg_cb           io_state_chg;
+    err_cb                    err_func;
+    int                       priority;
+    conn_state                state;
+    std::size_t               run;
+  };
+
+  // shared with the connector callbacks, which can outlive the group object
+  struct group_state {
+    std::mutex                                        mutex;
+    std::condition_variable                           cond;
+    asio::steady_timer                                timer;
+    std::size_t                                       max_in_flight;
+    clock::duration                                   start_interval;
+    std::vector<entry>                                entries;
+    std::multimap<int, std::size_t, std::greater<int> > pending; // priority order
+    bool                                              started = false;
+    bool                                              timer_armed = false;
+    clock::time_point                                 start_time { };
+    clock::time_point                                 next_start { };
+    connector_group_stats                             stats;
+
+    group_state(asio::io_context& ioc, std::size_t mif, clock::duration intvl) :
+      mutex(), cond(), timer(ioc), max_in_flight(std::max(mif, std::size_t(1u))),
+      start_interval(intvl), entries(), pending(), stats() { }
+  };
+
+  using state_ptr = std::shared_ptr<group_state>;
+
+private:
+  state_ptr    m_state;
+
+public:
+
+/**
+ *  @brief Construct a @c connector_group.
+ *
+ *  @param ioc An @c io_context used for the ramp timer, which must be run by the
+ *  application.
+ *
+ *  @param max_in_flight Maximum number of connectors started but not yet connected.
+ *
+ *  @param ramp_rate Maximum number of connectors started per second, zero for no limit.
+ */
+  connector_group(asio::io_context& ioc, std::size_t max_in_flight, double ramp_rate = 0.0) :
+    m_state(std::make_shared<group_state>(ioc, max_in_flight,
+            ramp_rate > 0.0 ? std::chrono::duration_cast<clock::duration>(
+                                  std::chrono::duration<double>(1.0 / ramp_rate)) :
+                              clock::duration())) { }
+
+  ~connector_group() { stop(); }
+
+private:
+  connector_group(const connector_group&) = delete;
+  connector_group& operator=(const connector_group&) = delete;
+
+public:
+
+/**
+ *  @brief Add a TCP connector to the group, it is started when its turn comes, which
+ *  may be immediately if the group has already been started.
+ *
+ *  @param conn A @c tcp_connector_net_entity, not yet started.
+ *
+ *  @param io_state_chg IO state change function object, as passed to @c start.
+ *
+ *  @param err_func Error function object, as passed to @c start.
+ *
+ *  @param priority Higher priority connectors are started first.
+ */
+  void add(tcp_connector_net_entity conn, io_state_chg_cb io_state_chg, err_cb err_func,
+           int priority = 0) {
+    {
+      lock_guard gd { m_state->mutex };
+      m_state->entries.push_back(entry { conn, std::move(io_state_chg), std::move(err_func),
+                                         priority, conn_state::pending, 0u });
+      m_state->pending.emplace(priority, m_state->entries.size() - 1u);
+      ++m_state->stats.num_connectors;
+      ++m_state->stats.num_pending;
+      m_state->stats.all_connected = false;
+    }
+    admit(m_state);
+  }
+
+/**
+ *  @brief Start admitting connectors.
+ */
+  void start() {
+    {
+      lock_guard gd { m_state->mutex };
+      if (m_state->started) {
+        return;
+      }
+      m_state->started = true;
+      m_state->start_time = clock::now();
+      m_state->next_start = m_state->start_time;
+    }
+    admit(m_state);
+  }
+
+/**
+ *  @brief Stop admitting connectors and call @c stop on every connector already started.
+ *
+ *  The started connectors are pending again, so a later @c start restarts them.
+ */
+  void stop() {
+    std::vector<tcp_connector_net_entity> started;
+    {
+      lock_guard gd { m_state->mutex };
+      if (!m_state->started) {
+        return;
+      }
+      m_state->started = false;
+      m_state->timer.cancel();
+      auto& stats = m_state->stats;
+      for (std::size_t idx = 0u; idx < m_state->entries.size(); ++idx) {
+        auto& e = m_state->entries[idx];
+        if (e.state == conn_state::connecting) {
+          --stats.num_in_flight;
+        }
+        else if (e.state == conn_state::connected) {
+          --stats.num_connected;
+        }
+        else {
+          continue;
+        }
+        started.push_back(e.conn);
+        e.state = conn_state::pending;
+        ++e.run;
+        m_state->pending.emplace(e.priority, idx);
+        ++stats.num_pending;
+      }
+      stats.all_connected = false;
+    }
+    for (auto& c : started) {
+      try {
+        c.stop();
+      }
+      catch (const net_ip_exception&) { }
+    }
+  }
+
+/**
+ *  @brief Wait until every connector in the group is connected, or the timeout expires.
+ *
+ *  @return @c true if all are connected.
+ */
+  template <typename Rep, typename Period>
+  bool wait_all_connected(std::chrono::duration<Rep, Period> timeout) {
+    std::unique_lock<std::mutex> lk(m_state->mutex);
+    return m_state->cond.wait_for(lk, timeout, [this] { return m_state->stats.all_connected; } );
+  }
+
+  connector_group_stats get_stats() const {
+    lock_guard gd { m_state->mutex };
+    return m_state->stats;
+  }
+
+private:
+
+  // start as many pending connectors as the in-flight limit and ramp rate allow
+  static void admit(const state_ptr& st) {
+    std::vector<std::pair<std::size_t, std::size_t> > to_start; // index and run
+    {
+      lock_guard gd { st->mutex };
+      auto& stats = st->stats;
+      while (st->started && !st->pending.empty() && stats.num_in_flight < st->max_in_flight) {
+        auto now = clock::now();
+        if (now < st->next_start) {
+          if (!st->timer_armed) {
+            st->timer_armed = true;
+            st->timer.expires_at(st->next_start);
+            st->timer.async_wait([st] (const std::error_code& err) {
+                {
+                  lock_guard gd { st->mutex };
+                  st->timer_armed = false;
+                }
+                if (!err) {
+                  admit(st);
+                }
+              }
+            );
+          }
+          break;
+        }
+        auto it = st->pending.begin();
+        auto& e = st->entries[it->second];
+        e.state = conn_state::connecting;
+        to_start.emplace_back(it->second, ++e.run);
+        st->pending.erase(it);
+        --stats.num_pending;
+        ++stats.num_in_flight;
+        stats.peak_in_flight = std::max(stats.peak_in_flight, stats.num_in_flight);
+        st->next_start = std::max(now, st->next_start) + st->start_interval;
+      }
+    }
+    // started outside of the lock, the callbacks take it
+    for (auto [idx, run] : to_start) {
+      start_entry(st, idx, run);
+    }
+  }
+
+  static void start_entry(const state_ptr& st, std::size_t idx, std::size_t run) {
+    tcp_connector_net_entity conn;
+    {
+      lock_guard gd { st->mutex };
+      if (st->entries[idx].run != run) { // stopped since
+        return;
+      }
+      conn = st->entries[idx].conn;
+    }
+    bool ok = false;
+    try {
+      ok = conn.start(
+        [st, idx, run] (tcp_io_interface io, std::size_t num, bool starting) {
+          // the application callback for a new connection runs before it is counted, so
+          // all callbacks have run once all are connected
+          if (!starting) {
+            connection_change(st, idx, run, starting);
+          }
+          io_state_chg_cb f;
+          {
+            lock_guard gd { st->mutex };
+            f = st->entries[idx].io_state_chg;
+          }
+          f(io, num, starting);
+          if (starting) {
+            connection_change(st, idx, run, starting);
+          }
+        },
+        [st, idx, run] (tcp_io_interface io, std::error_code err) {
+          connection_error(st, idx, run, err);
+          err_cb f;
+          {
+            lock_guard gd { st->mutex };
+            f = st->entries[idx].err_func;
+          }
+          f(io, err);
+        }
+      );
+    }
+    catch (const net_ip_exception&) { // the connector is gone
+      give_up(st, idx, run);
+      return;
+    }
+    if (!ok) { // a dropped connection, the connector has not finished stopping yet
+      asio::post(st->timer.get_executor(), [st, idx, run] { start_entry(st, idx, run); } );
+    }
+  }
+
+  static void connection_change(const state_ptr& st, std::size_t idx, std::size_t run,
+                                bool starting) {
+    bool restart = false;
+    {
+      lock_guard gd { st->mutex };
+      auto& e = st->entries[idx];
+      auto& stats = st->stats;
+      if (e.run != run) {
+        return;
+      }
+      if (starting && e.state == conn_state::connecting) {
+        e.state = conn_state::connected;
+        --stats.num_in_flight;
+        ++stats.num_connected;
+        if (stats.num_connected == stats.num_connectors && !stats.all_connected) {
+          stats.all_connected = true;
+          stats.time_to_all_connected = clock::now() - st->start_time;
+          st->cond.notify_all();
+        }
+      }
+      else if (!starting && e.state == conn_state::connected) {
+        // the connector stops after a dropped connection, it is started again (with a 
+        // new run, since the stop callbacks are still to come)
+        e.state = conn_state::connecting;
+        ++e.run;
+        --stats.num_connected;
+        ++stats.num_in_flight;
+        stats.peak_in_flight = std::max(stats.peak_in_flight, stats.num_in_flight);
+        stats.all_connected = false;
+        run = e.run;
+        restart = true;
+      }
+    }
+    if (restart) {
+      asio::post(st->timer.get_executor(), [st, idx, run] { start_entry(st, idx, run); } );
+      return;
+    }
+    admit(st);
+  }
+
+  static void connection_error(const state_ptr& st, std::size_t idx, std::size_t run,
+                               const std::error_code& err) {
+    {
+      lock_guard gd { st->mutex };
+      const auto& e = st->entries[idx];
+      if (e.run != run || e.state != conn_state::connecting) {
+        return;
+      }
+      if (err != std::make_error_code(net_ip_errc::tcp_connector_stopped)) {
+        ++st->stats.connect_errors;
+      }
+    }
+    // a stop from before a restart is reported through the callbacks of the new run, and
+    // some errors (e.g. a failed resolve) stop the connector right after the callback
+    if (err == std::make_error_code(net_ip_errc::tcp_connector_stopped)) {
+      if (!is_running(st, idx)) {
+        give_up(st, idx, run);
+      }
+      return;
+    }
+    asio::post(st->timer.get_executor(), [st, idx, run] {
+        if (!is_running(st, idx)) {
+          give_up(st, idx, run);
+        }
+      }
+    );
+  }
+
+  static bool is_running(const state_ptr& st, std::size_t idx) {
+    tcp_connector_net_entity conn;
+    {
+      lock_guard gd { st->mutex };
+      conn = st->entries[idx].conn;
+    }
+    try {
+      return conn.is_started();
+    }
+    catch (const net_ip_exception&) { }
+    return false;
+  }
+
+  // the connector stopped without connecting, its in-flight slot is released
+  static void give_up(const state_ptr& st, std::size_t idx, std::size_t run) {
+    {
+      lock_guard gd { st->mutex };
+      auto& e = st->entries[idx];
+      if (e.run != run || e.state != conn_state::connecting) {
+        return;
+      }
+      e.state = conn_state::done;
+      --st->stats.num_in_flight;
+      ++st->stats.num_failed;
+    }
+    admit(st);
+  }
+
+};
+
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -0,0 +1,412 @@
+/** @file
+ *
+ *  @ingroup net_ip_component_module
+ *
+ *  @brief A pool of @c io_context threads that grows and shrinks with load.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef ELASTIC_WORKER_POOL_HPP_INCLUDED
+#define ELASTIC_WORKER_POOL_HPP_INCLUDED
+
+#include "asio/io_context.hpp"
+#include "asio/executor_work_guard.hpp"
+#include "asio/post.hpp"
+
+#include <cstddef> // std::size_t
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory> // std::unique_ptr, std::make_unique
+#include <vector>
+#include <optional>
+#include <algorithm> // std::max
+#include <exception>
+#include <iostream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <time.h> // clock_gettime
+#endif
+
+#include "net_ip/net_entity.hpp" // connection_placement_func
+
+namespace chops {
+namespace net {
+
+/**
+ *  @brief Parameters for an @c elastic_worker_pool.
+ *
+ *  Utilization is the fraction of time a thread spends running handlers (as opposed to
+ *  waiting for events), measured from the thread CPU time. Event loop lag is the time
+ *  between posting a probe handler to an @c io_context and the probe running.
+ *
+ *  A thread is added when the average utilization is above @c high_utilization, or
+ *  the lag of any thread is above @c max_lag, for @c grow_samples consecutive samples.
+ *  A thread is retired when the average utilization is below @c low_utilization, and
+ *  no lag is above @c max_lag, for @c shrink_samples consecutive samples.
+ */
+struct worker_pool_params {
+  std::size_t                           min_threads = 1;
+  std::size_t                           max_threads = 4;
+  double                                high_utilization = 0.75;
+  double                                low_utilization = 0.20;
+  std::chrono::steady_clock::duration   max_lag = std::chrono::milliseconds(5);
+  std::chrono::steady_clock::duration   sample_interval = std::chrono::milliseconds(100);
+  std::size_t                           grow_samples = 3;
+  std::size_t                           shrink_samples = 50;
+};
+
+/**
+ *  @brief Statistics for an @c elastic_worker_pool.
+ *
+ *  The utilization and lag are from the most recent sample, the added and retired counts
+ *  are cumulative.
+ */
+struct worker_pool_stats {
+  std::size_t                           num_active = 0;
+  std::size_t                           num_draining = 0;
+  std::size_t                           peak_active = 0;
+  std::size_t                           total_added = 0;
+  std::size_t                           total_retired = 0;
+  double                                avg_utilization = 0.0;
+  std::chrono::steady_clock::duration   max_lag { };
+};
+
+/**
+ *  @brief A pool of threads, each running its own @c io_context, where threads are
+ *  added under sustained load and retired when idle.
+ *
+ *  New work is placed on active threads only, through the @c next_io_context method or
+ *  a placement function object for a TCP acceptor (see @c make_placement_func). A
+ *  retired thread is drained rather than stopped: no new work is placed on it, and the
+ *  thread exits once the work already on it (e.g. connections) has finished. The
+ *  @c io_context objects are kept for the lifetime of the pool and reused when threads
+ *  are added again, so an @c io_context reference is never left dangling.
+ *
+ *  A monitor thread samples the worker threads at the configured interval. Thread CPU
+ *  time is only available on Linux; on other platforms scaling is based on event loop
+ *  lag only.
+ *
+ *  @note This class is not a necessary dependency of the @c net_ip library, but
+ *  is provided for convenience in many use cases.
+ */
+class elastic_worker_pool {
+private:
+  using clock = std::chrono::steady_clock;
+  using work_guard = asio::executor_work_guard<asio::io_context::executor_type>;
+
+  enum class worker_state { idle, active, draining };
+
+  struct pool_worker {
+    asio::io_context              ioc;
+    std::optional<work_guard>     wg;
+    std::thread                   thr;
+    worker_state                  state = worker_state::idle;
+    std::chrono::nanoseconds      last_cpu { };
+    double                        util = 0.0;
+    clock::duration               lag { };
+    clock::time_point             probe_sent { };
+    std::atomic_bool              probe_pending { false };
+    std::atomic<clock::rep>       probe_lag { 0 };
+#if defined(__linux__)
+    clockid_t                     cpu_clock { };
+#endif
+  };
+
+private:
+  worker_pool_params                          m_params;
+  mutable std::mutex                          m_mutex; // worker state and samples
+  std::vector<std::unique_ptr<pool_worker> >  m_workers;
+  std::size_t                                 m_next; // round-robin between equal loads
+  std::size_t                                 m_hot_samples;
+  std::size_t                                 m_cold_samples;
+  worker_pool_stats                           m_stats;
+  clock::time_point                           m_last_sample;
+  std::thread                                 m_monitor_thr;
+  std::condition_variable                     m_monitor_cond;
+  bool                                        m_running;
+
+public:
+
+/**
+ *  @brief Construct the pool, no threads are started until @c start is called.
+ */
+  explicit elastic_worker_pool(const worker_pool_params& params = worker_pool_params()) :
+      m_params(params), m_mutex(), m_workers(), m_next(0u), m_hot_samples(0u),
+      m_cold_samples(0u), m_stats(), m_last_sample(), m_monitor_thr(), m_monitor_cond(),
+      m_running(false) {
+    m_params.min_threads = std::max(m_params.min_threads, std::size_t(1u));
+    m_params.max_threads = std::max(m_params.max_threads, m_params.min_threads);
+    for (std::size_t i = 0; i < m_params.max_threads; ++i) {
+      m_workers.push_back(std::make_unique<pool_worker>());
+    }
+  }
+
+  ~elastic_worker_pool() { stop(); }
+
+private:
+  elastic_worker_pool(const elastic_worker_pool&) = delete;
+  elastic_worker_pool& operator=(const elastic_worker_pool&) = delete;
+
+public:
+
+/**
+ *  @brief Start the minimum number of threads and the monitor thread.
+ */
+  void start() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_running) {
+      return;
+    }
+    m_running = true;
+    for (std::size_t i = 0; i < m_params.min_threads; ++i) {
+      activate(*m_workers[i]);
+    }
+    m_last_sample = clock::now();
+    m_monitor_thr = std::thread([this] { monitor(); } );
+  }
+
+/**
+ *  @brief Stop the monitor thread, then stop each @c io_context and join the threads,
+ *  abandoning any outstanding operations or handlers.
+ */
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (!m_running) {
+        return;
+      }
+      m_running = false;
+    }
+    m_monitor_cond.notify_all();
+    m_monitor_thr.join();
+    std::lock_guard<std::mutex> lk(m_mutex);
+    for (auto& w : m_workers) {
+      if (w->state != worker_state::idle) {
+        w->wg.reset();
+        w->ioc.stop();
+        w->thr.join();
+        w->state = worker_state::idle;
+      }
+    }
+    m_stats.num_active = 0u;
+    m_stats.num_draining = 0u;
+  }
+
+/**
+ *  @brief Return the @c io_context of the least utilized active thread, for placing
+ *  new work such as a TCP connector or UDP entity.
+ */
+  asio::io_context& next_io_context() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto* w = pick();
+    return w ? w->ioc : m_workers.front()->ioc; // not started yet
+  }
+
+/**
+ *  @brief Return a function object for @c net_ip::make_tcp_acceptor that places each
+ *  accepted connection on the least utilized active thread.
+ *
+ *  The pool must outlive the acceptor.
+ */
+  connection_placement_func make_placement_func() {
+    return [this] (int) -> asio::io_context* {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      auto* w = pick();
+      return w ? &w->ioc : nullptr;
+    };
+  }
+
+/**
+ *  @brief Return the number of threads new work is placed on.
+ */
+  std::size_t num_active() const {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_stats.num_active;
+  }
+
+  worker_pool_stats get_stats() const {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_stats;
+  }
+
+private:
+
+  // all of the following are called with the lock held
+
+  void activate(pool_worker& w) {
+    if (w.state == worker_state::draining) {
+      --m_stats.num_draining;
+      // with the work guard in place a thread that hasn't stopped yet won't stop
+      w.wg.emplace(asio::make_work_guard(w.ioc));
+      if (w.ioc.stopped()) {
+        w.thr.join();
+        w.state = worker_state::idle;
+      }
+    }
+    if (w.state == worker_state::draining) { // still running, keep it
+      w.state = worker_state::active;
+    }
+    else {
+      w.ioc.restart();
+      w.wg.emplace(asio::make_work_guard(w.ioc));
+      w.thr = std::thread([&w] {
+          try {
+            w.ioc.run();
+          }
+          catch (const std::exception& e) {
+            std::cerr << "std::exception caught in elastic_worker_pool thread: " << e.what() << std::endl;
+          }
+          catch (...) {
+            std::cerr << "Unknown exception caught in elastic_worker_pool thread" << std::endl;
+          }
+        }
+      );
+#if defined(__linux__)
+      ::pthread_getcpuclockid(w.thr.native_handle(), &w.cpu_clock);
+#endif
+      w.last_cpu = thread_cpu_time(w);
+      w.util = 0.0;
+      w.lag = clock::duration();
+      w.state = worker_state::active;
+    }
+    ++m_stats.num_active;
+    ++m_stats.total_added;
+    m_stats.peak_active = std::max(m_stats.peak_active, m_stats.num_active);
+  }
+
+  // the work guard is released, the thread exits when the work on it is done
+  void drain(pool_worker& w) {
+    w.wg.reset();
+    w.state = worker_state::draining;
+    --m_stats.num_active;
+    ++m_stats.num_draining;
+    ++m_stats.total_retired;
+  }
+
+  pool_worker* pick() {
+    pool_worker* best = nullptr;
+    std::size_t n = m_workers.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      auto& w = *m_workers[(m_next + i) % n];
+      if (w.state == worker_state::active && (!best || w.util < best->util)) {
+        best = &w;
+      }
+    }
+    ++m_next;
+    return best;
+  }
+
+  std::chrono::nanoseconds thread_cpu_time(const pool_worker& w) const {
+#if defined(__linux__)
+    timespec ts { };
+    if (::clock_gettime(w.cpu_clock, &ts) == 0) {
+      return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+    }
+#endif
+    (void) w;
+    return std::chrono::nanoseconds();
+  }
+
+  void monitor() {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (m_running) {
+      m_monitor_cond.wait_for(lk, m_params.sample_interval);
+      if (m_running) {
+        sample();
+      }
+    }
+  }
+
+  void sample() {
+    auto now = clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last_sample);
+    m_last_sample = now;
+
+    double util_sum = 0.0;
+    clock::duration max_lag { };
+    for (auto& wp : m_workers) {
+      auto& w = *wp;
+      if (w.state == worker_state::draining && w.ioc.stopped()) { // drained
+        w.thr.join();
+        w.state = worker_state::idle;
+        --m_stats.num_draining;
+        continue;
+      }
+      if (w.state != worker_state::active) {
+        continue;
+      }
+      auto cpu = thread_cpu_time(w);
+      w.util = elapsed.count() > 0 ?
+            static_cast<double>((cpu - w.last_cpu).count()) / static_cast<double>(elapsed.count()) : 0.0;
+      w.last_cpu = cpu;
+      // a probe still waiting to run is at least as late as the time since it was sent
+      if (w.probe_pending.load(std::memory_order_acquire)) {
+        w.lag = now - w.probe_sent;
+      }
+      else {
+        w.lag = clock::duration(w.probe_lag.load(std::memory_order_relaxed));
+        w.probe_sent = now;
+        w.probe_pending.store(true, std::memory_order_relaxed);
+        asio::post(w.ioc, [&w, sent = now] {
+            w.probe_lag.store((clock::now() - sent).count(), std::memory_order_relaxed);
+            w.probe_pending.store(false, std::memory_order_release);
+          }
+        );
+      }
+      util_sum += w.util;
+      max_lag = std::max(max_lag, w.lag);
+    }
+    m_stats.avg_utilization = m_stats.num_active ?
+                                util_sum / static_cast<double>(m_stats.num_active) : 0.0;
+    m_stats.max_lag = max_lag;
+
+    bool lagging = max_lag > m_params.max_lag;
+    m_hot_samples = (m_stats.avg_utilization > m_params.high_utilization || lagging) ?
+                      m_hot_samples + 1u : 0u;
+    m_cold_samples = (m_stats.avg_utilization < m_params.low_utilization && !lagging) ?
+                      m_cold_samples + 1u : 0u;
+
+    if (m_hot_samples >= m_params.grow_samples && m_stats.num_active < m_params.max_threads) {
+      // prefer a draining thread, which is still running
+      pool_worker* cand = nullptr;
+      for (auto& w : m_workers) {
+        if (w->state == worker_state::draining || (!cand && w->state == worker_state::idle)) {
+          cand = w.get();
+        }
+      }
+      if (cand) {
+        activate(*cand);
+      }
+      m_hot_samples = 0u;
+    }
+    else if (m_cold_samples >= m_params.shrink_samples &&
+             m_stats.num_active > m_params.min_threads) {
+      pool_worker* cand = nullptr;
+      for (auto& w : m_workers) {
+        if (w->state == worker_state::active && (!cand || w->util < cand->util)) {
+          cand = w.get();
+        }
+      }
+      drain(*cand);
+      m_cold_samples = 0u;
+    }
+  }
+
+};
+
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -23,9 +23,13 @@
 #include <ostream>
 #include <string>
 #include <chrono>
+#include <map>
+#include <utility> // std::pair
 
 #include "net_ip/basic_io_interface.hpp"
 #include "net_ip/io_interface.hpp"
+#include "net_ip/queue_stats.hpp"
+#include "net_ip/detail/mpsc_ring.hpp"
 
 #include "queue/wait_queue.hpp"
 
@@ -75,6 +79,8 @@ struct error_data {
 
   error_data(const void* iop, std::error_code e) : 
       time_p(std::chrono::steady_clock::now()), io_intf_ptr(iop), err(std::move(e)) { }
+
+  error_data() noexcept : time_p(), io_intf_ptr(nullptr), err() { }
 };
 
 /**
@@ -127,6 +133,124 @@ inline std::size_t ostream_error_sink_with_wait_queue (err_wait_q& wq, std::ostr
   return cnt;
 }
 
+/**
+ *  @brief Bounded lock-free queue that provides error data, an alternative to 
+ *  @c err_wait_q that never blocks the IO threads.
+ *
+ *  During an error storm (e.g. thousands of connections dropping at once) pushing into
+ *  a @c wait_queue contends on its lock from every IO thread. Pushing into an
+ *  @c err_ring is a single atomic operation, and when the ring is full the error is 
+ *  dropped and counted (see @c ring_queue_stats) instead of waiting.
+ *
+ *  The ring is constructed with a capacity, e.g. @c err_ring ring(4096);
+ */
+using err_ring = detail::mpsc_ring<error_data>;
+
+/**
+ *  @brief Create an error function object that uses an @c err_ring for error data.
+ */
+template <typename IOT>
+auto make_error_func_with_error_ring(err_ring& ring) {
+  return [&ring] (basic_io_interface<IOT> io, std::error_code e) {
+    const void* iop = static_cast<const void *>(io.get_shared_ptr().get());
+    ring.try_push([iop, &e] (error_data& ed) { ed = error_data(iop, e); } );
+  };
+}
+
+/**
+ *  @brief Error data coalesced by error code and IO handler, as written by 
+ *  @c ostream_error_sink_with_error_ring.
+ */
+struct coalesced_error_data {
+  std::chrono::steady_clock::time_point   first_time_p;
+  std::chrono::steady_clock::time_point   last_time_p;
+  std::size_t                             count;
+};
+
+/**
+ *  @brief A sink function that drains an @c err_ring, coalesces the error data, and 
+ *  streams it into an @c std::ostream.
+ *
+ *  Errors with the same error code from the same IO handler (or net entity) are written
+ *  as one line with a count and the first and last timestamps. Coalesced lines are 
+ *  written when the ring has been drained, or when the oldest pending entry is older
+ *  than the flush interval, so a continuous error storm still produces timely output. 
+ *  Errors dropped because the ring was full are reported on a separate line.
+ *
+ *  This function exits when the @c err_ring is closed and drained. @c std::async can be 
+ *  used to invoke this function in a separate thread.
+ *
+ *  @param ring A reference to an @c err_ring object.
+ *
+ *  @param os A reference to a @c std::ostream, such as @c std::cerr.
+ *
+ *  @param flush_interval Maximum time coalesced entries are held before being written.
+ *
+ *  @return The total number of error entries processed (each coalesced entry counts 
+ *  individually), not including dropped entries.
+ */
+inline std::size_t ostream_error_sink_with_error_ring (err_ring& ring, std::ostream& os,
+          std::chrono::steady_clock::duration flush_interval = std::chrono::seconds(1)) {
+
+  using key_type = std::pair<const void*, std::error_code>;
+  constexpr std::size_t batch_size = 256;
+
+  std::map<key_type, coalesced_error_data> pending;
+  auto oldest = std::chrono::steady_clock::time_point::max();
+  std::size_t cnt = 0;
+  std::size_t dropped = 0;
+
+  auto to_ms = [] (std::chrono::steady_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+  };
+
+  auto flush = [&] {
+    for (const auto& [key, ce] : pending) {
+      os << '[' << to_ms(ce.first_time_p);
+      if (ce.count > 1) {
+        os << " - " << to_ms(ce.last_time_p);
+      }
+      os << "] io_addr: " << key.first << " err: " << key.second << ", " << 
+            key.second.message();
+      if (ce.count > 1) {
+        os << " (" << ce.count << " times)";
+      }
+      os << '\n';
+    }
+    pending.clear();
+    oldest = std::chrono::steady_clock::time_point::max();
+    auto d = ring.get_stats().total_dropped;
+    if (d != dropped) {
+      os << "error ring full, " << (d - dropped) << " errors dropped\n";
+      dropped = d;
+    }
+    os.flush();
+  };
+
+  auto coalesce = [&] (const error_data& ed) {
+    auto [it, inserted] = pending.try_emplace(key_type(ed.io_intf_ptr, ed.err),
+                                    coalesced_error_data { ed.time_p, ed.time_p, 0u });
+    it->second.last_time_p = ed.time_p;
+    ++it->second.count;
+    if (inserted && ed.time_p < oldest) {
+      oldest = ed.time_p;
+    }
+    ++cnt;
+  };
+
+  while (ring.wait_and_consume(coalesce, batch_size) != 0) {
+    // keep coalescing while more data is waiting, unless output is overdue
+    while (ring.consume(coalesce, batch_size) != 0) {
+      if (!pending.empty() && std::chrono::steady_clock::now() - oldest >= flush_interval) {
+        flush();
+      }
+    }
+    flush();
+  }
+  flush();
+  return cnt;
+}
+
 } // end net namespace
 } // end chops namespace
 
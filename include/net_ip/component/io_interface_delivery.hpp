@@ -21,7 +21,7 @@
  *  function objects, each packaged with the logic and data needed to call @c start_io.
  *
  *  There are two ways the @c io_interface can be delivered - 1) by @c std::future, or 2) by a
- *  @c wait_queue. Futures are appropriate for TCP connectors and UDP entities, since there is
+ *  @c wait_queue (or the lock-free @c io_ring). Futures are appropriate for TCP connectors and UDP entities, since there is
  *  only a single state change for IO start and a single state change for IO stop. Futures are
  *  not appropriate for a TCP acceptor, since there are multiple IO start and stop state changes
  *  during the lifetime of the acceptor and futures are single use. For a TCP acceptor the state 
@@ -29,6 +29,10 @@
  *  can also use the @c wait_queue delivery mechanism, which may be more appropriate than futures 
  *  for many use cases.
  *
+ *  When starting a large number of connectors (thousands), a promise and future per connector
+ *  and a locked @c wait_queue push per state change add up. The @c io_ring delivery and the
+ *  @c io_ready_latch ("notify when N connections are up") are the scalable alternatives.
+ *
  *  @author Cliff Green
  *
  *  Copyright (c) 2018 by Cliff Green
@@ -47,9 +51,15 @@
 #include <memory>
 
 #include <future>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
 
 #include "net_ip/net_entity.hpp"
 #include "net_ip/io_interface.hpp"
+#include "net_ip/detail/mpsc_ring.hpp"
 
 #include "queue/wait_queue.hpp"
 
@@ -67,6 +77,8 @@ struct io_state_chg_data {
 
   io_state_chg_data(basic_io_interface<IOT> io, std::size_t num, bool s) :
       io_intf(std::move(io)), num_handlers(num), starting(s) { }
+
+  io_state_chg_data() : io_intf(), num_handlers(0), starting(false) { }
 };
 
 /**
@@ -115,6 +127,214 @@ void start_with_wait_queue (basic_net_entity<ET> entity,
   );
 }
 
+/**
+ *  @brief Bounded lock-free queue that provides IO state change data.
+ *
+ *  Pushes from the IO state change callbacks never take a lock. The capacity (rounded up
+ *  to a power of two) should cover the number of state changes that can be outstanding
+ *  before the application drains the ring; if the ring is full the state change data is
+ *  dropped and counted in the ring stats.
+ */
+template <typename IOT>
+using io_ring = detail::mpsc_ring<io_state_chg_data<IOT> >;
+
+/**
+ *  @brief @c io_ring for @c tcp_io_interface objects.
+ */
+using tcp_io_ring = io_ring<chops::net::tcp_io>;
+/**
+ *  @brief @c io_ring for @c udp_io_interface objects.
+ */
+using udp_io_ring = io_ring<chops::net::udp_io>;
+
+/**
+ *  @brief A countdown latch that is released when a target number of IO handlers 
+ *  (e.g. N of M connectors) are up.
+ *
+ *  The count goes up on each IO start state change and down on each IO stop. The
+ *  first time the number of IO handlers up reaches the target, the optional ready 
+ *  callback is invoked (from the IO thread that made the last state change) and
+ *  any threads blocked in @c wait are released. The state change path is a couple of
+ *  atomic operations, the lock is only taken once, when the latch is released.
+ */
+class io_ready_latch {
+private:
+  std::size_t                            m_target;
+  std::atomic_size_t                     m_up;
+  std::atomic_size_t                     m_total_started;
+  std::atomic_bool                       m_fired;
+  std::atomic_bool                       m_ready;
+  std::atomic_bool                       m_start_marked;
+  std::function<void (std::size_t)>      m_ready_cb;
+  std::chrono::steady_clock::time_point  m_start_time;
+  std::chrono::steady_clock::time_point  m_ready_time;
+  std::mutex                             m_mutex;
+  std::condition_variable                m_cond;
+
+public:
+
+/**
+ *  @brief Construct the latch.
+ *
+ *  @param target Number of IO handlers that must be up to release the latch.
+ *
+ *  @param ready_cb Callback invoked once when the latch is released, with the number 
+ *  of IO handlers up at that time; it must not block.
+ */
+  explicit io_ready_latch(std::size_t target, 
+                          std::function<void (std::size_t)> ready_cb = { }) :
+      m_target(target), m_up(0), m_total_started(0), m_fired(false), m_ready(false), 
+      m_start_marked(false), m_ready_cb(std::move(ready_cb)), m_start_time(std::chrono::steady_clock::now()),
+      m_ready_time(), m_mutex(), m_cond() { }
+
+private:
+  io_ready_latch(const io_ready_latch&) = delete;
+  io_ready_latch& operator=(const io_ready_latch&) = delete;
+
+public:
+
+/**
+ *  @brief Mark the time the entities are started, which @c time_to_ready is measured 
+ *  from; only the first call has an effect.
+ *
+ *  @c start_with_io_ring and @c start_with_latch call this before starting each entity.
+ *  If the entities are started some other way, call it just before starting the first
+ *  one, otherwise @c time_to_ready is measured from the latch construction.
+ */
+  void start() {
+    if (m_start_marked.exchange(true)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_start_time = std::chrono::steady_clock::now();
+  }
+
+  // called from IO state change callbacks
+  void state_change(bool starting) {
+    if (!starting) {
+      m_up.fetch_sub(1, std::memory_order_relaxed);
+      return;
+    }
+    m_total_started.fetch_add(1, std::memory_order_relaxed);
+    std::size_t up = m_up.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (up < m_target || m_fired.exchange(true)) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_ready_time = std::chrono::steady_clock::now();
+      m_ready = true;
+    }
+    if (m_ready_cb) {
+      m_ready_cb(up);
+    }
+    m_cond.notify_all();
+  }
+
+/**
+ *  @brief Block until the latch is released.
+ */
+  void wait() {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_cond.wait(lk, [this] { return is_ready(); } );
+  }
+
+/**
+ *  @brief Block until the latch is released or the timeout expires.
+ *
+ *  @return @c true if the latch was released.
+ */
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    return m_cond.wait_for(lk, timeout, [this] { return is_ready(); } );
+  }
+
+  bool is_ready() const noexcept { return m_ready.load(); }
+
+  std::size_t num_up() const noexcept { return m_up.load(std::memory_order_relaxed); }
+
+  std::size_t total_started() const noexcept { 
+    return m_total_started.load(std::memory_order_relaxed);
+  }
+
+/**
+ *  @brief Time from the first @c start call (or latch construction) until the latch was 
+ *  released, zero if not yet released.
+ */
+  std::chrono::steady_clock::duration time_to_ready() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return is_ready() ? m_ready_time - m_start_time : std::chrono::steady_clock::duration::zero();
+  }
+};
+
+/**
+ *  @brief Start the entity with an IO state change function object that
+ *  calls @c start_io and also passes @c io_interface data through an @c io_ring.
+ *
+ *  @param entity A @c basic_net_entity object, @c start is immediately called.
+ *
+ *  @param io_start A function object which will invoke @c start_io on an 
+ *  @c io_interface object.
+ *
+ *  @param ring An @c io_ring which is used to pass the IO state change data.
+ *
+ *  @param err_func Error function object.
+ *
+ *  @param latch Optional @c io_ready_latch, updated on each IO state change.
+ */
+template <typename IOT, typename ET, typename IOS, typename EF>
+void start_with_io_ring (basic_net_entity<ET> entity, 
+                         IOS&& io_start,
+                         io_ring<IOT>& ring, 
+                         EF&& err_func,
+                         io_ready_latch* latch = nullptr) {
+  if (latch) {
+    latch->start();
+  }
+  entity.start( [ios = std::move(io_start), &ring, latch]
+                   (basic_io_interface<IOT> io, std::size_t num, bool starting) mutable {
+      if (starting) {
+        ios(io, num, starting);
+      }
+      ring.try_push( [&io, num, starting] (io_state_chg_data<IOT>& d) {
+          d = io_state_chg_data<IOT>(io, num, starting);
+        }
+      );
+      if (latch) {
+        latch->state_change(starting);
+      }
+    },
+    std::forward<EF>(err_func)
+  );
+}
+
+/**
+ *  @brief Start the entity with an IO state change function object that
+ *  calls @c start_io and updates an @c io_ready_latch, without delivering the
+ *  @c io_interface objects.
+ *
+ *  This is the cheapest way to start a large number of connectors when the application 
+ *  only needs to know when enough of them are up (e.g. sends go through a @c send_to_all
+ *  populated from the IO state change function object).
+ */
+template <typename IOT, typename ET, typename IOS, typename EF>
+void start_with_latch (basic_net_entity<ET> entity, 
+                       IOS&& io_start,
+                       io_ready_latch& latch, 
+                       EF&& err_func) {
+  latch.start();
+  entity.start( [ios = std::move(io_start), &latch]
+                   (basic_io_interface<IOT> io, std::size_t num, bool starting) mutable {
+      if (starting) {
+        ios(io, num, starting);
+      }
+      latch.state_change(starting);
+    },
+    std::forward<EF>(err_func)
+  );
+}
+
 /**
  *  @brief An alias for a @c std::future containing an @c basic_io_interface.
  */
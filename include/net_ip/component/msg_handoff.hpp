@@ -0,0 +1,199 @@
+/** @file
+ *
+ *  @ingroup net_ip_component_module
+ *
+ *  @brief A bounded lock-free queue that hands incoming messages from IO threads to an
+ *  application thread, plugging in as a message handler.
+ *
+ *  The common pattern of copying each incoming message into a @c chops::wait_queue
+ *  takes a lock per message, which is contended at high message rates. A @c msg_handoff
+ *  instead has a fixed number of slots, each with a reusable byte buffer, and producers
+ *  (the message handlers, one or many IO threads) claim a slot with a single atomic
+ *  operation. Once a slot buffer has grown to the size of the messages no further
+ *  allocations occur.
+ *
+ *  There is a single consumer, which processes messages in batches. When the queue is
+ *  empty the consumer spins for a while and then blocks; producers only take the lock to
+ *  wake the consumer when it is blocked.
+ *
+ *  When the queue is full incoming messages are dropped (and counted), since blocking an
+ *  IO thread would stall every other connection it is running.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef MSG_HANDOFF_HPP_INCLUDED
+#define MSG_HANDOFF_HPP_INCLUDED
+
+#include "asio/buffer.hpp"
+
+#include <cstddef> // std::size_t, std::byte
+#include <vector>
+
+#include "net_ip/basic_io_interface.hpp"
+#include "net_ip/queue_stats.hpp"
+#include "net_ip/detail/mpsc_ring.hpp"
+
+namespace chops {
+namespace net {
+
+/**
+ *  @brief Statistics for a @c msg_handoff object.
+ */
+using msg_handoff_stats = ring_queue_stats;
+
+/**
+ *  @brief Bounded multi-producer, single-consumer message queue for handing messages
+ *  from message handlers to an application thread.
+ *
+ *  @tparam IOT The IO handler type, @c tcp_io or @c udp_entity_io.
+ */
+template <typename IOT>
+class msg_handoff {
+public:
+  using endpoint_type = typename IOT::endpoint_type;
+
+private:
+  struct msg_slot {
+    std::vector<std::byte>    bytes;
+    basic_io_interface<IOT>   io_intf;
+    endpoint_type             endp;
+  };
+
+private:
+  detail::mpsc_ring<msg_slot>  m_ring;
+
+public:
+
+/**
+ *  @brief Construct a @c msg_handoff with a fixed number of slots.
+ *
+ *  @param capacity Number of messages that can be queued, rounded up to a power of two.
+ *
+ *  @param spin_count Number of checks for data the consumer makes before blocking.
+ */
+  explicit msg_handoff(std::size_t capacity, 
+                       std::size_t spin_count = detail::mpsc_ring<msg_slot>::default_spin_count) :
+      m_ring(capacity, spin_count) { }
+
+/**
+ *  @brief Copy a message into the queue, callable from any number of threads.
+ *
+ *  @return @c false if the queue is full (the message is dropped) or closed.
+ */
+  bool try_push(asio::const_buffer buf, basic_io_interface<IOT> io_intf,
+                const endpoint_type& endp) {
+    return m_ring.try_push([&buf, &io_intf, &endp] (msg_slot& s) {
+        // the slot buffer keeps its capacity, so this only allocates while slots warm up
+        const auto* p = static_cast<const std::byte*>(buf.data());
+        s.bytes.assign(p, p + buf.size());
+        s.io_intf = io_intf;
+        s.endp = endp;
+      }
+    );
+  }
+
+/**
+ *  @brief Process up to @c max_batch queued messages without blocking; only call from
+ *  the consumer thread.
+ *
+ *  @param func Function object callback with the same signature as a message handler
+ *  (the return value is ignored):
+ *
+ *  @code
+ *    void (asio::const_buffer, chops::net::basic_io_interface<IOT>, endpoint_type);
+ *  @endcode
+ *
+ *  The buffer is only valid for the duration of the callback.
+ *
+ *  @return Number of messages processed.
+ */
+  template <typename F>
+  std::size_t consume(F&& func, std::size_t max_batch) {
+    return m_ring.consume([&func] (msg_slot& s) {
+        func(asio::const_buffer(s.bytes.data(), s.bytes.size()), s.io_intf, s.endp);
+      }, max_batch);
+  }
+
+/**
+ *  @brief Process up to @c max_batch queued messages, waiting for at least one; only call
+ *  from the consumer thread.
+ *
+ *  @return Number of messages processed, zero only when the queue is closed and empty.
+ */
+  template <typename F>
+  std::size_t wait_and_consume(F&& func, std::size_t max_batch) {
+    return m_ring.wait_and_consume([&func] (msg_slot& s) {
+        func(asio::const_buffer(s.bytes.data(), s.bytes.size()), s.io_intf, s.endp);
+      }, max_batch);
+  }
+
+/**
+ *  @brief Close the queue, further pushes fail and a waiting consumer returns once the
+ *  queue is drained.
+ */
+  void close() { m_ring.close(); }
+
+  bool is_closed() const noexcept { return m_ring.is_closed(); }
+
+  msg_handoff_stats get_stats() const noexcept { return m_ring.get_stats(); }
+
+};
+
+/**
+ *  @brief Message handler function object that pushes each incoming message into a
+ *  @c msg_handoff.
+ *
+ *  Both the single message and batch signatures (TCP and UDP) are supported, so this
+ *  can be passed to @c start_io or @c start_io_batch. Dropped messages do not close the
+ *  connection, they are counted in the @c msg_handoff stats.
+ *
+ *  The @c msg_handoff must outlive the IO handlers using this object.
+ */
+template <typename IOT>
+struct msg_handoff_handler {
+  using endpoint_type = typename IOT::endpoint_type;
+
+  msg_handoff<IOT>*   handoff;
+
+  bool operator()(asio::const_buffer buf, basic_io_interface<IOT> io_intf, endpoint_type endp) {
+    handoff->try_push(buf, io_intf, endp);
+    return true;
+  }
+
+  bool operator()(const std::vector<asio::const_buffer>& bufs, basic_io_interface<IOT> io_intf,
+                  const endpoint_type& endp) {
+    for (const auto& buf : bufs) {
+      handoff->try_push(buf, io_intf, endp);
+    }
+    return true;
+  }
+
+  bool operator()(const std::vector<asio::const_buffer>& bufs, basic_io_interface<IOT> io_intf,
+                  const std::vector<endpoint_type>& endps) {
+    for (std::size_t i = 0; i < bufs.size(); ++i) {
+      handoff->try_push(bufs[i], io_intf, endps[i]);
+    }
+    return true;
+  }
+};
+
+/**
+ *  @brief Create a message handler that pushes incoming messages into a @c msg_handoff.
+ */
+template <typename IOT>
+msg_handoff_handler<IOT> make_msg_handoff_handler(msg_handoff<IOT>& ho) {
+  return msg_handoff_handler<IOT> { &ho };
+}
+
+} // end net namespace
+} // end chops namespace
+
+#endif
+
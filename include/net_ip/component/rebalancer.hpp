@@ -0,0 +1,265 @@
+/** @file
+ *
+ *  @ingroup net_ip_component_module
+ *
+ *  @brief A class template that evens out connection load across a pool of
+ *  @c io_context objects by migrating busy connections.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef REBALANCER_HPP_INCLUDED
+#define REBALANCER_HPP_INCLUDED
+
+#include "asio/io_context.hpp"
+
+#include <cstddef> // std::size_t
+#include <utility> // std::move
+
+#include <mutex>
+#include <vector>
+#include <algorithm> // std::max_element, std::min_element
+
+#include "net_ip/basic_io_interface.hpp"
+#include "net_ip/queue_stats.hpp"
+#include "net_ip/io_interface.hpp"
+#include "net_ip/net_ip_error.hpp"
+
+#include "utility/erase_where.hpp"
+
+namespace chops {
+namespace net {
+
+/**
+ *  @brief Track the traffic of a collection of connections spread across a pool of
+ *  @c io_context objects (e.g. one per @c worker), and move busy connections from the most
+ *  loaded @c io_context to the least loaded one.
+ *
+ *  The load of a connection is the number of bytes read plus bytes sent since the previous
+ *  call to @c rebalance, taken from the @c input_stats and @c output_queue_stats counters.
+ *  The load of an @c io_context is the sum of its connections. An application calls
+ *  @c rebalance periodically, e.g. from a timer, and each call moves at most a few
+ *  connections so that a temporary spike does not cause connections to bounce back and forth.
+ *
+ *  Connections are added with the index of the @c io_context they were created on. A
+ *  function object operator overload is provided so that a @c std::ref to a rebalancer
+ *  can be used in composing function objects for @c io_state_change calls.
+ *
+ *  This class is thread-safe for concurrent access.
+ *
+ *  @tparam IOT The IO handler type, @c tcp_io (UDP IO handlers cannot be migrated).
+ */
+template <typename IOT>
+class io_rebalancer {
+private:
+  using lock_guard = std::lock_guard<std::mutex>;
+  using io_intf    = basic_io_interface<IOT>;
+
+  struct conn_entry {
+    io_intf       io;
+    std::size_t   ioc_idx;
+    std::size_t   last_total;
+    std::size_t   load;
+  };
+
+private:
+  mutable std::mutex                m_mutex;
+  std::vector<asio::io_context*>    m_iocs;
+  std::vector<conn_entry>           m_conns;
+  double                            m_imbalance_ratio;
+  std::size_t                       m_max_moves;
+  std::size_t                       m_total_moves;
+
+public:
+/**
+ *  @brief Construct with the pool of @c io_context objects.
+ *
+ *  @param iocs The @c io_context objects, which must outlive the rebalancer and the
+ *  connections.
+ *
+ *  @param imbalance_ratio Connections are only moved when the most loaded @c io_context
+ *  has more than this ratio times the load of the least loaded one.
+ *
+ *  @param max_moves Maximum number of connections moved per @c rebalance call.
+ */
+  explicit io_rebalancer(std::vector<asio::io_context*> iocs, double imbalance_ratio = 1.25,
+                         std::size_t max_moves = 1u) :
+      m_mutex(), m_iocs(std::move(iocs)), m_conns(), m_imbalance_ratio(imbalance_ratio),
+      m_max_moves(max_moves), m_total_moves(0u) { }
+
+/**
+ *  @brief Add a @c basic_io_interface object to the collection.
+ *
+ *  @param io The @c basic_io_interface.
+ *
+ *  @param ioc_idx Index of the @c io_context the IO handler is running on.
+ */
+  void add_io_interface(io_intf io, std::size_t ioc_idx) {
+    std::size_t tot = 0u;
+    try {
+      tot = traffic_total(io);
+    }
+    catch (const net_ip_exception&) {
+      return;
+    }
+    lock_guard gd { m_mutex };
+    m_conns.push_back(conn_entry { io, ioc_idx, tot, 0u });
+  }
+
+/**
+ *  @brief Remove a @c basic_io_interface object from the collection.
+ */
+  void remove_io_interface(io_intf io) {
+    lock_guard gd { m_mutex };
+    chops::erase_where_if(m_conns, [&io] (const conn_entry& e) { return e.io == io; } );
+  }
+
+/**
+ *  @brief Interface for @c io_state_change parameter of @c start method, where the
+ *  @c io_context index is bound in, e.g. using a lambda.
+ */
+  void operator() (io_intf io, std::size_t ioc_idx, bool starting) {
+    if (starting) {
+      add_io_interface(io, ioc_idx);
+    }
+    else {
+      remove_io_interface(io);
+    }
+  }
+
+/**
+ *  @brief Sample the connection traffic counters and move connections from the most
+ *  loaded @c io_context to the least loaded one.
+ *
+ *  A connection is only moved if its load is no more than half of the difference
+ *  between the two, so that the move narrows the gap instead of reversing it. Connections
+ *  that have closed are removed from the collection.
+ *
+ *  @return Number of connections moved.
+ */
+  std::size_t rebalance() {
+    lock_guard gd { m_mutex };
+    sample();
+    if (m_iocs.size() < 2u) {
+      return 0u;
+    }
+    std::size_t moves = 0u;
+    while (moves < m_max_moves) {
+      auto loads = compute_loads();
+      auto hi = static_cast<std::size_t>(std::max_element(loads.cbegin(), loads.cend()) - loads.cbegin());
+      auto lo = static_cast<std::size_t>(std::min_element(loads.cbegin(), loads.cend()) - loads.cbegin());
+      if (loads[hi] == 0u || static_cast<double>(loads[hi]) <=
+                             m_imbalance_ratio * static_cast<double>(loads[lo])) {
+        break;
+      }
+      // the busiest connection that fits in half the gap
+      std::size_t gap = (loads[hi] - loads[lo]) / 2u;
+      conn_entry* cand = nullptr;
+      for (auto& e : m_conns) {
+        if (e.ioc_idx == hi && e.load != 0u && e.load <= gap &&
+                               (!cand || e.load > cand->load)) {
+          cand = &e;
+        }
+      }
+      if (!cand) {
+        break;
+      }
+      try {
+        cand->io.migrate_to(*m_iocs[lo]);
+      }
+      catch (const net_ip_exception&) {
+        cand->load = 0u; // closed since the sample, removed next time
+        continue;
+      }
+      cand->ioc_idx = lo;
+      ++moves;
+    }
+    m_total_moves += moves;
+    return moves;
+  }
+
+/**
+ *  @brief Return the load of each @c io_context as of the last @c rebalance call, in bytes.
+ */
+  std::vector<std::size_t> get_loads() const {
+    lock_guard gd { m_mutex };
+    return compute_loads();
+  }
+
+/**
+ *  @brief Return the @c io_context index of a @c basic_io_interface, or the number of
+ *  @c io_context objects if not in the collection.
+ */
+  std::size_t get_io_context_index(io_intf io) const {
+    lock_guard gd { m_mutex };
+    for (const auto& e : m_conns) {
+      if (e.io == io) {
+        return e.ioc_idx;
+      }
+    }
+    return m_iocs.size();
+  }
+
+/**
+ *  @brief Return the number of @c basic_io_interface objects in the collection.
+ */
+  std::size_t size() const {
+    lock_guard gd { m_mutex };
+    return m_conns.size();
+  }
+
+/**
+ *  @brief Return the total number of connections moved.
+ */
+  std::size_t total_moves() const {
+    lock_guard gd { m_mutex };
+    return m_total_moves;
+  }
+
+private:
+
+  static std::size_t traffic_total(const io_intf& io) {
+    return io.get_input_stats().total_bytes_read + io.get_output_queue_stats().total_bytes_sent;
+  }
+
+  void sample() {
+    for (auto& e : m_conns) {
+      try {
+        std::size_t tot = traffic_total(e.io);
+        e.load = tot - e.last_total;
+        e.last_total = tot;
+      }
+      catch (const net_ip_exception&) {
+        e.load = 0u;
+      }
+    }
+    chops::erase_where_if(m_conns, [] (const conn_entry& e) { return !e.io.is_valid(); } );
+  }
+
+  std::vector<std::size_t> compute_loads() const {
+    std::vector<std::size_t> loads(m_iocs.size(), 0u);
+    for (const auto& e : m_conns) {
+      if (e.ioc_idx < loads.size()) {
+        loads[e.ioc_idx] += e.load;
+      }
+    }
+    return loads;
+  }
+};
+
+/**
+ *  @brief Rebalancer for TCP connections.
+ */
+using tcp_rebalancer = io_rebalancer<tcp_io>;
+
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -22,9 +22,11 @@
 
 #include <mutex>
 #include <vector>
+#include <algorithm> // std::max
 
 #include "net_ip/basic_io_interface.hpp"
 #include "net_ip/queue_stats.hpp"
+#include "net_ip/intrusive_buffer.hpp"
 
 #include "utility/erase_where.hpp"
 #include "utility/shared_buffer.hpp"
@@ -95,26 +97,54 @@ public:
 /**
  *  @brief Send a reference counted buffer to all @c basic_io_interface
  *  objects.
+ *
+ *  An IO handler that has gone away (but not yet been removed from the collection) 
+ *  is skipped, without an exception being thrown.
+ *
+ *  @return Number of @c basic_io_interface objects the buffer was sent to.
  */
-  void send(chops::const_shared_buffer buf) const {
+  std::size_t send(chops::const_shared_buffer buf) const {
+    std::size_t cnt = 0;
     lock_guard gd { m_mutex };
     for (const auto& io : m_io_intfs) {
-      io.send(buf);
+      if (io.try_send(buf)) {
+        ++cnt;
+      }
     }
+    return cnt;
   }
 /**
  *  @brief Copy the bytes, create a reference counted buffer, then send it to
  *  all @c basic_io_interface objects.
  */
-  void send(const void* buf, std::size_t sz) const {
-    send(chops::const_shared_buffer(buf, sz));
+  std::size_t send(const void* buf, std::size_t sz) const {
+    return send(chops::const_shared_buffer(buf, sz));
   }
 /**
  *  @brief Move the buffer from a writable reference counted buffer to a 
  *  immutable reference counted buffer, then send it.
  */
-  void send(chops::mutable_shared_buffer&& buf) const { 
-    send(chops::const_shared_buffer(std::move(buf)));
+  std::size_t send(chops::mutable_shared_buffer&& buf) const { 
+    return send(chops::const_shared_buffer(std::move(buf)));
+  }
+/**
+ *  @brief Send an @c intrusive_buffer to all @c basic_io_interface objects, each 
+ *  IO handler shares the same bytes.
+ *
+ *  The buffer must have been created with @c refcount_mode::atomic unless all of the 
+ *  IO handlers run in the calling thread.
+ *
+ *  @return Number of @c basic_io_interface objects the buffer was sent to.
+ */
+  std::size_t send(const intrusive_buffer& buf) const {
+    std::size_t cnt = 0;
+    lock_guard gd { m_mutex };
+    for (const auto& io : m_io_intfs) {
+      if (io.try_send(buf)) {
+        ++cnt;
+      }
+    }
+    return cnt;
   }
 /**
  *  @brief Return the number of @c basic_io_interface objects in the collection.
@@ -136,6 +166,21 @@ public:
       auto qs = io.get_output_queue_stats();
       tot.output_queue_size += qs.output_queue_size;
       tot.bytes_in_output_queue += qs.bytes_in_output_queue;
+      tot.expired_bufs += qs.expired_bufs;
+      tot.expired_bytes += qs.expired_bytes;
+      tot.conflated_bufs += qs.conflated_bufs;
+      tot.total_bufs_sent += qs.total_bufs_sent;
+      tot.total_bytes_sent += qs.total_bytes_sent;
+      tot.total_writes += qs.total_writes;
+      tot.max_write_batch = std::max(tot.max_write_batch, qs.max_write_batch);
+      tot.coalesce_windows += qs.coalesce_windows;
+      tot.total_coalesce_delay += qs.total_coalesce_delay;
+      tot.speculative_writes += qs.speculative_writes;
+      tot.speculative_writes_completed += qs.speculative_writes_completed;
+      for (std::size_t i = 0; i < tot.lanes.size(); ++i) {
+        tot.lanes[i].output_queue_size += qs.lanes[i].output_queue_size;
+        tot.lanes[i].bytes_in_output_queue += qs.lanes[i].bytes_in_output_queue;
+      }
     }
     return tot;
   }
@@ -24,6 +24,11 @@
 #include <exception>
 #include <iostream>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "asio/io_context.hpp"
 #include "asio/executor.hpp"
 #include "asio/executor_work_guard.hpp"
@@ -73,6 +78,28 @@ public:
     );
   }
 
+/**
+ *  @brief Start the thread, pinned to a CPU, e.g. for use with CPU-affine placement
+ *  of accepted TCP connections.
+ *
+ *  @param cpu The CPU number.
+ *
+ *  @return @c true if the thread was pinned; pinning is only supported on Linux, and the 
+ *  thread runs unpinned otherwise.
+ */
+  bool start(int cpu) {
+    start();
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return ::pthread_setaffinity_np(m_run_thr.native_handle(), sizeof(cpus), &cpus) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+  }
+
 /**
  *  @brief Shutdown the executor and join the thread, abandoning any outstanding operations or handlers.
  */
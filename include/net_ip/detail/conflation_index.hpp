@@ -0,0 +1,158 @@
+/** @file
+ *
+ *  @ingroup net_ip_module
+ *
+ *  @brief Open addressing hash index used by the output queue for keyed
+ *  (conflated) sends.
+ *
+ *  Keys are mapped to the sequence number of the not-yet-sent queue element
+ *  holding the latest value for that key. Linear probing is used with a power
+ *  of two table size and a maximum load factor of one half, and erasure uses
+ *  backward shift deletion, so there are no tombstones and lookups stay short
+ *  as elements churn through the queue. Storage is not allocated until the
+ *  first key is inserted.
+ *
+ *  @note For internal use only.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef CONFLATION_INDEX_HPP_INCLUDED
+#define CONFLATION_INDEX_HPP_INCLUDED
+
+#include <vector>
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+#include <utility> // std::swap
+
+namespace chops {
+namespace net {
+namespace detail {
+
+class conflation_index {
+public:
+  using key_type = std::uint64_t;
+  using seq_type = std::uint64_t;
+
+private:
+
+  struct slot {
+    key_type  key;
+    seq_type  seq;
+    bool      used;
+  };
+
+  static constexpr std::size_t initial_capacity = 16;
+
+private:
+
+  std::vector<slot>  m_slots;
+  std::size_t        m_size;
+
+public:
+
+  conflation_index() noexcept : m_slots(), m_size(0) { }
+
+  std::size_t size() const noexcept { return m_size; }
+  bool empty() const noexcept { return m_size == 0; }
+
+  // return a pointer to the sequence number for the key, or nullptr if not present
+  seq_type* find(key_type key) noexcept {
+    if (m_size == 0) {
+      return nullptr;
+    }
+    for (std::size_t i = home(key); m_slots[i].used; i = next(i)) {
+      if (m_slots[i].key == key) {
+        return &m_slots[i].seq;
+      }
+    }
+    return nullptr;
+  }
+
+  // key must not already be present
+  void insert(key_type key, seq_type seq) {
+    if ((m_size + 1) * 2 > m_slots.size()) {
+      grow();
+    }
+    place(key, seq);
+    ++m_size;
+  }
+
+  bool erase(key_type key) noexcept {
+    if (m_size == 0) {
+      return false;
+    }
+    std::size_t i = home(key);
+    for ( ; m_slots[i].used; i = next(i)) {
+      if (m_slots[i].key == key) {
+        break;
+      }
+    }
+    if (!m_slots[i].used) {
+      return false;
+    }
+    // backward shift deletion - move later entries of the probe sequence into
+    // the hole if their home slot allows it
+    std::size_t hole = i;
+    for (std::size_t j = next(hole); m_slots[j].used; j = next(j)) {
+      std::size_t h = home(m_slots[j].key);
+      // entry at j can move to hole if h is not cyclically within (hole, j]
+      bool movable = (hole <= j) ? (h <= hole || h > j) : (h <= hole && h > j);
+      if (movable) {
+        m_slots[hole] = m_slots[j];
+        hole = j;
+      }
+    }
+    m_slots[hole].used = false;
+    --m_size;
+    return true;
+  }
+
+private:
+
+  std::size_t mask() const noexcept { return m_slots.size() - 1; }
+  std::size_t next(std::size_t i) const noexcept { return (i + 1) & mask(); }
+
+  std::size_t home(key_type key) const noexcept {
+    // splitmix64 finalizer, spreads sequential keys (e.g. instrument ids)
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return static_cast<std::size_t>(key) & mask();
+  }
+
+  void place(key_type key, seq_type seq) noexcept {
+    std::size_t i = home(key);
+    while (m_slots[i].used) {
+      i = next(i);
+    }
+    m_slots[i] = slot { key, seq, true };
+  }
+
+  void grow() {
+    std::vector<slot> old(m_slots.empty() ? initial_capacity : m_slots.size() * 2,
+                          slot { 0, 0, false });
+    std::swap(old, m_slots);
+    for (const auto& s : old) {
+      if (s.used) {
+        place(s.key, s.seq);
+      }
+    }
+  }
+
+};
+
+} // end detail namespace
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -22,6 +22,11 @@
 #include <system_error>
 #include <functional> // std::function, used for type erased notifications to net_entity objects
 #include <memory> // std::shared_ptr
+#include <utility> // std::forward, std::move
+#include <chrono>
+#include <cstddef> // std::size_t
+#include <vector>
+#include <array>
 
 #include "net_ip/detail/output_queue.hpp"
 #include "net_ip/queue_stats.hpp"
@@ -40,20 +45,93 @@ public:
   using outq_type = output_queue<typename IOT::endpoint_type>;
   using outq_opt_el = typename outq_type::opt_queue_element;
   using queue_stats = chops::net::output_queue_stats;
+  using duration = std::chrono::steady_clock::duration;
+  using key_type = typename outq_type::key_type;
+  // number of buffers and number of bytes in a completed write
+  using write_complete_cb = std::function<void (std::size_t, std::size_t)>;
 
 private:
 
-  std::atomic_bool     m_io_started; // may be called from multiple threads concurrently
-  bool                 m_write_in_progress; // internal only, doesn't need to be atomic
-  outq_type            m_outq;
+  // kept out of line, allocated in the run thread on first update
+  struct io_stats {
+    std::atomic_size_t     total_bufs_sent { 0 };
+    std::atomic_size_t     total_bytes_sent { 0 };
+    std::atomic_size_t     total_writes { 0 };
+    std::atomic_size_t     max_write_batch { 0 };
+    std::atomic_size_t     coalesce_windows { 0 };
+    std::atomic<duration>  coalesce_delay { duration::zero() };
+    std::atomic_size_t     spec_writes { 0 };
+    std::atomic_size_t     spec_writes_completed { 0 };
+    std::atomic_size_t     total_msgs_read { 0 };
+    std::atomic_size_t     total_bytes_read { 0 };
+    std::atomic_size_t     read_budget_yields { 0 };
+  };
+
+private:
+
+  std::atomic_bool       m_io_started; // may be called from multiple threads concurrently
+  bool                   m_write_in_progress; // internal only, doesn't need to be atomic
+  std::atomic<duration>  m_max_age; // zero means queued buffers never expire
+  outq_type              m_outq;
+  std::atomic<io_stats*> m_stats; // owned, null until the first update
+  std::size_t            m_budget_msgs; // the read budget is internal only, set in run thread
+  std::size_t            m_budget_bytes;
+  std::size_t            m_turn_msgs;
+  std::size_t            m_turn_bytes;
+  write_complete_cb      m_write_complete_cb; // internal only, set and called in run thread
 
 public:
 
   explicit io_common() noexcept :
-    m_io_started(false), m_write_in_progress(false), m_outq() { }
+    m_io_started(false), m_write_in_progress(false), m_max_age(duration::zero()), m_outq(),
+    m_stats(nullptr), m_budget_msgs(0), m_budget_bytes(0), m_turn_msgs(0),
+    m_turn_bytes(0), m_write_complete_cb() { }
+
+  ~io_common() { delete m_stats.load(); }
+
+  io_common(const io_common&) = delete;
+  io_common& operator=(const io_common&) = delete;
+
+  // the following methods can be called concurrently
+  queue_stats get_output_queue_stats() const noexcept {
+    auto qs = m_outq.get_queue_stats();
+    const io_stats* st = m_stats.load();
+    if (st == nullptr) {
+      return qs;
+    }
+    qs.total_bufs_sent = st->total_bufs_sent;
+    qs.total_bytes_sent = st->total_bytes_sent;
+    qs.total_writes = st->total_writes;
+    qs.max_write_batch = st->max_write_batch;
+    qs.coalesce_windows = st->coalesce_windows;
+    qs.total_coalesce_delay = st->coalesce_delay;
+    qs.speculative_writes = st->spec_writes;
+    qs.speculative_writes_completed = st->spec_writes_completed;
+    return qs;
+  }
+
+  input_stats get_input_stats() const noexcept {
+    const io_stats* st = m_stats.load();
+    if (st == nullptr) {
+      return input_stats { };
+    }
+    return input_stats { st->total_msgs_read, st->total_bytes_read, st->read_budget_yields };
+  }
+
+  void set_max_age(duration max_age) noexcept { m_max_age = max_age; }
+
+  duration get_max_age() const noexcept { return m_max_age; }
+
+  void set_lane_weight(std::size_t lane, std::size_t weight) {
+    m_outq.set_lane_weight(lane, weight);
+  }
+
+  // expiry is measured from the application send call
+  time_point make_expiry() const noexcept { return make_expiry(m_max_age); }
 
-  // the following four methods can be called concurrently
-  queue_stats get_output_queue_stats() const noexcept { return m_outq.get_queue_stats(); }
+  static time_point make_expiry(duration max_age) noexcept {
+    return max_age == duration::zero() ? no_expiry : std::chrono::steady_clock::now() + max_age;
+  }
 
   bool is_io_started() const noexcept { return m_io_started; }
 
@@ -70,20 +148,123 @@ public:
   // rest of these method called only from within run thread
   bool is_write_in_progress() const noexcept { return m_write_in_progress; }
 
-  bool start_write_setup(const chops::const_shared_buffer&);
-  bool start_write_setup(const chops::const_shared_buffer&, const endp_type&);
+  // queue attributes are passed through to the output queue
+  bool start_write_setup(const out_buffer& buf, 
+                         const queue_attrs& attrs = queue_attrs()) {
+    return start_write_setup_impl(buf, attrs);
+  }
+  bool start_write_setup(const out_buffer& buf, const endp_type& endp, 
+                         const queue_attrs& attrs = queue_attrs()) {
+    return start_write_setup_impl(buf, endp, attrs);
+  }
+  // multi-part message, queued as a unit if a write is in progress
+  template <std::size_t N>
+  bool start_write_setup(const std::array<chops::const_shared_buffer, N>& parts,
+                         const queue_attrs& attrs = queue_attrs()) {
+    return start_write_setup_impl(parts.data(), N, attrs);
+  }
+
+  // a write held back by the io handler (output coalescing) is queued
+  void hold_write(const out_buffer& buf, const queue_attrs& attrs) {
+    m_outq.add_element(buf, attrs);
+  }
+  template <std::size_t N>
+  void hold_write(const std::array<chops::const_shared_buffer, N>& parts, 
+                  const queue_attrs& attrs) {
+    m_outq.add_element(parts.data(), N, attrs);
+  }
 
   outq_opt_el get_next_element();
 
+  // append up to max_bufs queued buffers for a gathered write, TCP only; a multi-part 
+  // message is not split
+  bool get_next_elements(std::vector<out_buffer>& bufs, std::size_t max_bufs);
+
+  std::size_t output_queue_bytes() const noexcept { return m_outq.num_bytes(); }
+
+  // called by the io handler when a coalescing window closes and the write starts
+  void coalesce_window_closed(duration held) {
+    io_stats& st = stats();
+    ++st.coalesce_windows;
+    st.coalesce_delay = st.coalesce_delay.load() + held; // only updated in run thread
+  }
+
+  // zero for both means no read budget
+  void set_read_budget(std::size_t max_msgs, std::size_t max_bytes) noexcept {
+    m_budget_msgs = max_msgs;
+    m_budget_bytes = max_bytes;
+    m_turn_msgs = 0;
+    m_turn_bytes = 0;
+  }
+
+  // returns true if the read budget for this turn is used up
+  bool msg_read(std::size_t num_bytes) {
+    io_stats& st = stats();
+    ++st.total_msgs_read;
+    st.total_bytes_read += num_bytes;
+    ++m_turn_msgs;
+    m_turn_bytes += num_bytes;
+    if ((m_budget_msgs != 0 && m_turn_msgs >= m_budget_msgs) ||
+        (m_budget_bytes != 0 && m_turn_bytes >= m_budget_bytes)) {
+      ++st.read_budget_yields;
+      m_turn_msgs = 0;
+      m_turn_bytes = 0;
+      return true;
+    }
+    return false;
+  }
+
+  // completed is false if an async write is needed for the remainder
+  void speculative_write(bool completed) {
+    io_stats& st = stats();
+    ++st.spec_writes;
+    if (completed) {
+      ++st.spec_writes_completed;
+    }
+  }
+
+  void set_write_complete_cb(write_complete_cb cb) { m_write_complete_cb = std::move(cb); }
+
+  // called before the next element is pulled from the queue
+  void write_complete(std::size_t num_bufs, std::size_t num_bytes) {
+    io_stats& st = stats();
+    st.total_bufs_sent += num_bufs;
+    st.total_bytes_sent += num_bytes;
+    ++st.total_writes;
+    if (num_bufs > st.max_write_batch) {
+      st.max_write_batch = num_bufs; // only updated in run thread
+    }
+    if (m_write_complete_cb) {
+      m_write_complete_cb(num_bufs, num_bytes);
+    }
+  }
+
+private:
+
+  // only called in the run thread
+  io_stats& stats() {
+    io_stats* st = m_stats.load();
+    if (st == nullptr) {
+      st = new io_stats;
+      m_stats = st;
+    }
+    return *st;
+  }
+
+  // arguments are passed through to the output queue add_element method
+  template <typename ... Args>
+  bool start_write_setup_impl(Args&& ... args);
+
 };
 
 template <typename IOT>
-bool io_common<IOT>::start_write_setup(const chops::const_shared_buffer& buf) {
+template <typename ... Args>
+bool io_common<IOT>::start_write_setup_impl(Args&& ... args) {
   if (!m_io_started) {
     return false; // shutdown happening or not io_started, don't start a write
   }
   if (m_write_in_progress) { // queue buffer
-    m_outq.add_element(buf);
+    m_outq.add_element(std::forward<Args>(args)...);
     return false;
   }
   m_write_in_progress = true;
@@ -91,17 +272,20 @@ bool io_common<IOT>::start_write_setup(const chops::const_shared_buffer& buf) {
 }
 
 template <typename IOT>
-bool io_common<IOT>::start_write_setup(const chops::const_shared_buffer& buf, 
-                                       const endp_type& endp) {
-  if (!m_io_started) {
-    return false; // shutdown happening or not io_started, don't start a write
-  }
-  if (m_write_in_progress) { // queue buffer
-    m_outq.add_element(buf, endp);
+bool io_common<IOT>::get_next_elements(std::vector<out_buffer>& bufs,
+                                       std::size_t max_bufs) {
+  if (!m_io_started) { // shutting down
     return false;
   }
-  m_write_in_progress = true;
-  return true;
+  while (bufs.size() < max_bufs || m_outq.mid_message()) {
+    auto elem = m_outq.get_next_element();
+    if (!elem) {
+      break;
+    }
+    bufs.push_back(std::move(elem->first));
+  }
+  m_write_in_progress = !bufs.empty();
+  return m_write_in_progress;
 }
 
 template <typename IOT>
@@ -0,0 +1,51 @@
+/** @file
+ *
+ *  @ingroup net_ip_module
+ *
+ *  @brief Executor type used by the IO handlers and net entities to serialize their
+ *  completion handlers.
+ *
+ *  By default each IO handler and net entity owns an @c asio::strand, so that the
+ *  @c asio::io_context can be run by a pool of threads. Defining
+ *  @c CHOPS_NET_IP_SINGLE_THREADED before including any Chops Net IP header elides
+ *  the strands, which is only safe when exactly one thread runs each @c io_context.
+ *
+ *  @note For internal use only.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef IO_EXECUTOR_HPP_INCLUDED
+#define IO_EXECUTOR_HPP_INCLUDED
+
+#include "asio/executor.hpp"
+#include "asio/strand.hpp"
+#include "asio/bind_executor.hpp"
+#include "asio/post.hpp"
+#include "asio/dispatch.hpp"
+
+namespace chops {
+namespace net {
+namespace detail {
+
+#ifdef CHOPS_NET_IP_SINGLE_THREADED
+using io_executor = asio::executor;
+#else
+using io_executor = asio::strand<asio::executor>;
+#endif
+
+inline io_executor make_io_executor(const asio::executor& ex) {
+  return io_executor(ex);
+}
+
+} // end detail namespace
+} // end net namespace
+} // end chops namespace
+
+#endif
@@ -0,0 +1,221 @@
+/** @file
+ *
+ *  @ingroup net_ip_module
+ *
+ *  @brief Bounded lock-free multi-producer, single-consumer ring, used by components
+ *  that hand data from IO threads to an application thread.
+ *
+ *  The slot sequence number design is from Dmitry Vyukov's bounded queue. A producer
+ *  claims a slot with one CAS, fills it in place, then publishes it; the consumer releases
+ *  each slot after its callback returns, so slot contents (e.g. buffers) are reused.
+ *
+ *  When empty the consumer spins and then blocks on a condition variable; producers only
+ *  take the lock when the consumer is blocked.
+ *
+ *  @note For internal use only.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef MPSC_RING_HPP_INCLUDED
+#define MPSC_RING_HPP_INCLUDED
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::intptr_t
+#include <atomic>
+#include <memory> // std::unique_ptr
+#include <mutex>
+#include <condition_variable>
+
+#include "net_ip/queue_stats.hpp"
+
+namespace chops {
+namespace net {
+namespace detail {
+
+template <typename T>
+class mpsc_ring {
+private:
+  struct slot {
+    std::atomic<std::size_t>  seq;
+    T                         val;
+  };
+
+  // keep the producer and consumer positions on separate cache lines
+  static constexpr std::size_t cache_line = 64;
+
+public:
+  // iterations the consumer checks for data before blocking
+  static constexpr std::size_t default_spin_count = 2000;
+
+private:
+  std::unique_ptr<slot[]>                       m_slots;
+  std::size_t                                   m_mask;
+  std::size_t                                   m_spin_count;
+  alignas(cache_line) std::atomic<std::size_t>  m_enq_pos;
+  alignas(cache_line) std::atomic<std::size_t>  m_deq_pos;
+  alignas(cache_line) std::atomic<std::size_t>  m_dropped;
+  std::atomic<std::size_t>                      m_high_water;
+  std::atomic<std::size_t>                      m_parks;
+  std::atomic_bool                              m_consumer_waiting;
+  std::atomic_bool                              m_closed;
+  std::mutex                                    m_mutex;
+  std::condition_variable                       m_cond;
+
+public:
+
+  // capacity is rounded up to a power of two
+  explicit mpsc_ring(std::size_t capacity, std::size_t spin_count = default_spin_count) :
+      m_slots(), m_mask(0), m_spin_count(spin_count), m_enq_pos(0), m_deq_pos(0),
+      m_dropped(0), m_high_water(0), m_parks(0), m_consumer_waiting(false), m_closed(false),
+      m_mutex(), m_cond() {
+    std::size_t sz = 2;
+    while (sz < capacity) {
+      sz <<= 1;
+    }
+    m_mask = sz - 1;
+    m_slots = std::make_unique<slot[]>(sz);
+    for (std::size_t i = 0; i < sz; ++i) {
+      m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  mpsc_ring(const mpsc_ring&) = delete;
+  mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+public:
+
+  // fill is called with a reference to the claimed slot value; returns false if the
+  // ring is full (counted as a drop) or closed
+  template <typename F>
+  bool try_push(F&& fill) {
+    if (m_closed.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    std::size_t pos = m_enq_pos.load(std::memory_order_relaxed);
+    slot* s = nullptr;
+    for (;;) {
+      s = &m_slots[pos & m_mask];
+      std::size_t seq = s->seq.load(std::memory_order_acquire);
+      auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (dif == 0) {
+        if (m_enq_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      else if (dif < 0) { // consumer hasn't released this slot, ring is full
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      else {
+        pos = m_enq_pos.load(std::memory_order_relaxed);
+      }
+    }
+    fill(s->val);
+    s->seq.store(pos + 1, std::memory_order_release);
+
+    std::size_t deq = m_deq_pos.load(std::memory_order_relaxed);
+    if (pos + 1 > deq) { // the consumer may already be past later slots
+      update_high_water(pos + 1 - deq);
+    }
+    // pairs with the fence in park, either the consumer sees the data or this sees
+    // the waiting flag
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumer_waiting.load(std::memory_order_relaxed)) {
+      { std::lock_guard<std::mutex> lk(m_mutex); }
+      m_cond.notify_one();
+    }
+    return true;
+  }
+
+  // consumer thread only; func is called with a reference to each slot value
+  template <typename F>
+  std::size_t consume(F&& func, std::size_t max_batch) {
+    std::size_t pos = m_deq_pos.load(std::memory_order_relaxed);
+    std::size_t n = 0;
+    while (n < max_batch) {
+      slot& s = m_slots[pos & m_mask];
+      if (s.seq.load(std::memory_order_acquire) != pos + 1) {
+        break;
+      }
+      func(s.val);
+      s.seq.store(pos + m_mask + 1, std::memory_order_release); // slot free for next lap
+      ++pos;
+      ++n;
+      m_deq_pos.store(pos, std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  // consumer thread only; returns zero only when closed and empty
+  template <typename F>
+  std::size_t wait_and_consume(F&& func, std::size_t max_batch) {
+    for (;;) {
+      std::size_t n = consume(func, max_batch);
+      if (n != 0) {
+        return n;
+      }
+      if (m_closed.load(std::memory_order_acquire)) {
+        return consume(func, max_batch); // producers may have finished before the close
+      }
+      for (std::size_t i = 0; i < m_spin_count && !ready(); ++i) { }
+      if (!ready()) {
+        park();
+      }
+    }
+  }
+
+  void close() {
+    m_closed.store(true, std::memory_order_release);
+    { std::lock_guard<std::mutex> lk(m_mutex); }
+    m_cond.notify_all();
+  }
+
+  bool is_closed() const noexcept { return m_closed.load(std::memory_order_acquire); }
+
+  bool ready() const noexcept {
+    std::size_t pos = m_deq_pos.load(std::memory_order_relaxed);
+    return m_slots[pos & m_mask].seq.load(std::memory_order_acquire) == pos + 1;
+  }
+
+  ring_queue_stats get_stats() const noexcept {
+    std::size_t enq = m_enq_pos.load(std::memory_order_relaxed);
+    std::size_t deq = m_deq_pos.load(std::memory_order_relaxed);
+    return ring_queue_stats { m_mask + 1, enq - deq, m_high_water.load(std::memory_order_relaxed),
+                              enq, m_dropped.load(std::memory_order_relaxed),
+                              m_parks.load(std::memory_order_relaxed) };
+  }
+
+private:
+
+  void park() {
+    m_consumer_waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready() && !m_closed.load(std::memory_order_acquire)) {
+      m_parks.fetch_add(1, std::memory_order_relaxed);
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_cond.wait(lk, [this] { return ready() || m_closed.load(std::memory_order_acquire); });
+    }
+    m_consumer_waiting.store(false, std::memory_order_relaxed);
+  }
+
+  void update_high_water(std::size_t occ) noexcept {
+    std::size_t hw = m_high_water.load(std::memory_order_relaxed);
+    while (occ > hw && !m_high_water.compare_exchange_weak(hw, occ, std::memory_order_relaxed)) { }
+  }
+
+};
+
+} // end detail namespace
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -0,0 +1,216 @@
+/** @file
+ *
+ *  @ingroup net_ip_module
+ *
+ *  @brief A pool of recycled memory blocks for objects created through
+ *  @c std::allocate_shared, used for the TCP IO handlers.
+ *
+ *  Creating a @c std::shared_ptr to a new IO handler for every connection, then freeing
+ *  it on disconnect, churns the allocator and page faults in new memory during reconnect
+ *  storms. An @c object_pool keeps the freed blocks (each big enough for the object and
+ *  the @c std::shared_ptr control block) and hands them out again. Objects are always
+ *  constructed fresh in a recycled block, so no state carries over from a previous
+ *  connection. Blocks can be pre-allocated when the pool is created.
+ *
+ *  A default constructed @c object_pool has no pool, and creates objects with
+ *  @c std::make_shared.
+ *
+ *  @note For internal use only.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef OBJECT_POOL_HPP_INCLUDED
+#define OBJECT_POOL_HPP_INCLUDED
+
+#include <cstddef> // std::size_t, std::max_align_t
+#include <memory> // std::shared_ptr, std::allocate_shared
+#include <new> // operator new, operator delete
+#include <mutex>
+#include <vector>
+#include <utility> // std::forward
+
+#include "net_ip/queue_stats.hpp"
+
+namespace chops {
+namespace net {
+namespace detail {
+
+template <typename T>
+class object_pool {
+private:
+
+  // blocks can be freed from any thread (wherever the last shared_ptr is released), and
+  // outlive the object_pool, since each control block holds a reference to the state
+  struct pool_state {
+    std::mutex           mutex;
+    std::vector<void*>   free_blocks;
+    std::size_t          block_size;
+    std::size_t          max_free;
+    object_pool_stats    stats;
+
+    // the block size is zero until the first allocation sets it, see object_pool
+    explicit pool_state(std::size_t mf) :
+        mutex(), free_blocks(), block_size(0u), max_free(mf), stats() { }
+
+    void preallocate(std::size_t num_prealloc) {
+      std::lock_guard<std::mutex> lk(mutex);
+      while (free_blocks.size() > num_prealloc) {
+        ::operator delete(free_blocks.back());
+        free_blocks.pop_back();
+      }
+      while (block_size != 0u && free_blocks.size() < num_prealloc) {
+        free_blocks.push_back(::operator new(block_size));
+      }
+      stats = object_pool_stats { };
+      stats.blocks_owned = free_blocks.size();
+      stats.blocks_free = free_blocks.size();
+    }
+
+    ~pool_state() {
+      for (auto b : free_blocks) {
+        ::operator delete(b);
+      }
+    }
+
+    void* allocate(std::size_t bytes) {
+      if (block_size == 0u) {
+        block_size = bytes;
+      }
+      if (bytes > block_size) { // not expected, but the block can't be used
+        std::lock_guard<std::mutex> lk(mutex);
+        ++stats.total_allocs;
+        ++stats.pool_misses;
+        return ::operator new(bytes);
+      }
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        ++stats.total_allocs;
+        if (!free_blocks.empty()) {
+          void* b = free_blocks.back();
+          free_blocks.pop_back();
+          ++stats.pool_hits;
+          stats.blocks_free = free_blocks.size();
+          return b;
+        }
+        ++stats.pool_misses;
+        ++stats.blocks_owned;
+      }
+      return ::operator new(block_size);
+    }
+
+    void deallocate(void* b, std::size_t bytes) noexcept {
+      if (bytes <= block_size) {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (max_free == 0u || free_blocks.size() < max_free) {
+          try {
+            free_blocks.push_back(b);
+            stats.blocks_free = free_blocks.size();
+            return;
+          }
+          catch (...) { } // fall through and free it
+        }
+        --stats.blocks_owned;
+      }
+      ::operator delete(b);
+    }
+  };
+
+  using state_ptr = std::shared_ptr<pool_state>;
+
+  // std::allocate_shared rebinds the allocator to its control block type
+  template <typename U>
+  struct pool_allocator {
+    using value_type = U;
+
+    template <typename V>
+    struct rebind { using other = pool_allocator<V>; };
+
+    state_ptr  m_state;
+
+    explicit pool_allocator(state_ptr st) noexcept : m_state(std::move(st)) { }
+
+    template <typename V>
+    pool_allocator(const pool_allocator<V>& other) noexcept : m_state(other.m_state) { }
+
+    U* allocate(std::size_t n) {
+      if (alignof(U) > alignof(std::max_align_t)) {
+        return static_cast<U*>(::operator new(n * sizeof(U)));
+      }
+      return static_cast<U*>(m_state->allocate(n * sizeof(U)));
+    }
+
+    void deallocate(U* p, std::size_t n) noexcept {
+      if (alignof(U) > alignof(std::max_align_t)) {
+        ::operator delete(p);
+        return;
+      }
+      m_state->deallocate(p, n * sizeof(U));
+    }
+
+    template <typename V>
+    bool operator==(const pool_allocator<V>& rhs) const noexcept {
+      return m_state == rhs.m_state;
+    }
+
+    template <typename V>
+    bool operator!=(const pool_allocator<V>& rhs) const noexcept {
+      return !(*this == rhs);
+    }
+  };
+
+  // same size and alignment as T, so std::allocate_shared asks for the same block size
+  struct stand_in {
+    alignas(T) unsigned char bytes[sizeof(T)];
+  };
+
+private:
+  state_ptr  m_state;
+
+public:
+
+  object_pool() noexcept : m_state() { }
+
+  // max_free of zero means every freed block is kept for reuse; the control block size
+  // is implementation specific, so the block size is set by creating a stand-in object,
+  // whose block is then kept as one of the pre-allocated blocks
+  object_pool(std::size_t num_prealloc, std::size_t max_free) :
+      m_state(std::make_shared<pool_state>(max_free)) {
+    std::allocate_shared<stand_in>(pool_allocator<stand_in>(m_state));
+    m_state->preallocate(num_prealloc);
+  }
+
+  bool is_pooled() const noexcept { return static_cast<bool>(m_state); }
+
+  std::size_t block_size() const noexcept { return m_state ? m_state->block_size : 0u; }
+
+  template <typename... Args>
+  std::shared_ptr<T> make_shared(Args&&... args) {
+    if (!m_state) {
+      return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+    return std::allocate_shared<T>(pool_allocator<T>(m_state), std::forward<Args>(args)...);
+  }
+
+  object_pool_stats get_stats() const {
+    if (!m_state) {
+      return object_pool_stats { };
+    }
+    std::lock_guard<std::mutex> lk(m_state->mutex);
+    return m_state->stats;
+  }
+
+};
+
+} // end detail namespace
+} // end net namespace
+} // end chops namespace
+
+#endif
+
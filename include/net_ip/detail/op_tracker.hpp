@@ -0,0 +1,130 @@
+/** @file
+ *
+ *  @ingroup net_ip_module
+ *
+ *  @brief Keep an IO handler alive while it has operations outstanding, without a
+ *  @c std::shared_ptr copy per operation.
+ *
+ *  Capturing a @c std::shared_ptr to the IO handler in every completion handler is an
+ *  atomic increment and decrement per read, write and post. An @c op_tracker instead
+ *  counts the outstanding operations on one strand with a plain integer. The first 
+ *  operation takes a @c std::shared_ptr to the IO handler and the last one releases it,
+ *  so the IO handler lives until every operation has completed (or been destroyed along
+ *  with its @c io_context). While reads and writes follow one another the count never 
+ *  drops to zero, and no atomic operations are made.
+ *
+ *  Each completion handler captures an @c op_ref, which is move only. An @c op_ref must
+ *  be started and released within the strand of its tracker, so an IO handler that 
+ *  changes strands (see @c tcp_io migration) keeps one tracker per strand. Whether the
+ *  count has drained to zero can be queried from another thread.
+ *
+ *  @note For internal use only.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef OP_TRACKER_HPP_INCLUDED
+#define OP_TRACKER_HPP_INCLUDED
+
+#include <cstddef> // std::size_t
+#include <memory> // std::shared_ptr
+#include <utility> // std::move
+#include <atomic>
+
+namespace chops {
+namespace net {
+namespace detail {
+
+template <typename IOT>
+class op_tracker {
+public:
+
+  class op_ref {
+  private:
+    op_tracker*  m_tracker;
+
+  public:
+    op_ref(IOT& ioh, op_tracker& tracker) : m_tracker(&tracker) {
+      m_tracker->started(ioh);
+    }
+
+    op_ref(op_ref&& rhs) noexcept : m_tracker(rhs.m_tracker) { rhs.m_tracker = nullptr; }
+
+    op_ref& operator=(op_ref&& rhs) noexcept {
+      if (this != &rhs) {
+        release();
+        m_tracker = rhs.m_tracker;
+        rhs.m_tracker = nullptr;
+      }
+      return *this;
+    }
+
+    op_ref(const op_ref&) = delete;
+    op_ref& operator=(const op_ref&) = delete;
+
+    ~op_ref() { release(); }
+
+  private:
+    // may destroy the IO handler, so nothing is touched afterwards
+    void release() noexcept {
+      if (m_tracker) {
+        auto t = m_tracker;
+        m_tracker = nullptr;
+        t->finished();
+      }
+    }
+  };
+
+private:
+  std::size_t           m_num_ops;
+  std::shared_ptr<IOT>  m_ioh_ref;
+  std::atomic_bool      m_drained; // only stored when the count goes to or from zero
+
+public:
+
+  op_tracker() noexcept : m_num_ops(0u), m_ioh_ref(), m_drained(true) { }
+
+  op_tracker(const op_tracker&) = delete;
+  op_tracker& operator=(const op_tracker&) = delete;
+
+  op_ref start_op(IOT& ioh) { return op_ref(ioh, *this); }
+
+  std::size_t num_outstanding() const noexcept { return m_num_ops; }
+
+  // can be called from any thread
+  bool is_drained() const noexcept { return m_drained.load(std::memory_order_acquire); }
+
+private:
+
+  void started(IOT& ioh) {
+    if (m_num_ops == 0u) {
+      m_ioh_ref = ioh.shared_from_this();
+      m_drained.store(false, std::memory_order_relaxed);
+    }
+    ++m_num_ops;
+  }
+
+  // the IO handler (which owns this tracker) is destroyed here if nothing else refers to
+  // it; once drained is set the tracker may be destroyed by another thread, so it is the
+  // last member touched
+  void finished() noexcept {
+    if (--m_num_ops == 0u) {
+      auto last { std::move(m_ioh_ref) };
+      m_drained.store(true, std::memory_order_release);
+    }
+  }
+
+};
+
+} // end detail namespace
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -7,6 +7,9 @@
  *  The @c std::atomic counters allow the IO handler to update
  *  while the application queries the stats.
  *
+ *  Elements can have an expiry deadline, a conflation key and a priority lane, and
+ *  multi-part messages are returned by consecutive calls to @c get_next_element.
+ *
  *  @note For internal use only.
  *
  *  @author Cliff Green
@@ -21,76 +24,375 @@
 #ifndef OUTPUT_QUEUE_HPP_INCLUDED
 #define OUTPUT_QUEUE_HPP_INCLUDED
 
-#include <queue>
+#include <deque>
+#include <vector>
+#include <array>
 #include <atomic>
 #include <cstddef> // std::size_t
-#include <utility> // std::pair
+#include <cstdint> // std::uint8_t
+#include <utility> // std::pair, std::move
+#include <memory> // std::unique_ptr
 #include <optional>
+#include <variant>
+#include <chrono>
+#include <cstring> // std::memcmp
+#include <algorithm> // std::min
 
+#include "net_ip/detail/conflation_index.hpp"
 #include "net_ip/queue_stats.hpp"
+#include "net_ip/intrusive_buffer.hpp"
 #include "utility/shared_buffer.hpp"
 
 namespace chops {
 namespace net {
 namespace detail {
 
+using time_point = std::chrono::steady_clock::time_point;
+
+// default constructed time_point (clock epoch) is the "no expiry" flag
+constexpr time_point no_expiry { };
+
+// a buffer to be written is either a shared buffer or an intrusive buffer
+class out_buffer {
+private:
+  std::variant<chops::const_shared_buffer, intrusive_buffer> m_buf;
+
+public:
+  out_buffer(const chops::const_shared_buffer& buf) : m_buf(buf) { }
+  out_buffer(const intrusive_buffer& buf) noexcept : m_buf(buf) { }
+
+  const std::byte* data() const noexcept {
+    if (auto p = std::get_if<intrusive_buffer>(&m_buf)) {
+      return p->data();
+    }
+    return std::get<chops::const_shared_buffer>(m_buf).data();
+  }
+
+  std::size_t size() const noexcept {
+    if (auto p = std::get_if<intrusive_buffer>(&m_buf)) {
+      return p->size();
+    }
+    return std::get<chops::const_shared_buffer>(m_buf).size();
+  }
+
+  // bytes are compared, regardless of the kind of buffer
+  friend bool operator==(const out_buffer& lhs, const out_buffer& rhs) noexcept {
+    return lhs.size() == rhs.size() &&
+           (lhs.size() == 0u || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+  }
+
+  friend bool operator!=(const out_buffer& lhs, const out_buffer& rhs) noexcept {
+    return !(lhs == rhs);
+  }
+};
+
+// per element attributes supplied by the io handlers when queueing
+struct queue_attrs {
+  time_point                  expiry = no_expiry;
+  conflation_index::key_type  key = 0;
+  bool                        keyed = false;
+  std::size_t                 lane = 0;
+};
+
 template <typename E>
 class output_queue {
+public:
+  using key_type = conflation_index::key_type;
+
 private:
 
   using opt_endpoint = std::optional<E>;
-  using queue_element = std::pair<chops::const_shared_buffer, opt_endpoint>;
+  using queue_element = std::pair<out_buffer, opt_endpoint>;
+  using seq_type = conflation_index::seq_type;
+
+  // expiry, key and flags are not returned to the io handler
+  enum : std::uint8_t { has_endpoint = 0x01, keyed_elem = 0x02, more_parts = 0x04 };
+
+  struct stored_element {
+    out_buffer      buf;
+    time_point      expiry; // no_expiry if none
+    key_type        key;    // only meaningful if keyed_elem is set
+    E               endp;   // only meaningful if has_endpoint is set
+    std::uint8_t    flags;
+
+    stored_element(const out_buffer& b, opt_endpoint&& opt_endp, 
+                   const queue_attrs& attrs, bool parts_following) : 
+        buf(b), expiry(attrs.expiry), key(attrs.key), 
+        endp(opt_endp ? std::move(*opt_endp) : E()),
+        flags(static_cast<std::uint8_t>((opt_endp ? has_endpoint : 0) | 
+                                        (attrs.keyed ? keyed_elem : 0) |
+                                        (parts_following ? more_parts : 0))) { }
+
+    void replace(const out_buffer& b, opt_endpoint&& opt_endp, time_point exp) {
+      buf = b;
+      expiry = exp;
+      if (opt_endp) {
+        endp = std::move(*opt_endp);
+        flags |= has_endpoint;
+      }
+      else {
+        flags &= static_cast<std::uint8_t>(~has_endpoint);
+      }
+    }
+
+    queue_element release() {
+      return queue_element(std::move(buf), 
+                           (flags & has_endpoint) ? opt_endpoint(std::move(endp)) : opt_endpoint());
+    }
+  };
+
+  // served counts consecutive elements taken while lower lanes wait
+  struct lane {
+    std::deque<stored_element> elems;
+    seq_type                   front_seq = 0; // sequence number of front element
+    conflation_index           key_index;
+    std::size_t                served = 0;
+  };
+
+  // marks that no multi-part message is partially returned
+  static constexpr std::size_t no_lane = max_output_lanes;
+
+  struct lane_counters {
+    std::atomic_size_t  queue_size { 0 };
+    std::atomic_size_t  num_bytes { 0 };
+  };
+
+  // allocated on first use; lane 0 counts are the totals less the other lanes
+  struct extra_counters {
+    std::array<lane_counters, max_output_lanes - 1>   lower_lanes;
+    std::array<std::atomic_size_t, max_output_lanes>  weights { };
+    std::atomic_size_t                                expired_bufs { 0 };
+    std::atomic_size_t                                expired_bytes { 0 };
+    std::atomic_size_t                                conflated_bufs { 0 };
+  };
 
 private:
 
-  std::queue<queue_element> m_output_queue;
-  std::atomic_size_t        m_queue_size;
-  std::atomic_size_t        m_current_num_bytes;
-  // std::size_t               m_total_bufs_sent;
-  // std::size_t               m_total_bytes_sent;
+  // lanes are created on first use, so most queues only ever have one
+  std::vector<lane>                                m_lanes;
+  std::atomic<extra_counters*>                     m_extra; // owned, may be null
+  std::atomic_size_t                               m_queue_size;
+  std::atomic_size_t                               m_current_num_bytes;
+  std::size_t                                      m_part_lane;
 
 public:
   using opt_queue_element = std::optional<queue_element>;
 
 public:
 
-  output_queue() noexcept : m_output_queue(), m_queue_size(0), m_current_num_bytes(0) { }
+  output_queue() noexcept : m_lanes(), m_extra(nullptr), m_queue_size(0), m_current_num_bytes(0),
+                            m_part_lane(no_lane) { }
+
+  ~output_queue() { delete m_extra.load(); }
 
-  // io handlers call this method to get next buffer of data, can be empty
+  output_queue(const output_queue&) = delete;
+  output_queue& operator=(const output_queue&) = delete;
+
+  // io handlers call this method to get next buffer of data, can be empty; 
+  // expired elements are discarded
   opt_queue_element get_next_element() {
-    if (m_output_queue.empty()) {
-      return opt_queue_element { };
+    if (m_part_lane != no_lane) {
+      return opt_queue_element {pop_front(m_part_lane)};
     }
-    queue_element e = m_output_queue.front();
-    m_output_queue.pop();
-    --m_queue_size;
-    m_current_num_bytes -= e.first.size();
-    return opt_queue_element {e};
+    time_point now { };
+    bool clock_read = false;
+    std::size_t ln = 0;
+    while ((ln = select_lane()) < m_lanes.size()) {
+      stored_element& s = m_lanes[ln].elems.front();
+      if (s.expiry != no_expiry) {
+        if (!clock_read) { // only read the clock once per call
+          now = std::chrono::steady_clock::now();
+          clock_read = true;
+        }
+        if (now >= s.expiry) { // all parts of a multi-part message are discarded
+          extra_counters& ex = extra();
+          do {
+            auto e = pop_front(ln);
+            ++ex.expired_bufs;
+            ex.expired_bytes += e.first.size();
+          } while (m_part_lane != no_lane);
+          continue;
+        }
+      }
+      return opt_queue_element {pop_front(ln)};
+    }
+    return opt_queue_element { };
+  }
+
+  void add_element(const out_buffer& buf, 
+                   const queue_attrs& attrs = queue_attrs()) {
+    add_element(buf, opt_endpoint(), attrs);
   }
 
-  void add_element(const chops::const_shared_buffer& buf) {
-    add_element(buf, opt_endpoint());
+  // a keyed element replaces a queued element with the same key in place
+  void add_element(const out_buffer& buf, const E& endp, 
+                   const queue_attrs& attrs = queue_attrs()) {
+    add_element(buf, opt_endpoint(endp), attrs);
   }
 
-  void add_element(const chops::const_shared_buffer& buf, const E& endp) {
-    add_element(buf, opt_endpoint(endp));
+  // multi-part message, never separated or conflated, expiry applies to the whole
+  void add_element(const chops::const_shared_buffer* parts, std::size_t num_parts,
+                   const queue_attrs& attrs = queue_attrs()) {
+    if (num_parts == 0) {
+      return;
+    }
+    queue_attrs first_attrs { attrs.expiry, 0u, false, attrs.lane };
+    push_back(opt_endpoint(), parts[0], first_attrs, num_parts - 1);
+    queue_attrs rest_attrs { no_expiry, 0u, false, attrs.lane };
+    for (std::size_t i = 1; i < num_parts; ++i) {
+      push_back(opt_endpoint(), parts[i], rest_attrs, num_parts - 1 - i);
+    }
+  }
+
+  // true if the last element returned is a part of a multi-part message with more to come
+  bool mid_message() const noexcept { return m_part_lane != no_lane; }
+
+  // size of one queued element, used by the footprint tests
+  static constexpr std::size_t stored_element_size() noexcept { return sizeof(stored_element); }
+
+  // zero is strict priority, can be called concurrently
+  void set_lane_weight(std::size_t ln, std::size_t weight) {
+    if (weight == 0u && m_extra.load() == nullptr) {
+      return; // already strict priority
+    }
+    extra().weights[clamp_lane(ln)] = weight;
   }
 
+  std::size_t num_bytes() const noexcept { return m_current_num_bytes; }
+
+  // lane 0 gets what is left of the totals, which may be briefly off while elements
+  // are being added or removed
   chops::net::output_queue_stats get_queue_stats() const noexcept {
-    return chops::net::output_queue_stats { m_queue_size, m_current_num_bytes };
-    // return chops::net::output_queue_stats {
-    //   m_queue_size, m_current_num_bytes, m_total_bufs_sent, m_total_bytes_sent 
-    // };
+    chops::net::output_queue_stats qs { m_queue_size, m_current_num_bytes };
+    qs.lanes[0].output_queue_size = qs.output_queue_size;
+    qs.lanes[0].bytes_in_output_queue = qs.bytes_in_output_queue;
+    const extra_counters* ex = m_extra.load();
+    if (ex == nullptr) {
+      return qs;
+    }
+    qs.expired_bufs = ex->expired_bufs;
+    qs.expired_bytes = ex->expired_bytes;
+    qs.conflated_bufs = ex->conflated_bufs;
+    for (std::size_t i = 1; i < max_output_lanes; ++i) {
+      auto& ln = qs.lanes[i];
+      ln.output_queue_size = ex->lower_lanes[i - 1].queue_size;
+      ln.bytes_in_output_queue = ex->lower_lanes[i - 1].num_bytes;
+      qs.lanes[0].output_queue_size -= std::min(ln.output_queue_size, 
+                                                qs.lanes[0].output_queue_size);
+      qs.lanes[0].bytes_in_output_queue -= std::min(ln.bytes_in_output_queue, 
+                                                    qs.lanes[0].bytes_in_output_queue);
+    }
+    return qs;
   }
 
 private:
 
-  void add_element(const chops::const_shared_buffer& buf, opt_endpoint&& opt_endp) {
-    m_output_queue.push(queue_element(buf, opt_endp));
+  static std::size_t clamp_lane(std::size_t ln) noexcept {
+    return ln < max_output_lanes ? ln : max_output_lanes - 1;
+  }
+
+  // the weights can be set from any thread, so the first allocation is a race
+  extra_counters& extra() {
+    extra_counters* p = m_extra.load();
+    if (p == nullptr) {
+      auto np = std::make_unique<extra_counters>();
+      if (m_extra.compare_exchange_strong(p, np.get())) {
+        p = np.release();
+      }
+    }
+    return *p;
+  }
+
+  // null for lane 0, which is not counted separately
+  lane_counters* counters_for(std::size_t ln) {
+    return ln == 0u ? nullptr : &extra().lower_lanes[ln - 1];
+  }
+
+  void add_element(const out_buffer& buf, opt_endpoint&& opt_endp,
+                   const queue_attrs& attrs) {
+    std::size_t ln = clamp_lane(attrs.lane);
+    if (ln >= m_lanes.size()) {
+      m_lanes.resize(ln + 1);
+    }
+    lane& l = m_lanes[ln];
+    if (attrs.keyed) {
+      if (seq_type* seq = l.key_index.find(attrs.key)) {
+        stored_element& s = l.elems[static_cast<std::size_t>(*seq - l.front_seq)];
+        m_current_num_bytes += buf.size();
+        m_current_num_bytes -= s.buf.size();
+        if (lane_counters* lc = counters_for(ln)) {
+          lc->num_bytes += buf.size();
+          lc->num_bytes -= s.buf.size();
+        }
+        s.replace(buf, std::move(opt_endp), attrs.expiry);
+        ++extra().conflated_bufs;
+        return;
+      }
+      l.key_index.insert(attrs.key, l.front_seq + l.elems.size());
+    }
+    push_back(std::move(opt_endp), buf, attrs, 0u);
+  }
+
+  void push_back(opt_endpoint&& opt_endp, const out_buffer& buf, 
+                 const queue_attrs& attrs, std::size_t parts_following) {
+    std::size_t ln = clamp_lane(attrs.lane);
+    if (ln >= m_lanes.size()) {
+      m_lanes.resize(ln + 1);
+    }
+    m_lanes[ln].elems.emplace_back(buf, std::move(opt_endp), attrs, parts_following != 0);
     ++m_queue_size;
     m_current_num_bytes += buf.size(); // note - possible integer overflow
-    // ++m_total_bufs_sent;
-    // m_total_bytes_sent += buf.size();
+    if (lane_counters* lc = counters_for(ln)) {
+      ++lc->queue_size;
+      lc->num_bytes += buf.size();
+    }
+  }
+
+  // returns m_lanes.size() if all lanes are empty
+  std::size_t select_lane() noexcept {
+    const extra_counters* ex = m_extra.load();
+    std::size_t first = m_lanes.size();
+    for (std::size_t i = 0; i < m_lanes.size(); ++i) {
+      if (m_lanes[i].elems.empty()) {
+        m_lanes[i].served = 0;
+        continue;
+      }
+      if (first == m_lanes.size()) {
+        first = i;
+        std::size_t weight = ex ? ex->weights[i].load() : 0u;
+        if (weight == 0 || m_lanes[i].served < weight) {
+          break; // strict priority, or lane still has turns left
+        }
+        continue; // turn used up, give a lower lane a chance
+      }
+      // lower lane gets one element, higher lane starts a new turn
+      m_lanes[first].served = 0;
+      return i;
+    }
+    if (first < m_lanes.size()) {
+      ++m_lanes[first].served;
+    }
+    return first;
+  }
+
+  queue_element pop_front(std::size_t ln) {
+    lane& l = m_lanes[ln];
+    stored_element& s = l.elems.front();
+    if (s.flags & keyed_elem) {
+      l.key_index.erase(s.key);
+    }
+    std::size_t sz = s.buf.size();
+    --m_queue_size;
+    m_current_num_bytes -= sz;
+    if (lane_counters* lc = counters_for(ln)) {
+      --lc->queue_size;
+      lc->num_bytes -= sz;
+    }
+    m_part_lane = (s.flags & more_parts) ? ln : no_lane;
+    queue_element e = s.release();
+    l.elems.pop_front();
+    ++l.front_seq;
+    return e;
   }
 
 };
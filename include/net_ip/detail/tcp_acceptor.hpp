@@ -26,19 +26,64 @@
 #include <vector>
 #include <utility> // std::move, std::forward
 #include <cstddef> // for std::size_t
-#include <functional> // std::bind
+#include <functional> // std::function
+#include <atomic>
+#include <cstdlib> // std::abs
+#include <stdexcept> // std::length_error
 
 #include "net_ip/detail/tcp_io.hpp"
 #include "net_ip/detail/net_entity_common.hpp"
+#include "net_ip/detail/io_executor.hpp"
 
 #include "net_ip/io_interface.hpp"
+#include "net_ip/queue_stats.hpp"
 
 #include "utility/erase_where.hpp"
 
 namespace chops {
 namespace net {
+
+/**
+ *  @brief An @c io_context and the CPU that the thread running it is pinned to, used
+ *  for CPU-affine placement of accepted TCP connections.
+ */
+struct cpu_placement {
+  asio::io_context*   ioc;
+  int                 cpu;
+};
+
+/**
+ *  @brief A function object that picks the @c io_context for an accepted TCP connection,
+ *  given the CPU processing its incoming packets (or -1 if not available); returning
+ *  @c nullptr leaves the connection on the acceptor's @c io_context.
+ */
+using connection_placement_func = std::function<asio::io_context* (int)>;
+
 namespace detail {
 
+#if defined(SO_INCOMING_CPU)
+// the CPU that processed the most recent packets of the connection; asio does not 
+// provide this option, so it is written as a model of the asio GettableSocketOption 
+// requirements
+class incoming_cpu_option {
+public:
+  int value() const noexcept { return m_value; }
+
+  template <typename Protocol> int level(const Protocol&) const noexcept { return SOL_SOCKET; }
+  template <typename Protocol> int name(const Protocol&) const noexcept { return SO_INCOMING_CPU; }
+  template <typename Protocol> int* data(const Protocol&) noexcept { return &m_value; }
+  template <typename Protocol> const int* data(const Protocol&) const noexcept { return &m_value; }
+  template <typename Protocol> std::size_t size(const Protocol&) const noexcept { return sizeof(m_value); }
+  template <typename Protocol> void resize(const Protocol&, std::size_t s) {
+    if (s != sizeof(m_value)) {
+      throw std::length_error("incoming_cpu_option resize");
+    }
+  }
+private:
+  int  m_value { -1 };
+};
+#endif
+
 class tcp_acceptor : public std::enable_shared_from_this<tcp_acceptor> {
 public:
   using socket_type = asio::ip::tcp::acceptor;
@@ -48,15 +93,36 @@ private:
   net_entity_common<tcp_io>  m_entity_common;
   asio::io_context&          m_io_context;
   socket_type                m_acceptor;
+  io_executor                m_io_exec; // m_io_handlers is only accessed through this
   std::vector<tcp_io_ptr>    m_io_handlers;
+  // one notifier for all of the IO handlers instead of one per connection
+  tcp_io::entity_notifier_ptr m_notifier;
+  tcp_io_pool                m_io_pool; // recycled IO handler memory, if enabled
+  std::atomic_bool           m_accepting; // cleared in the strand once the acceptor is closed
   endpoint_type              m_acceptor_endp;
   bool                       m_reuse_addr;
+  // when not empty each accepted connection is moved to one of these io_contexts
+  std::vector<cpu_placement> m_placements;
+  connection_placement_func  m_placement_func; // used instead of m_placements if set
+  std::size_t                m_next_placement; // round-robin fallback
+  std::atomic_size_t         m_total_placed;
+  std::atomic_size_t         m_placed_local;
+  std::atomic_size_t         m_placed_nearest;
+  std::atomic_size_t         m_placed_round_robin;
+  std::atomic_size_t         m_placement_failures;
 
 public:
   tcp_acceptor(asio::io_context& ioc, const endpoint_type& endp,
-               bool reuse_addr) :
-    m_entity_common(), m_io_context(ioc), m_acceptor(ioc), m_io_handlers(), m_acceptor_endp(endp), 
-    m_reuse_addr(reuse_addr) { }
+               bool reuse_addr, std::vector<cpu_placement> placements = { }) :
+    m_entity_common(), m_io_context(ioc), m_acceptor(ioc), 
+    m_io_exec(make_io_executor(ioc.get_executor())), m_io_handlers(), m_notifier(), 
+    m_io_pool(), m_accepting(false), m_acceptor_endp(endp), m_reuse_addr(reuse_addr), m_placements(std::move(placements)), m_placement_func(),
+    m_next_placement(0u), m_total_placed(0u), m_placed_local(0u), m_placed_nearest(0u),
+    m_placed_round_robin(0u), m_placement_failures(0u) { }
+
+  tcp_acceptor(asio::io_context& ioc, const endpoint_type& endp,
+               bool reuse_addr, connection_placement_func placement_func) :
+    tcp_acceptor(ioc, endp, reuse_addr) { m_placement_func = std::move(placement_func); }
 
 private:
   // no copy or assignment semantics for this class
@@ -71,12 +137,30 @@ public:
 
   socket_type& get_socket() noexcept { return m_acceptor; }
 
+  placement_stats get_placement_stats() const noexcept {
+    return placement_stats { m_total_placed.load(), m_placed_local.load(), m_placed_nearest.load(),
+                             m_placed_round_robin.load(), m_placement_failures.load() };
+  }
+
+  // must be called before start, since the pool is used without locking; after a stop
+  // an accept completion may still be running until the close has run in the strand
+  bool enable_io_pool(std::size_t num_prealloc, std::size_t max_free) {
+    if (is_started() || m_accepting) {
+      return false;
+    }
+    m_io_pool = tcp_io_pool(num_prealloc, max_free);
+    return true;
+  }
+
+  object_pool_stats get_io_pool_stats() const { return m_io_pool.get_stats(); }
+
   template <typename F1, typename F2>
   bool start(F1&& io_state_chg, F2&& err_func) {
     if (!m_entity_common.start(std::forward<F1>(io_state_chg), std::forward<F2>(err_func))) {
       // already started
       return false;
     }
+    m_accepting = true;
     try {
       m_acceptor = socket_type(m_io_context, m_acceptor_endp, m_reuse_addr);
     }
@@ -85,7 +169,17 @@ public:
       stop();
       return false;
     }
-    start_accept();
+    // the notifier doesn't keep the acceptor alive, otherwise the acceptor would own itself
+    std::weak_ptr<tcp_acceptor> weak_self = weak_from_this();
+    m_notifier = std::make_shared<const tcp_io::entity_notifier_cb>(
+      [weak_self] (std::error_code err, tcp_io_ptr iop) {
+        if (auto self = weak_self.lock()) {
+          self->notify_me(err, iop);
+        }
+      }
+    );
+    auto self = shared_from_this();
+    asio::dispatch(m_io_exec, [this, self] { start_accept(); } );
     return true;
   }
 
@@ -93,44 +187,132 @@ public:
     if (!m_entity_common.stop()) {
       return false; // stop already called
     }
-    auto iohs = m_io_handlers;
-    for (auto i : iohs) {
-      i->stop_io();
-    }
-    // m_io_handlers.clear(); // the stop_io on each tcp_io handler should clear the container
-    m_entity_common.call_error_cb(tcp_io_ptr(), std::make_error_code(net_ip_errc::tcp_acceptor_stopped));
-    std::error_code ec;
-    m_acceptor.close(ec);
+    // the IO handler container and acceptor are only touched within the strand
+    auto self = shared_from_this();
+    asio::dispatch(m_io_exec, [this, self] {
+        auto iohs = m_io_handlers;
+        for (auto i : iohs) {
+          i->stop_io();
+        }
+        // m_io_handlers.clear(); // the stop_io on each tcp_io handler should clear the container
+        m_entity_common.call_error_cb(tcp_io_ptr(), 
+                                      std::make_error_code(net_ip_errc::tcp_acceptor_stopped));
+        std::error_code ec;
+        m_acceptor.close(ec);
+        m_accepting = false;
+      }
+    );
     return true;
   }
 
 private:
 
   void start_accept() {
-    using namespace std::placeholders;
-
     auto self = shared_from_this();
-    m_acceptor.async_accept( [this, self] 
+    m_acceptor.async_accept( asio::bind_executor(m_io_exec, [this, self] 
             (const std::error_code& err, asio::ip::tcp::socket sock) mutable {
         if (err) {
           m_entity_common.call_error_cb(tcp_io_ptr(), err);
           stop(); // is this the right thing to do? what are possible causes of errors?
           return;
         }
-        tcp_io_ptr iop = std::make_shared<tcp_io>(std::move(sock), 
-          tcp_io::entity_notifier_cb(std::bind(&tcp_acceptor::notify_me, shared_from_this(), _1, _2)));
+        if (!m_accepting) { // accepted just before the acceptor was closed
+          return;
+        }
+        if (!m_placements.empty() || m_placement_func) {
+          place(sock);
+        }
+        tcp_io_ptr iop = m_io_pool.make_shared(std::move(sock), m_notifier);
         m_io_handlers.push_back(iop);
         m_entity_common.call_io_state_chg_cb(iop, m_io_handlers.size(), true);
         start_accept();
-      }
+      } )
     );
   }
 
+  // pick the io_context pinned to the CPU the connection's packets are processed on, 
+  // or the nearest CPU (adjacent CPU numbers usually share a package), or round-robin 
+  // if the incoming CPU is not available
+  std::size_t choose_placement(int in_cpu) {
+    ++m_total_placed;
+    if (in_cpu >= 0) {
+      std::size_t best = 0u;
+      for (std::size_t i = 1u; i < m_placements.size(); ++i) {
+        if (std::abs(m_placements[i].cpu - in_cpu) < std::abs(m_placements[best].cpu - in_cpu)) {
+          best = i;
+        }
+      }
+      if (m_placements[best].cpu == in_cpu) {
+        ++m_placed_local;
+      }
+      else {
+        ++m_placed_nearest;
+      }
+      return best;
+    }
+    ++m_placed_round_robin;
+    return m_next_placement++ % m_placements.size();
+  }
+
+  int incoming_cpu(asio::ip::tcp::socket& sock) {
+#if defined(SO_INCOMING_CPU)
+    incoming_cpu_option opt;
+    std::error_code ec;
+    sock.get_option(opt, ec);
+    if (!ec) {
+      return opt.value();
+    }
+#endif
+    return -1;
+  }
+
+  // the accepted socket is moved to the chosen io_context before the IO handler is 
+  // created, so all of its handlers run there; if the socket can't be moved it stays on
+  // the acceptor io_context
+  void place(asio::ip::tcp::socket& sock) {
+    asio::io_context* iocp = nullptr;
+    if (m_placement_func) {
+      ++m_total_placed;
+      iocp = m_placement_func(incoming_cpu(sock));
+    }
+    else {
+      iocp = m_placements[choose_placement(incoming_cpu(sock))].ioc;
+    }
+    if (!iocp || iocp == &m_io_context) {
+      return;
+    }
+    asio::io_context& ioc = *iocp;
+    std::error_code ec;
+    auto protocol = sock.local_endpoint(ec).protocol();
+    if (ec) {
+      ++m_placement_failures;
+      return;
+    }
+    auto handle = sock.release(ec);
+    if (ec) { // not supported on some platforms
+      ++m_placement_failures;
+      return;
+    }
+    asio::ip::tcp::socket placed(ioc);
+    placed.assign(protocol, handle, ec);
+    if (ec) {
+      ++m_placement_failures;
+      sock.assign(protocol, handle, ec); // back where it came from
+      return;
+    }
+    sock = std::move(placed);
+  }
+
+  // called from the IO handler strand or from an application thread (stop_io)
   void notify_me(std::error_code err, tcp_io_ptr iop) {
-    iop->close();
-    m_entity_common.call_error_cb(iop, err);
-    chops::erase_where(m_io_handlers, iop);
-    m_entity_common.call_io_state_chg_cb(iop, m_io_handlers.size(), false);
+    auto self = shared_from_this();
+    asio::dispatch(m_io_exec, [this, self, err, iop] {
+        iop->close();
+        m_entity_common.call_error_cb(iop, err);
+        chops::erase_where(m_io_handlers, iop);
+        m_entity_common.call_io_state_chg_cb(iop, m_io_handlers.size(), false);
+      }
+    );
   }
 
 };
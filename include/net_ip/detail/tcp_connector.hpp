@@ -33,11 +33,11 @@
 
 #include "net_ip/detail/tcp_io.hpp"
 #include "net_ip/detail/net_entity_common.hpp"
+#include "net_ip/detail/io_executor.hpp"
 
 #include "net_ip/endpoints_resolver.hpp"
 #include "net_ip/io_interface.hpp"
-
-#include <cassert>
+#include "net_ip/queue_stats.hpp"
 
 namespace chops {
 namespace net {
@@ -56,8 +56,10 @@ private:
 
 private:
   net_entity_common<tcp_io>     m_entity_common;
+  io_executor                   m_io_exec; // all handlers run through this
   socket_type                   m_socket;
   tcp_io_ptr                    m_io_handler;
+  tcp_io_pool                   m_io_pool; // recycled IO handler memory, if enabled
   resolver_type                 m_resolver;
   endpoints                     m_endpoints;
   asio::steady_timer            m_timer;
@@ -75,8 +77,10 @@ public:
   tcp_connector(asio::io_context& ioc, 
                 Iter beg, Iter end, std::chrono::milliseconds reconn_time) :
       m_entity_common(),
+      m_io_exec(make_io_executor(ioc.get_executor())),
       m_socket(ioc),
       m_io_handler(),
+      m_io_pool(),
       m_resolver(ioc),
       m_endpoints(beg, end),
       m_timer(ioc),
@@ -90,8 +94,10 @@ public:
                 std::string_view remote_port, std::string_view remote_host, 
                 std::chrono::milliseconds reconn_time) :
       m_entity_common(),
+      m_io_exec(make_io_executor(ioc.get_executor())),
       m_socket(ioc),
       m_io_handler(),
+      m_io_pool(),
       m_resolver(ioc),
       m_endpoints(),
       m_timer(ioc),
@@ -114,51 +120,56 @@ public:
 
   socket_type& get_socket() noexcept { return m_socket; }
 
+  // must be called before start, since the pool is used without locking
+  bool enable_io_pool(std::size_t num_prealloc, std::size_t max_free) {
+    if (is_started()) {
+      return false;
+    }
+    m_io_pool = tcp_io_pool(num_prealloc, max_free);
+    return true;
+  }
+
+  object_pool_stats get_io_pool_stats() const { return m_io_pool.get_stats(); }
+
   template <typename F1, typename F2>
   bool start(F1&& io_state_chg, F2&& err_cb) {
     if (!m_entity_common.start(std::forward<F1>(io_state_chg), std::forward<F2>(err_cb))) {
       // already started
       return false;
     }
-    m_shutting_down = false;
-    // empty endpoints container is the flag that a resolve is needed
-    if (m_endpoints.empty()) {
-      auto self = shared_from_this();
-      m_resolver.make_endpoints(false, m_remote_host, m_remote_port,
-        [this, self] 
-             (std::error_code err, resolver_results res) mutable {
-          if (err) {
-            m_entity_common.call_error_cb(tcp_io_ptr(), err);
-            m_entity_common.stop();
-            return;
-          }
-          for (const auto& e : res) {
-            m_endpoints.push_back(e.endpoint());
-          }
-          start_connect();
+    auto self = shared_from_this();
+    asio::dispatch(m_io_exec, [this, self] {
+        m_shutting_down = false;
+        // empty endpoints container is the flag that a resolve is needed
+        if (m_endpoints.empty()) {
+          start_resolve();
+          return;
         }
-      );
-      return true;
-    }
-    start_connect();
+        start_connect();
+      }
+    );
     return true;
   }
 
   bool stop() {
-    if (!close()) {
-      return false;
+    if (!m_entity_common.stop()) {
+      return false; // stop already called
     }
-    m_entity_common.call_error_cb(tcp_io_ptr(), std::make_error_code(net_ip_errc::tcp_connector_stopped));
+    // the sockets, timer and resolver are only touched within the strand
+    auto self = shared_from_this();
+    asio::dispatch(m_io_exec, [this, self] {
+        close();
+        m_entity_common.call_error_cb(tcp_io_ptr(), 
+                                      std::make_error_code(net_ip_errc::tcp_connector_stopped));
+      }
+    );
     return true;
   }
 
 
 private:
 
-  bool close() {
-    if (!m_entity_common.stop()) {
-      return false; // stop already called
-    }
+  void close() {
     m_shutting_down = true;
     if (m_endpoints.empty()) { // may be in middle of resolve
       m_resolver.cancel();
@@ -176,16 +187,33 @@ private:
     }
     std::error_code ec;
     m_socket.close(ec);
-    return true;
+  }
+
+  void start_resolve() {
+    auto self = shared_from_this();
+    m_resolver.make_endpoints(false, m_remote_host, m_remote_port,
+      asio::bind_executor(m_io_exec, [this, self] 
+           (std::error_code err, resolver_results res) mutable {
+        if (err) {
+          m_entity_common.call_error_cb(tcp_io_ptr(), err);
+          m_entity_common.stop();
+          return;
+        }
+        for (const auto& e : res) {
+          m_endpoints.push_back(e.endpoint());
+        }
+        start_connect();
+      } )
+    );
   }
 
   void start_connect() {
     auto self = shared_from_this();
     asio::async_connect(m_socket, m_endpoints.cbegin(), m_endpoints.cend(),
-          [this, self] 
+          asio::bind_executor(m_io_exec, [this, self] 
                 (const std::error_code& err, endpoints_iter iter) mutable {
         handle_connect(err, iter);
-      }
+      } )
     );
   }
 
@@ -207,27 +235,33 @@ private:
         return;
       }
       auto self = shared_from_this();
-      m_timer.async_wait( [this, self] 
+      m_timer.async_wait( asio::bind_executor(m_io_exec, [this, self] 
                           (const std::error_code& err) mutable {
           if (!err) {
             start_connect();
           }
-        }
+        } )
       );
       return;
     }
-    m_io_handler = std::make_shared<tcp_io>(std::move(m_socket), 
+    m_io_handler = m_io_pool.make_shared(std::move(m_socket), 
       tcp_io::entity_notifier_cb(std::bind(&tcp_connector::notify_me, shared_from_this(), _1, _2)));
     m_entity_common.call_io_state_chg_cb(m_io_handler, 1, true);
   }
 
+  // called from the IO handler strand or from an application thread (stop_io)
   void notify_me(std::error_code err, tcp_io_ptr iop) {
-    assert (iop == m_io_handler);
-
-    iop->close();
-    m_entity_common.call_error_cb(iop, err);
-    m_entity_common.call_io_state_chg_cb(iop, 0, false);
-    stop();
+    auto self = shared_from_this();
+    asio::dispatch(m_io_exec, [this, self, err, iop] {
+        if (iop != m_io_handler) { // already closed by stop, e.g. an aborted read
+          return;
+        }
+        iop->close();
+        m_entity_common.call_error_cb(iop, err);
+        m_entity_common.call_io_state_chg_cb(iop, 0, false);
+        stop();
+      }
+    );
   }
 
 };
@@ -23,23 +23,38 @@
 #include "asio/read.hpp"
 #include "asio/read_until.hpp"
 #include "asio/write.hpp"
+#include "asio/steady_timer.hpp"
 #include "asio/ip/tcp.hpp"
 #include "asio/buffer.hpp"
+#include "asio/error.hpp"
+#include "asio/detail/socket_ops.hpp"
 
-#include <memory> // std::shared_ptr, std::enable_shared_from_this
+#include <algorithm> // std::copy
+#include <memory> // std::shared_ptr, std::enable_shared_from_this, std::unique_ptr
 #include <system_error>
 
 #include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
 #include <utility> // std::forward, std::move
+#include <type_traits> // std::decay_t
 #include <string>
+#include <vector>
+#include <array>
 #include <string_view>
 #include <functional>
+#include <chrono>
+#include <list>
+#include <atomic>
 
 #include "net_ip/detail/output_queue.hpp"
 #include "net_ip/detail/io_common.hpp"
+#include "net_ip/detail/io_executor.hpp"
+#include "net_ip/detail/object_pool.hpp"
+#include "net_ip/detail/op_tracker.hpp"
 #include "net_ip/queue_stats.hpp"
 #include "net_ip/net_ip_error.hpp"
 #include "net_ip/basic_io_interface.hpp"
+#include "net_ip/intrusive_buffer.hpp"
 #include "utility/shared_buffer.hpp"
 
 namespace chops {
@@ -53,15 +68,75 @@ public:
   using socket_type = asio::ip::tcp::socket;
   using endpoint_type = asio::ip::tcp::endpoint;
   using entity_notifier_cb = std::function<void (std::error_code, std::shared_ptr<tcp_io>)>;
+  // a net entity with many IO handlers (i.e. an acceptor) shares one notifier between them
+  using entity_notifier_ptr = std::shared_ptr<const entity_notifier_cb>;
+  using write_complete_cb = io_common<tcp_io>::write_complete_cb;
 
 private:
   using byte_vec = chops::mutable_shared_buffer::byte_vec;
+  using duration = std::chrono::steady_clock::duration;
+
+  // limit on buffers in one gathered write, the asio scatter / gather limit
+  static constexpr std::size_t max_gather_bufs = 64;
+
+  // bytes read inline at a time when looking for a delimiter
+  static constexpr std::size_t inline_read_size = 4096;
+
+  // bytes read at a time for batch delivery
+  static constexpr std::size_t batch_read_size = 16384;
+
+  // write coalescing and migration state is only allocated when first used; the 
+  // generation keeps a stale timer completion from closing the next window
+  struct coalesce_state {
+    asio::steady_timer                     timer;
+    std::chrono::steady_clock::time_point  start;
+    std::uint64_t                          generation;
+    bool                                   armed;
+
+    explicit coalesce_state(const socket_type::executor_type& ex) : 
+      timer(ex), start(), generation(0u), armed(false) { }
+  };
+
+  // move only, so std::function can't be used
+  struct parked_read_base {
+    virtual ~parked_read_base() = default;
+    virtual void resume() = 0;
+  };
+
+  template <typename F>
+  struct parked_read_impl : parked_read_base {
+    F  func;
+    explicit parked_read_impl(F&& f) : func(std::move(f)) { }
+    void resume() override { func(); }
+  };
+
+  // a strand and the operations outstanding on it, only touched within the strand
+  struct strand_slot {
+    io_executor         exec;
+    std::uint64_t       gen;
+    std::uint64_t       retired; // reader epoch when it stopped being current
+    op_tracker<tcp_io>  ops;
+    strand_slot(io_executor ex, std::uint64_t g) : exec(std::move(ex)), gen(g), retired(0u), ops() { }
+  };
+
+  struct migrate_state {
+    asio::io_context*                  ioc = nullptr;
+    std::unique_ptr<parked_read_base>  parked_read;
+    bool                               write_parked = false;
+    std::size_t                        parked_write_bytes = 0;
+  };
 
 private:
 
   socket_type            m_socket;
+  // all handlers run through the current strand, see io_executor
+  std::list<strand_slot>       m_strands;
+  std::atomic<strand_slot*>    m_strand_ptr;
+  std::atomic<std::uint64_t>   m_strand_gen;
+  std::atomic<std::uint64_t>   m_reader_epoch; // see strand_user
+  mutable std::array<std::atomic_size_t, 2>  m_strand_users;
   io_common<tcp_io>      m_io_common;
-  entity_notifier_cb     m_notifier_cb;
+  entity_notifier_ptr    m_notifier_cb;
   endpoint_type          m_remote_endp;
 
   // the following members are only used for read processing; they could be 
@@ -69,14 +144,47 @@ private:
   // copying or moving
   byte_vec               m_byte_vec;
   std::size_t            m_read_size;
-  std::string            m_delimiter;
+  std::unique_ptr<const std::string>  m_delimiter; // only allocated for delimited reads
+  std::size_t            m_spec_read_budget; // inline reads per async read completion
+  std::size_t            m_spec_reads_left;
+  std::vector<asio::const_buffer>  m_batch_bufs; // message views for batch delivery
+  std::size_t            m_batch_used; // bytes in m_byte_vec not yet delivered
+  std::size_t            m_batch_pos;  // framing position within a partial message
+  std::size_t            m_batch_need; // bytes needed for the next msg_frame call
+
+  // the following members are only used for write processing; the buffers
+  // are kept until the (possibly gathered) write completes
+  std::vector<out_buffer>                  m_write_bufs;
+  std::vector<asio::const_buffer>          m_gather_bufs;
+  duration                                 m_coalesce_delay;
+  std::size_t                              m_coalesce_bytes;
+  std::unique_ptr<coalesce_state>          m_coalesce;
+  bool                                     m_speculative_write;
+
+  // the following members are used when migrating to another io_context
+  bool                                     m_read_outstanding;
+  bool                                     m_write_outstanding;
+  std::unique_ptr<migrate_state>           m_migrate;
 
 public:
 
-  tcp_io(socket_type sock, entity_notifier_cb cb) noexcept : 
-    m_socket(std::move(sock)), m_io_common(), 
-    m_notifier_cb(cb), m_remote_endp(),
-    m_byte_vec(), m_read_size(0), m_delimiter() { }
+  tcp_io(socket_type sock, entity_notifier_ptr notifier) : 
+    m_socket(std::move(sock)), m_strands(), m_strand_ptr(nullptr), m_strand_gen(0u),
+    m_reader_epoch(0u), m_strand_users(),
+    m_io_common(), 
+    m_notifier_cb(std::move(notifier)), m_remote_endp(),
+    m_byte_vec(), m_read_size(0), m_delimiter(), m_spec_read_budget(0), m_spec_reads_left(0),
+    m_batch_bufs(), m_batch_used(0), m_batch_pos(0), m_batch_need(0),
+    m_write_bufs(), m_gather_bufs(), 
+    m_coalesce_delay(duration::zero()), m_coalesce_bytes(0), m_coalesce(), 
+    m_speculative_write(false),
+    m_read_outstanding(false), m_write_outstanding(false), m_migrate() {
+    m_strands.emplace_back(make_io_executor(m_socket.get_executor()), 0u);
+    m_strand_ptr = &m_strands.back();
+  }
+
+  tcp_io(socket_type sock, entity_notifier_cb cb) :
+    tcp_io(std::move(sock), std::make_shared<const entity_notifier_cb>(std::move(cb))) { }
 
 private:
   // no copy or assignment semantics for this class
@@ -93,27 +201,49 @@ public:
     return m_io_common.get_output_queue_stats();
   }
 
+  input_stats get_input_stats() const noexcept {
+    return m_io_common.get_input_stats();
+  }
+
   bool is_io_started() const noexcept { return m_io_common.is_io_started(); }
 
+  // the first read is started through the strand, since start_io can be called from
+  // any thread
   template <typename MH, typename MF>
   bool start_io(std::size_t header_size, MH&& msg_handler, MF&& msg_frame) {
-    if (!start_io_setup()) {
+    if (!m_io_common.set_io_started()) { // concurrency protected
       return false;
     }
-    m_read_size = header_size;
-    m_byte_vec.resize(m_read_size);
-    start_read(asio::mutable_buffer(m_byte_vec.data(), m_byte_vec.size()),
-               std::forward<MH>(msg_handler), std::forward<MF>(msg_frame));
+    auto self { shared_from_this() };
+    dispatch_in_strand([this, self, header_size, mh = std::forward<MH>(msg_handler),
+                               mf = std::forward<MF>(msg_frame)] () mutable {
+        if (!start_io_setup()) {
+          return;
+        }
+        m_read_size = header_size;
+        m_byte_vec.resize(m_read_size);
+        start_read(asio::mutable_buffer(m_byte_vec.data(), m_byte_vec.size()),
+                   std::move(mh), std::move(mf));
+      }
+    );
     return true;
   }
 
   template <typename MH>
   bool start_io(std::string_view delimiter, MH&& msg_handler) {
-    if (!start_io_setup()) {
+    if (!m_io_common.set_io_started()) { // concurrency protected
       return false;
     }
-    m_delimiter = delimiter;
-    start_read_until(std::forward<MH>(msg_handler));
+    auto self { shared_from_this() };
+    dispatch_in_strand([this, self, delim = std::string(delimiter), 
+                               mh = std::forward<MH>(msg_handler)] () mutable {
+        if (!start_io_setup()) {
+          return;
+        }
+        m_delimiter = std::make_unique<const std::string>(std::move(delim));
+        start_read_until(std::move(mh));
+      }
+    );
     return true;
   }
 
@@ -122,6 +252,45 @@ public:
     return start_io(read_size, std::forward<MH>(msg_handler), null_msg_frame);
   }
 
+  // batch delivery, the handler is invoked once per read with all of the messages
+  // framed from it; a zero header size or an empty delimiter is rejected
+  template <typename MH, typename MF>
+  bool start_io_batch(std::size_t header_size, MH&& batch_handler, MF&& msg_frame) {
+    if (header_size == 0u || !m_io_common.set_io_started()) { // concurrency protected
+      return false;
+    }
+    auto self { shared_from_this() };
+    dispatch_in_strand([this, self, header_size, mh = std::forward<MH>(batch_handler),
+                               mf = std::forward<MF>(msg_frame)] () mutable {
+        if (!start_io_setup()) {
+          return;
+        }
+        m_read_size = header_size;
+        m_batch_need = header_size;
+        start_batch_read(std::move(mh), std::move(mf));
+      }
+    );
+    return true;
+  }
+
+  template <typename MH>
+  bool start_io_batch(std::string_view delimiter, MH&& batch_handler) {
+    if (delimiter.empty() || !m_io_common.set_io_started()) { // concurrency protected
+      return false;
+    }
+    auto self { shared_from_this() };
+    dispatch_in_strand([this, self, delim = std::string(delimiter), 
+                               mh = std::forward<MH>(batch_handler)] () mutable {
+        if (!start_io_setup()) {
+          return;
+        }
+        m_delimiter = std::make_unique<const std::string>(std::move(delim));
+        start_batch_read(std::move(mh), null_msg_frame);
+      }
+    );
+    return true;
+  }
+
   bool start_io() {
     return start_io(1, 
                     [] (asio::const_buffer, basic_io_interface<tcp_io>, 
@@ -136,29 +305,148 @@ public:
   bool stop_io() {
     if (is_io_started()) {
       // causes net entity to eventually call close
-      m_notifier_cb(std::make_error_code(net_ip_errc::tcp_io_handler_stopped), 
+      (*m_notifier_cb)(std::make_error_code(net_ip_errc::tcp_io_handler_stopped), 
                     shared_from_this());
       return true;
     }
     return false;
   }
 
-  // use post for thread safety, multiple threads can call this method
-  void send(chops::const_shared_buffer buf) {
+  void set_output_max_age(std::chrono::steady_clock::duration max_age) noexcept {
+    m_io_common.set_max_age(max_age);
+  }
+
+  void set_output_lane_weight(std::size_t lane, std::size_t weight) {
+    m_io_common.set_lane_weight(lane, weight);
+  }
+
+  // use post for thread safety, the callback is invoked from within the run thread
+  void set_write_completion_handler(write_complete_cb cb) {
     auto self { shared_from_this() };
-    post(m_socket.get_executor(), [this, self, buf] {
-        if (!m_io_common.start_write_setup(buf)) {
-          return; // buf queued or shutdown happening
-        }
-        start_write(buf);
+    post_in_strand([this, self, cb = std::move(cb)] () mutable {
+        m_io_common.set_write_complete_cb(std::move(cb));
+      }
+    );
+  }
+
+  // use post for thread safety, applies to the next idle write
+  void set_output_coalescing(duration max_delay, std::size_t byte_threshold) {
+    auto self { shared_from_this() };
+    post_in_strand([this, self, max_delay, byte_threshold] {
+        m_coalesce_delay = max_delay;
+        m_coalesce_bytes = byte_threshold;
+      }
+    );
+  }
+
+  // use post for thread safety, the socket is put in non-blocking mode
+  void set_speculative_write(bool enable) {
+    auto self { shared_from_this() };
+    post_in_strand([this, self, enable] {
+        m_speculative_write = enable;
+        update_non_blocking();
+      }
+    );
+  }
+
+  // use post for thread safety; zero for both disables the read budget
+  void set_read_budget(std::size_t max_msgs, std::size_t max_bytes) {
+    auto self { shared_from_this() };
+    post_in_strand([this, self, max_msgs, max_bytes] {
+        m_io_common.set_read_budget(max_msgs, max_bytes);
       }
     );
   }
 
+  // use post for thread safety; a budget of zero disables inline reads
+  void set_speculative_read(std::size_t budget) {
+    auto self { shared_from_this() };
+    post_in_strand([this, self, budget] {
+        m_spec_read_budget = budget;
+        update_non_blocking();
+      }
+    );
+  }
+
+  // use post through the strand for thread safety, multiple threads can call this method;
+  // no post is needed when called from within the strand
+  void send(chops::const_shared_buffer buf) {
+    send(buf, queue_attrs { m_io_common.make_expiry() });
+  }
+
+  void send(chops::const_shared_buffer buf, std::chrono::steady_clock::duration max_age) {
+    send(buf, queue_attrs { m_io_common.make_expiry(max_age) });
+  }
+
+  void send(chops::const_shared_buffer buf, std::size_t lane) {
+    send(buf, queue_attrs { m_io_common.make_expiry(), 0u, false, lane });
+  }
+
   void send(const chops::const_shared_buffer& buf, const endpoint_type&) {
     send(buf);
   }
 
+  void send(std::uint64_t key, chops::const_shared_buffer buf) {
+    send(buf, queue_attrs { m_io_common.make_expiry(), key, true });
+  }
+
+  void send(std::uint64_t key, chops::const_shared_buffer buf, std::size_t lane) {
+    send(buf, queue_attrs { m_io_common.make_expiry(), key, true, lane });
+  }
+
+  void send(std::uint64_t key, const chops::const_shared_buffer& buf, const endpoint_type&) {
+    send(key, buf);
+  }
+
+  void send(const chops::const_shared_buffer& buf, const endpoint_type&,
+            std::chrono::steady_clock::duration max_age) {
+    send(buf, max_age);
+  }
+
+  void send(const chops::const_shared_buffer& buf, const endpoint_type&, std::size_t lane) {
+    send(buf, lane);
+  }
+
+  void send(intrusive_buffer buf) {
+    send(out_buffer(std::move(buf)), queue_attrs { m_io_common.make_expiry() });
+  }
+
+  void send(intrusive_buffer buf, const endpoint_type&) {
+    send(std::move(buf));
+  }
+
+  template <std::size_t N>
+  void send(const std::array<chops::const_shared_buffer, N>& parts) {
+    send(parts, queue_attrs { m_io_common.make_expiry() });
+  }
+
+  template <std::size_t N>
+  void send(const std::array<chops::const_shared_buffer, N>& parts, std::size_t lane) {
+    send(parts, queue_attrs { m_io_common.make_expiry(), 0u, false, lane });
+  }
+
+  // outstanding reads and writes are cancelled and parked, then resumed on the other
+  // io_context
+  void migrate_to(asio::io_context& ioc) {
+    auto self { shared_from_this() };
+    post_in_strand([this, self, &ioc] {
+        if (!m_io_common.is_io_started() || (m_migrate && m_migrate->ioc)) {
+          return; // not started, stopping, or a migration already in progress
+        }
+        if (!m_migrate) {
+          m_migrate = std::make_unique<migrate_state>();
+        }
+        m_migrate->ioc = &ioc;
+        if (coalesce_armed()) {
+          m_coalesce->timer.cancel(); // the window is closed after the migration
+        }
+        std::error_code ec;
+        m_socket.cancel(ec);
+        try_migrate();
+      }
+    );
+  }
+
 public:
   // this method can only be called through a net entity, assumes all error codes have already
   // been reported back to the net entity
@@ -166,27 +454,193 @@ public:
     if (!m_io_common.stop()) {
       return; // already stopped
     }
-//    auto self { shared_from_this() };
-//    post(m_socket.get_executor(), [this, self] {
-    // attempt graceful shutdown
-    std::error_code ec;
-    m_socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
-//    auto self { shared_from_this() };
-//  post(m_socket.get_executor(), [this, self, ec] () mutable { 
-    m_socket.close(ec); 
-//    } );
+    // socket operations must not run concurrently with the completion handlers
+    auto self { shared_from_this() };
+    dispatch_in_strand([this, self] {
+        if (m_coalesce) { // an open window would keep this handler alive until it expires
+          m_coalesce->armed = false;
+          m_coalesce->timer.cancel();
+        }
+        // attempt graceful shutdown
+        std::error_code ec;
+        m_socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        m_socket.close(ec); 
+      }
+    );
   }
 
 private:
 
-  bool start_io_setup() {
-    if (!m_io_common.set_io_started()) { // concurrency protected
+  void send(out_buffer buf, const queue_attrs& attrs) {
+    if (running_in_strand()) {
+      send_in_strand(buf, attrs);
+      return;
+    }
+    auto self { shared_from_this() };
+    post_in_strand([this, self, buf, attrs] {
+        send_in_strand(buf, attrs);
+      }
+    );
+  }
+
+  void send_in_strand(const out_buffer& buf, const queue_attrs& attrs) {
+    if (!m_io_common.start_write_setup(buf, attrs)) {
+      check_coalesce_bytes();
+      return; // buf queued or conflated or shutdown happening
+    }
+    if (m_coalesce_delay != duration::zero()) {
+      m_io_common.hold_write(buf, attrs);
+      open_coalesce_window();
+      return;
+    }
+    start_write(buf);
+  }
+
+  template <std::size_t N>
+  void send(const std::array<chops::const_shared_buffer, N>& parts, const queue_attrs& attrs) {
+    static_assert(N > 0 && N <= max_gather_bufs, "Number of message parts must be 1 to 64");
+    if (running_in_strand()) {
+      send_in_strand(parts, attrs);
+      return;
+    }
+    auto self { shared_from_this() };
+    post_in_strand([this, self, parts, attrs] {
+        send_in_strand(parts, attrs);
+      }
+    );
+  }
+
+  template <std::size_t N>
+  void send_in_strand(const std::array<chops::const_shared_buffer, N>& parts, 
+                      const queue_attrs& attrs) {
+    if (!m_io_common.start_write_setup(parts, attrs)) {
+      check_coalesce_bytes();
+      return; // parts queued or shutdown happening
+    }
+    if (m_coalesce_delay != duration::zero()) {
+      m_io_common.hold_write(parts, attrs);
+      open_coalesce_window();
+      return;
+    }
+    m_write_bufs.assign(parts.cbegin(), parts.cend());
+    start_gathered_write();
+  }
+
+  // held while reading the current strand slot from outside the strand; a slot retired
+  // in reader epoch R can't be read once the epoch reaches R + 2
+  class strand_user {
+  private:
+    const tcp_io&     m_ioh;
+    std::atomic_size_t*  m_users;
+  public:
+    explicit strand_user(const tcp_io& ioh) noexcept : m_ioh(ioh), m_users(nullptr) {
+      for (;;) {
+        std::uint64_t e = m_ioh.m_reader_epoch.load();
+        m_users = &m_ioh.m_strand_users[e & 1u];
+        ++(*m_users);
+        if (m_ioh.m_reader_epoch.load() == e) {
+          return;
+        }
+        --(*m_users);
+      }
+    }
+    ~strand_user() { --(*m_users); }
+    strand_user(const strand_user&) = delete;
+    strand_user& operator=(const strand_user&) = delete;
+    strand_slot& slot() const noexcept { return *m_ioh.m_strand_ptr.load(); }
+  };
+
+  // only called within the current strand
+  io_executor& exec() const noexcept { return m_strand_ptr.load(std::memory_order_acquire)->exec; }
+
+  bool running_in_strand() const noexcept {
+    strand_user u(*this);
+    return u.slot().exec.running_in_this_thread();
+  }
+
+  void free_drained_strands();
+
+  bool stale(std::uint64_t gen) const noexcept { 
+    return gen != m_strand_gen.load(std::memory_order_acquire);
+  }
+
+  // only called within the current strand
+  op_tracker<tcp_io>::op_ref start_op() { 
+    return m_strand_ptr.load(std::memory_order_acquire)->ops.start_op(*this);
+  }
+
+  // re-posts to the current strand after a migration, the function object must capture
+  // self since an op_ref can't be carried to another strand
+  template <typename F>
+  void post_in_strand(F&& func) {
+    strand_user u(*this);
+    strand_slot* st = &u.slot();
+    asio::post(st->exec, [this, gen = st->gen, f = std::forward<F>(func)] () mutable {
+        if (stale(gen)) {
+          post_in_strand(std::move(f));
+          return;
+        }
+        f();
+      }
+    );
+  }
+
+  template <typename F>
+  void dispatch_in_strand(F&& func) {
+    strand_user u(*this);
+    strand_slot* st = &u.slot();
+    asio::dispatch(st->exec, [this, gen = st->gen, f = std::forward<F>(func)] () mutable {
+        if (stale(gen)) {
+          post_in_strand(std::move(f));
+          return;
+        }
+        f();
+      }
+    );
+  }
+
+  bool migrating() const noexcept { 
+    return m_migrate && m_migrate->ioc && m_io_common.is_io_started();
+  }
+
+  // while migrating a read is parked instead of started (or restarted after a cancel)
+  template <typename F>
+  void park_read(F&& resume) {
+    m_migrate->parked_read = 
+      std::make_unique<parked_read_impl<std::decay_t<F> > >(std::forward<F>(resume));
+    try_migrate();
+  }
+
+  bool coalesce_armed() const noexcept { return m_coalesce && m_coalesce->armed; }
+
+  void try_migrate();
+
+  void resume_io();
+
+  // non-blocking mode while inline reads or writes are enabled
+  void update_non_blocking() {
+    std::error_code ec;
+    m_socket.non_blocking(m_speculative_write || m_spec_read_budget != 0, ec);
+    if (ec) {
+      m_speculative_write = false;
+      m_spec_read_budget = 0;
+    }
+  }
+
+  bool spec_read_allowed() noexcept {
+    if (m_spec_read_budget == 0 || m_spec_reads_left == 0) {
       return false;
     }
+    --m_spec_reads_left;
+    return true;
+  }
+
+  // called within the strand, after io started is set
+  bool start_io_setup() {
     std::error_code ec;
     m_remote_endp = m_socket.remote_endpoint(ec);
     if (ec) {
-      m_notifier_cb(ec, shared_from_this());
+      (*m_notifier_cb)(ec, shared_from_this());
       return false;
     }
     return true;
@@ -194,14 +648,47 @@ private:
 
   template <typename MH, typename MF>
   void start_read(asio::mutable_buffer mbuf, MH&& msg_hdlr, MF&& msg_frame) {
+    // the data may already be in the socket buffer
+    std::size_t nb = 0;
+    if (spec_read_allowed()) {
+      std::error_code ec;
+      nb = m_socket.read_some(mbuf, ec);
+      if (nb == mbuf.size()) {
+        handle_read(mbuf, std::error_code(), nb, 
+                    std::forward<MH>(msg_hdlr), std::forward<MF>(msg_frame));
+        return;
+      }
+    }
+    start_async_read(mbuf, nb, std::forward<MH>(msg_hdlr), std::forward<MF>(msg_frame));
+  }
+
+  // nb is the number of bytes of mbuf already read
+  template <typename MH, typename MF>
+  void start_async_read(asio::mutable_buffer mbuf, std::size_t nb, MH&& msg_hdlr, MF&& msg_frame) {
+    if (migrating()) {
+      park_read([this, mbuf, nb, mh = std::forward<MH>(msg_hdlr), 
+                 mf = std::forward<MF>(msg_frame)] () mutable {
+          start_async_read(mbuf, nb, std::move(mh), std::move(mf));
+        } );
+      return;
+    }
     // std::move in lambda instead of std::forward since an explicit copy or move of the function
     // object is desired so there are no dangling references
-    auto self { shared_from_this() };
-    asio::async_read(m_socket, mbuf,
-      [this, self, mbuf, mh = std::move(msg_hdlr), mf = std::move(msg_frame)]
-            (const std::error_code& err, std::size_t nb) mutable {
-        handle_read(mbuf, err, nb, std::move(mh), std::move(mf));
-      }
+    m_read_outstanding = true;
+    asio::async_read(m_socket, mbuf + nb, asio::bind_executor(exec(),
+      [this, op = start_op(), mbuf, nb, mh = std::move(msg_hdlr), 
+       mf = std::move(msg_frame)]
+            (const std::error_code& err, std::size_t n) mutable {
+        m_read_outstanding = false;
+        if (err == asio::error::operation_aborted && migrating()) {
+          park_read([this, mbuf, nb = nb + n, mh = std::move(mh), mf = std::move(mf)] () mutable {
+              start_async_read(mbuf, nb, std::move(mh), std::move(mf));
+            } );
+          return;
+        }
+        m_spec_reads_left = m_spec_read_budget; // new turn through the reactor
+        handle_read(mbuf, err, nb + n, std::move(mh), std::move(mf));
+      } )
     );
   }
 
@@ -211,18 +698,109 @@ private:
 
   template <typename MH>
   void start_read_until(MH&& msg_hdlr) {
-    auto self { shared_from_this() };
-    asio::async_read_until(m_socket, asio::dynamic_buffer(m_byte_vec), m_delimiter,
-      [this, self, mh = std::move(msg_hdlr)] (const std::error_code& err, std::size_t nb) mutable {
-        handle_read_until(err, nb, std::move(mh));
+    if (spec_read_allowed()) {
+      std::size_t nb = read_until_inline();
+      if (nb != 0) {
+        handle_read_until(std::error_code(), nb, std::forward<MH>(msg_hdlr));
+        return;
       }
+    }
+    // partially read data stays in m_byte_vec, so a parked read simply starts over
+    if (migrating()) {
+      park_read([this, mh = std::forward<MH>(msg_hdlr)] () mutable { 
+          start_read_until(std::move(mh));
+        } );
+      return;
+    }
+    m_read_outstanding = true;
+    asio::async_read_until(m_socket, asio::dynamic_buffer(m_byte_vec), *m_delimiter,
+      asio::bind_executor(exec(),
+        [this, op = start_op(), mh = std::move(msg_hdlr)]
+              (const std::error_code& err, std::size_t nb) mutable {
+          m_read_outstanding = false;
+          if (err == asio::error::operation_aborted && migrating()) {
+            park_read([this, mh = std::move(mh)] () mutable { start_read_until(std::move(mh)); } );
+            return;
+          }
+          m_spec_reads_left = m_spec_read_budget; // new turn through the reactor
+          handle_read_until(err, nb, std::move(mh));
+        } )
     );
   }
 
+  template <typename MH, typename MF>
+  void start_batch_read(MH&& batch_hdlr, MF&& msg_frame) {
+    if (migrating()) {
+      park_read([this, mh = std::forward<MH>(batch_hdlr), 
+                 mf = std::forward<MF>(msg_frame)] () mutable {
+          start_batch_read(std::move(mh), std::move(mf));
+        } );
+      return;
+    }
+    // compacted after every read, only grown when less than half a read size is free
+    if (m_byte_vec.size() - m_batch_used < batch_read_size / 2u) {
+      m_byte_vec.resize(m_batch_used + batch_read_size);
+    }
+    m_read_outstanding = true;
+    m_socket.async_read_some(asio::mutable_buffer(m_byte_vec.data() + m_batch_used, 
+                                                  m_byte_vec.size() - m_batch_used),
+      asio::bind_executor(exec(),
+        [this, op = start_op(), mh = std::move(batch_hdlr), mf = std::move(msg_frame)]
+              (const std::error_code& err, std::size_t nb) mutable {
+          m_read_outstanding = false;
+          if (err == asio::error::operation_aborted && migrating()) {
+            m_batch_used += nb;
+            park_read([this, mh = std::move(mh), mf = std::move(mf)] () mutable {
+                start_batch_read(std::move(mh), std::move(mf));
+              } );
+            return;
+          }
+          handle_batch_read(err, nb, std::move(mh), std::move(mf));
+        } )
+    );
+  }
+
+  template <typename MH, typename MF>
+  void handle_batch_read(const std::error_code&, std::size_t, MH&&, MF&&);
+
+  template <typename MF>
+  std::size_t frame_batch(MF&);
+
+  std::size_t frame_batch_delimited();
+
+  std::size_t find_delimiter(std::size_t start) const noexcept {
+    std::string_view sv(static_cast<const char*>(static_cast<const void*>(m_byte_vec.data())), 
+                        m_byte_vec.size());
+    auto pos = sv.find(*m_delimiter, start);
+    return pos == std::string_view::npos ? 0u : pos + m_delimiter->size();
+  }
+
+  std::size_t read_until_inline();
+
   template <typename MH>
   void handle_read_until(const std::error_code&, std::size_t, MH&&);
 
-  void start_write(chops::const_shared_buffer);
+  void start_write(out_buffer);
+
+  void open_coalesce_window();
+
+  void start_gathered_write();
+
+  // everything held by an open window is in the output queue
+  void check_coalesce_bytes() {
+    if (coalesce_armed() && m_coalesce_bytes != 0 &&
+        m_io_common.output_queue_bytes() >= m_coalesce_bytes) {
+      close_coalesce_window();
+    }
+  }
+
+  void close_coalesce_window();
+
+  void skip_gather_bytes(std::size_t);
+
+  void start_async_write(std::size_t);
+
+  bool write_done(std::size_t);
 
   void handle_write(const std::error_code&, std::size_t);
 
@@ -236,19 +814,21 @@ void tcp_io::handle_read(asio::mutable_buffer mbuf,
                          MH&& msg_hdlr, MF&& msg_frame) {
 
   if (err) {
-    m_notifier_cb(err, shared_from_this());
+    (*m_notifier_cb)(err, shared_from_this());
     return;
   }
   // assert num_bytes == mbuf.size()
+  bool yield = false;
   std::size_t next_read_size = msg_frame(mbuf);
   if (next_read_size == 0) { // msg fully received, now invoke message handler
     if (!msg_hdlr(asio::const_buffer(m_byte_vec.data(), m_byte_vec.size()), 
-                  basic_io_interface<tcp_io>(weak_from_this()), m_remote_endp)) {
+                  basic_io_interface<tcp_io>(*this), m_remote_endp)) {
       // message handler not happy, tear everything down
-      m_notifier_cb(std::make_error_code(net_ip_errc::message_handler_terminated), 
+      (*m_notifier_cb)(std::make_error_code(net_ip_errc::message_handler_terminated), 
                     shared_from_this());
       return;
     }
+    yield = m_io_common.msg_read(m_byte_vec.size());
     m_byte_vec.resize(m_read_size);
     mbuf = asio::mutable_buffer(m_byte_vec.data(), m_byte_vec.size());
   }
@@ -257,6 +837,20 @@ void tcp_io::handle_read(asio::mutable_buffer mbuf,
     m_byte_vec.resize(old_size + next_read_size);
     mbuf = asio::mutable_buffer(m_byte_vec.data() + old_size, next_read_size);
   }
+  if (yield) { // read budget used up, let other handlers run before reading more
+    m_read_outstanding = true; // a migration waits for the yield
+    post_in_strand([this, op = start_op(), mbuf, mh = std::forward<MH>(msg_hdlr), 
+                           mf = std::forward<MF>(msg_frame)] () mutable {
+        m_read_outstanding = false;
+        if (!m_io_common.is_io_started()) {
+          return; // closed while yielding
+        }
+        m_spec_reads_left = m_spec_read_budget;
+        start_read(mbuf, std::move(mh), std::move(mf));
+      }
+    );
+    return;
+  }
   start_read(mbuf, std::forward<MH>(msg_hdlr), std::forward<MF>(msg_frame));
 }
 
@@ -264,44 +858,352 @@ template <typename MH>
 void tcp_io::handle_read_until(const std::error_code& err, std::size_t num_bytes, MH&& msg_hdlr) {
 
   if (err) {
-    m_notifier_cb(err, shared_from_this());
+    (*m_notifier_cb)(err, shared_from_this());
     return;
   }
   // beginning of m_byte_vec to num_bytes is buf, includes delimiter bytes
   if (!msg_hdlr(asio::const_buffer(m_byte_vec.data(), num_bytes),
-                basic_io_interface<tcp_io>(weak_from_this()), m_remote_endp)) {
-      m_notifier_cb(std::make_error_code(net_ip_errc::message_handler_terminated), 
+                basic_io_interface<tcp_io>(*this), m_remote_endp)) {
+      (*m_notifier_cb)(std::make_error_code(net_ip_errc::message_handler_terminated), 
                     shared_from_this());
     return;
   }
   m_byte_vec.erase(m_byte_vec.begin(), m_byte_vec.begin() + num_bytes);
+  if (m_io_common.msg_read(num_bytes)) { // read budget used up, let other handlers run
+    m_read_outstanding = true; // a migration waits for the yield
+    post_in_strand([this, op = start_op(), mh = std::forward<MH>(msg_hdlr)] () mutable {
+        m_read_outstanding = false;
+        if (!m_io_common.is_io_started()) {
+          return; // closed while yielding
+        }
+        m_spec_reads_left = m_spec_read_budget;
+        start_read_until(std::move(mh));
+      }
+    );
+    return;
+  }
   start_read_until(std::forward<MH>(msg_hdlr));
 }
 
+template <typename MH, typename MF>
+void tcp_io::handle_batch_read(const std::error_code& err, std::size_t num_bytes,
+                               MH&& batch_hdlr, MF&& msg_frame) {
+
+  if (err) {
+    (*m_notifier_cb)(err, shared_from_this());
+    return;
+  }
+  m_batch_used += num_bytes;
+  m_batch_bufs.clear();
+  std::size_t consumed = frame_batch(msg_frame);
+  bool yield = false;
+  if (!m_batch_bufs.empty()) {
+    // every message framed is counted, even if the batch handler stops on one of them
+    for (const auto& b : m_batch_bufs) {
+      yield = m_io_common.msg_read(b.size()) || yield;
+    }
+    if (!batch_hdlr(m_batch_bufs, basic_io_interface<tcp_io>(*this), m_remote_endp)) {
+      (*m_notifier_cb)(std::make_error_code(net_ip_errc::message_handler_terminated), 
+                    shared_from_this());
+      return;
+    }
+  }
+  // move the partial message (if any) to the front of the buffer
+  if (consumed != 0u) {
+    std::copy(m_byte_vec.begin() + consumed, m_byte_vec.begin() + m_batch_used, m_byte_vec.begin());
+  }
+  m_batch_used -= consumed;
+  m_batch_pos -= consumed;
+  if (yield) { // read budget used up, let other handlers run before reading more
+    m_read_outstanding = true; // a migration waits for the yield
+    post_in_strand([this, op = start_op(), mh = std::forward<MH>(batch_hdlr), 
+                           mf = std::forward<MF>(msg_frame)] () mutable {
+        m_read_outstanding = false;
+        if (!m_io_common.is_io_started()) {
+          return; // closed while yielding
+        }
+        start_batch_read(std::move(mh), std::move(mf));
+      }
+    );
+    return;
+  }
+  start_batch_read(std::forward<MH>(batch_hdlr), std::forward<MF>(msg_frame));
+}
+
+// the msg frame function object sees the same sequence as with one read per piece;
+// returns the number of bytes of complete messages, which are in m_batch_bufs
+template <typename MF>
+std::size_t tcp_io::frame_batch(MF& msg_frame) {
+  if (m_delimiter) {
+    return frame_batch_delimited();
+  }
+  std::size_t msg_start = 0;
+  while (m_batch_used - m_batch_pos >= m_batch_need) {
+    asio::mutable_buffer piece(m_byte_vec.data() + m_batch_pos, m_batch_need);
+    m_batch_pos += m_batch_need;
+    std::size_t next_read_size = msg_frame(piece);
+    if (next_read_size == 0) { // msg fully received
+      m_batch_bufs.emplace_back(m_byte_vec.data() + msg_start, m_batch_pos - msg_start);
+      msg_start = m_batch_pos;
+      m_batch_need = m_read_size;
+    }
+    else {
+      m_batch_need = next_read_size;
+    }
+  }
+  return msg_start;
+}
+
+inline std::size_t tcp_io::frame_batch_delimited() {
+  std::string_view sv(static_cast<const char*>(static_cast<const void*>(m_byte_vec.data())), 
+                      m_batch_used);
+  std::size_t msg_start = 0;
+  // the delimiter may straddle the previous and new data
+  const std::string& delim = *m_delimiter;
+  std::size_t search = m_batch_pos < delim.size() ? 0u : m_batch_pos - delim.size() + 1;
+  for (;;) {
+    auto pos = sv.find(delim, search);
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    std::size_t msg_end = pos + delim.size();
+    m_batch_bufs.emplace_back(m_byte_vec.data() + msg_start, msg_end - msg_start);
+    msg_start = msg_end;
+    search = msg_end;
+  }
+  m_batch_pos = m_batch_used;
+  return msg_start;
+}
 
-inline void tcp_io::start_write(chops::const_shared_buffer buf) {
+// returns the size of a complete message (including the delimiter) at the front of the 
+// read buffer, or zero if there is none yet
+inline std::size_t tcp_io::read_until_inline() {
+  std::size_t nb = find_delimiter(0u);
+  if (nb != 0) {
+    return nb;
+  }
+  std::size_t old_size = m_byte_vec.size();
+  m_byte_vec.resize(old_size + inline_read_size);
+  std::error_code ec;
+  std::size_t n = m_socket.read_some(asio::mutable_buffer(m_byte_vec.data() + old_size, 
+                                                          inline_read_size), ec);
+  m_byte_vec.resize(old_size + n);
+  if (n == 0) {
+    return 0; // nothing waiting, or an error which the async read will report
+  }
+  // the delimiter may straddle the old and new data
+  return find_delimiter(old_size < m_delimiter->size() ? 0u : old_size - m_delimiter->size() + 1);
+}
+
+inline void tcp_io::start_write(out_buffer buf) {
+  m_write_bufs.clear();
+  m_write_bufs.push_back(std::move(buf));
+  start_gathered_write();
+}
+
+// the buffers that open the window are held in the output queue
+inline void tcp_io::open_coalesce_window() {
+  m_write_bufs.clear();
+  if (m_coalesce_bytes != 0 && m_io_common.output_queue_bytes() >= m_coalesce_bytes) {
+    if (m_io_common.get_next_elements(m_write_bufs, max_gather_bufs)) {
+      start_gathered_write();
+    }
+    return;
+  }
+  if (!m_coalesce) {
+    m_coalesce = std::make_unique<coalesce_state>(m_socket.get_executor());
+  }
+  m_coalesce->armed = true;
+  m_coalesce->start = std::chrono::steady_clock::now();
+  std::uint64_t gen = ++m_coalesce->generation;
+  m_coalesce->timer.expires_after(m_coalesce_delay);
+  m_coalesce->timer.async_wait(asio::bind_executor(exec(),
+            [this, op = start_op(), sgen = m_strand_gen.load(), gen] (const std::error_code& err) {
+      // after a migration this runs on the old io_context, so nothing else is touched
+      if (err || stale(sgen) || !coalesce_armed() || gen != m_coalesce->generation) {
+        return; // cancelled, or window already closed (and maybe a new one opened)
+      }
+      close_coalesce_window();
+    } )
+  );
+}
+
+inline void tcp_io::close_coalesce_window() {
+  m_coalesce->armed = false;
+  m_coalesce->timer.cancel();
+  m_io_common.coalesce_window_closed(std::chrono::steady_clock::now() - m_coalesce->start);
+  if (!m_io_common.get_next_elements(m_write_bufs, max_gather_bufs)) {
+    return; // shutting down, or everything held has expired
+  }
+  start_gathered_write();
+}
+
+inline void tcp_io::start_gathered_write() {
+  // loop instead of recursing while speculative writes complete inline
+  for (;;) {
+    m_gather_bufs.clear();
+    std::size_t total = 0;
+    for (const auto& b : m_write_bufs) {
+      m_gather_bufs.emplace_back(b.data(), b.size());
+      total += b.size();
+    }
+    if (!m_speculative_write) {
+      start_async_write(0u);
+      return;
+    }
+    std::error_code ec;
+    std::size_t nb = m_socket.write_some(m_gather_bufs, ec);
+    if (ec && ec != asio::error::would_block && ec != asio::error::try_again) {
+      handle_write(ec, nb);
+      return;
+    }
+    if (nb < total) { // send buffer full, the rest is written asynchronously
+      m_io_common.speculative_write(false);
+      skip_gather_bytes(nb);
+      start_async_write(nb);
+      return;
+    }
+    m_io_common.speculative_write(true);
+    if (!write_done(nb)) {
+      return;
+    }
+  }
+}
+
+// remove bytes already written from the front of the gather buffers
+inline void tcp_io::skip_gather_bytes(std::size_t nb) {
+  auto it = m_gather_bufs.begin();
+  while (nb != 0 && nb >= it->size()) {
+    nb -= it->size();
+    ++it;
+  }
+  it = m_gather_bufs.erase(m_gather_bufs.begin(), it);
+  if (it != m_gather_bufs.end()) {
+    *it += nb;
+  }
+}
+
+// bytes_written is the number of bytes of the pending write already written, for the stats
+inline void tcp_io::start_async_write(std::size_t bytes_written) {
+  if (migrating()) { // resumed after the migration
+    m_migrate->write_parked = true;
+    m_migrate->parked_write_bytes = bytes_written;
+    try_migrate();
+    return;
+  }
+  m_write_outstanding = true;
+  asio::async_write(m_socket, m_gather_bufs, asio::bind_executor(exec(),
+            [this, op = start_op(), bytes_written] 
+            (const std::error_code& err, std::size_t nb) {
+      m_write_outstanding = false;
+      if (err == asio::error::operation_aborted && migrating()) {
+        skip_gather_bytes(nb);
+        start_async_write(bytes_written + nb); // parks the write
+        return;
+      }
+      handle_write(err, bytes_written + nb);
+    } )
+  );
+}
+
+// called within the strand; the migration happens once nothing is outstanding on the socket
+inline void tcp_io::try_migrate() {
+  if (!m_io_common.is_io_started()) { // stopping, abandon the migration
+    *m_migrate = migrate_state();
+    return;
+  }
+  if (!m_migrate->ioc || m_read_outstanding || m_write_outstanding) {
+    return;
+  }
+  asio::io_context& ioc = *m_migrate->ioc;
+  m_migrate->ioc = nullptr;
+  free_drained_strands();
+  std::error_code ec;
+  auto protocol = m_socket.local_endpoint(ec).protocol();
+  if (!ec) {
+    socket_type::native_handle_type handle = m_socket.release(ec);
+    if (!ec) {
+      socket_type sock(ioc);
+      sock.assign(protocol, handle, ec);
+      if (ec) { // the socket is no longer owned by anyone, so it is closed here
+        asio::detail::socket_ops::state_type state = 0;
+        std::error_code close_ec;
+        asio::detail::socket_ops::close(handle, state, true, close_ec);
+        (*m_notifier_cb)(ec, shared_from_this());
+        return;
+      }
+      m_socket = std::move(sock);
+      if (m_coalesce) {
+        m_coalesce->timer = asio::steady_timer(ioc);
+      }
+      // the new strand may already be running once its slot is current
+      std::uint64_t gen = m_strand_gen.load() + 1u;
+      m_strand_ptr.load()->retired = m_reader_epoch.load();
+      m_strands.emplace_back(make_io_executor(m_socket.get_executor()), gen);
+      m_strand_ptr.store(&m_strands.back());
+      m_strand_gen.store(gen, std::memory_order_release);
+      update_non_blocking(); // the non-blocking flag is not carried over
+    }
+  }
+  // if the socket can't be released (not supported on some platforms) it stays where it is
   auto self { shared_from_this() };
-  asio::async_write(m_socket, asio::const_buffer(buf.data(), buf.size()),
-            [this, self] (const std::error_code& err, std::size_t nb) {
-      handle_write(err, nb);
+  post_in_strand([this, self] { resume_io(); } );
+}
+
+inline void tcp_io::resume_io() {
+  free_drained_strands();
+  if (!m_io_common.is_io_started()) {
+    *m_migrate = migrate_state();
+    return;
+  }
+  if (m_migrate->parked_read) {
+    auto rd { std::move(m_migrate->parked_read) };
+    rd->resume();
+  }
+  if (m_migrate->write_parked) {
+    m_migrate->write_parked = false;
+    start_async_write(m_migrate->parked_write_bytes);
+  }
+  else if (coalesce_armed()) {
+    close_coalesce_window();
+  }
+}
+
+// called within the strand, the only place the reader epoch is advanced
+inline void tcp_io::free_drained_strands() {
+  std::uint64_t e = m_reader_epoch.load();
+  for (int i = 0; i < 2 && m_strand_users[(e - 1u) & 1u].load() == 0u; ++i) {
+    m_reader_epoch.store(++e);
+  }
+  strand_slot* cur = m_strand_ptr.load();
+  m_strands.remove_if([cur, e] (const strand_slot& st) { 
+      return &st != cur && st.retired + 2u <= e && st.ops.is_drained();
     }
   );
 }
 
-inline void tcp_io::handle_write(const std::error_code& err, std::size_t /* num_bytes */) {
+// returns true if there is more to write
+inline bool tcp_io::write_done(std::size_t num_bytes) {
+  m_io_common.write_complete(m_write_bufs.size(), num_bytes);
+  m_write_bufs.clear();
+  // everything queued while the write was in progress goes out in the next write
+  return m_io_common.get_next_elements(m_write_bufs, max_gather_bufs);
+}
+
+inline void tcp_io::handle_write(const std::error_code& err, std::size_t num_bytes) {
   if (err) {
     // read pops first, so usually no error is needed in write handlers
     // m_notifier_cb(err, shared_from_this());
     return;
   }
-  auto elem = m_io_common.get_next_element();
-  if (!elem) {
+  if (!write_done(num_bytes)) {
     return;
   }
-  start_write(elem->first);
+  start_gathered_write();
 }
 
 using tcp_io_ptr = std::shared_ptr<tcp_io>;
+using tcp_io_pool = object_pool<tcp_io>;
 
 inline std::size_t null_msg_frame (asio::mutable_buffer) noexcept {
   return 0;
@@ -27,34 +27,71 @@
 #include <system_error>
 
 #include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
 #include <utility> // std::forward, std::move
+#include <vector>
+#include <chrono>
 
 #include "net_ip/detail/io_common.hpp"
 #include "net_ip/detail/net_entity_common.hpp"
 #include "net_ip/detail/output_queue.hpp"
+#include "net_ip/detail/io_executor.hpp"
+#include "net_ip/detail/op_tracker.hpp"
 
 #include "net_ip/queue_stats.hpp"
 #include "net_ip/net_ip_error.hpp"
 #include "net_ip/basic_io_interface.hpp"
+#include "net_ip/intrusive_buffer.hpp"
 #include "utility/shared_buffer.hpp"
 
 namespace chops {
 namespace net {
 namespace detail {
 
+#if defined(SO_REUSEPORT)
+// lets multiple sockets bind to the same endpoint, the kernel spreads incoming flows 
+// across them; asio does not provide this option, so it is written as a model of the 
+// asio SettableSocketOption requirements
+class reuse_port_option {
+public:
+  explicit reuse_port_option(bool enable) noexcept : m_value(enable ? 1 : 0) { }
+
+  template <typename Protocol>
+  int level(const Protocol&) const noexcept { return SOL_SOCKET; }
+
+  template <typename Protocol>
+  int name(const Protocol&) const noexcept { return SO_REUSEPORT; }
+
+  template <typename Protocol>
+  const int* data(const Protocol&) const noexcept { return &m_value; }
+
+  template <typename Protocol>
+  std::size_t size(const Protocol&) const noexcept { return sizeof(m_value); }
+
+private:
+  int  m_value;
+};
+#endif
+
 class udp_entity_io : public std::enable_shared_from_this<udp_entity_io> {
 public:
   using socket_type = asio::ip::udp::socket;
   using endpoint_type = asio::ip::udp::endpoint;
+  using write_complete_cb = io_common<udp_entity_io>::write_complete_cb;
 
 private:
   using byte_vec = chops::mutable_shared_buffer::byte_vec;
 
+  // datagrams received in one batch, the first through the reactor and the rest
+  // with non-blocking receives of whatever is already waiting
+  static constexpr std::size_t max_batch_datagrams = 32;
+
 private:
 
   io_common<udp_entity_io>          m_io_common;
   net_entity_common<udp_entity_io>  m_entity_common;
   asio::io_context&                 m_io_context;
+  io_executor                       m_io_exec; // all handlers run through this
   socket_type                       m_socket;
   endpoint_type                     m_local_endp;
   endpoint_type                     m_default_dest_endp;
@@ -65,13 +102,21 @@ private:
   byte_vec                          m_byte_vec;
   std::size_t                       m_max_size;
   endpoint_type                     m_sender_endp;
+  std::vector<asio::const_buffer>   m_batch_bufs; // datagram views for batch delivery
+  std::vector<endpoint_type>        m_batch_endps;
+  std::size_t                       m_batch_max;
+  bool                              m_reuse_port; // set for each socket of a sharded entity
+  // completion handlers and posts from within the strand hold an op_ref, see op_tracker
+  op_tracker<udp_entity_io>         m_ops;
 
 public:
   udp_entity_io(asio::io_context& ioc, 
-                const endpoint_type& local_endp) noexcept : 
+                const endpoint_type& local_endp, bool reuse_port = false) noexcept : 
     m_io_common(), m_entity_common(), m_io_context(ioc),
-    m_socket(ioc), m_local_endp(local_endp), m_default_dest_endp(), 
-    m_byte_vec(), m_max_size(0), m_sender_endp() { }
+    m_io_exec(make_io_executor(ioc.get_executor())), m_socket(ioc), m_local_endp(local_endp), m_default_dest_endp(), 
+    m_byte_vec(), m_max_size(0), m_sender_endp(), 
+    m_batch_bufs(), m_batch_endps(), m_batch_max(0), m_reuse_port(reuse_port), 
+    m_ops() { }
 
 private:
   // no copy or assignment semantics for this class
@@ -95,6 +140,10 @@ public:
     return m_io_common.get_output_queue_stats();
   }
 
+  input_stats get_input_stats() const noexcept {
+    return m_io_common.get_input_stats();
+  }
+
   template <typename F1, typename F2>
   bool start(F1&& io_state_chg, F2&& err_cb) {
     if (!m_entity_common.start(std::forward<F1>(io_state_chg), std::forward<F2>(err_cb))) {
@@ -107,6 +156,13 @@ public:
 // TODO: this needs to be changed, doesn't allow sending to an ipV6 endpoint
         m_socket.open(asio::ip::udp::v4());
       }
+#if defined(SO_REUSEPORT)
+      else if (m_reuse_port) { // the option must be set before the bind
+        m_socket.open(m_local_endp.protocol());
+        m_socket.set_option(reuse_port_option(true));
+        m_socket.bind(m_local_endp);
+      }
+#endif
       else {
         m_socket = socket_type(m_io_context, m_local_endp);
       }
@@ -120,13 +176,19 @@ public:
     return true;
   }
 
+  // reads are started through the strand, since start_io can be called from any thread
   template <typename MH>
   bool start_io(std::size_t max_size, MH&& msg_handler) {
     if (!m_io_common.set_io_started()) { // concurrency protected
       return false;
     }
-    m_max_size = max_size;
-    start_read(std::forward<MH>(msg_handler));
+    auto self { shared_from_this() };
+    asio::dispatch(m_io_exec, [this, self, max_size, 
+                               mh = std::forward<MH>(msg_handler)] () mutable {
+        m_max_size = max_size;
+        start_read(std::move(mh));
+      }
+    );
     return true;
   }
 
@@ -135,9 +197,36 @@ public:
     if (!m_io_common.set_io_started()) { // concurrency protected
       return false;
     }
-    m_max_size = max_size;
-    m_default_dest_endp = endp;
-    start_read(std::forward<MH>(msg_handler));
+    auto self { shared_from_this() };
+    asio::dispatch(m_io_exec, [this, self, endp, max_size, 
+                               mh = std::forward<MH>(msg_handler)] () mutable {
+        m_max_size = max_size;
+        m_default_dest_endp = endp;
+        start_read(std::move(mh));
+      }
+    );
+    return true;
+  }
+
+  // batch delivery, the handler is invoked once with every datagram that is waiting
+  template <typename MH>
+  bool start_io_batch(std::size_t max_size, MH&& batch_handler) {
+    if (!m_io_common.set_io_started()) { // concurrency protected
+      return false;
+    }
+    auto self { shared_from_this() };
+    asio::dispatch(m_io_exec, [this, self, max_size, 
+                               mh = std::forward<MH>(batch_handler)] () mutable {
+        m_max_size = max_size;
+        // non-blocking mode only affects the synchronous receives, if it can't be set
+        // each batch is a single datagram
+        std::error_code ec;
+        m_socket.non_blocking(true, ec);
+        m_batch_max = ec ? 1u : max_batch_datagrams;
+        m_byte_vec.resize(m_max_size * m_batch_max);
+        start_batch_read(std::move(mh));
+      }
+    );
     return true;
   }
 
@@ -152,7 +241,8 @@ public:
     if (!m_io_common.set_io_started()) { // concurrency protected
       return false;
     }
-    m_default_dest_endp = endp;
+    auto self { shared_from_this() };
+    asio::dispatch(m_io_exec, [this, self, endp] { m_default_dest_endp = endp; } );
     return true;
   }
 
@@ -160,8 +250,13 @@ public:
     if (!m_io_common.stop()) {
       return false;
     }
-    std::error_code ec;
-    m_socket.close(ec);
+    // the socket is only touched within the strand
+    auto self { shared_from_this() };
+    asio::dispatch(m_io_exec, [this, self] {
+        std::error_code ec;
+        m_socket.close(ec);
+      }
+    );
     err_notify(std::make_error_code(net_ip_errc::udp_io_handler_stopped));
     m_entity_common.call_io_state_chg_cb(shared_from_this(), 0, false);
     return true;
@@ -176,44 +271,150 @@ public:
     return true;
   }
 
-  void send(chops::const_shared_buffer buf) {
+  void set_output_max_age(std::chrono::steady_clock::duration max_age) noexcept {
+    m_io_common.set_max_age(max_age);
+  }
+
+  void set_output_lane_weight(std::size_t lane, std::size_t weight) {
+    m_io_common.set_lane_weight(lane, weight);
+  }
+
+  // use post for thread safety, the callback is invoked from within the run thread
+  void set_write_completion_handler(write_complete_cb cb) {
     auto self { shared_from_this() };
-    post(m_socket.get_executor(), [this, self, buf] {
-        if (!m_io_common.start_write_setup(buf)) {
-          return; // buf queued or shutdown happening
-        }
-        start_write(buf, m_default_dest_endp);
+    asio::post(m_io_exec, [this, self, cb = std::move(cb)] () mutable {
+        m_io_common.set_write_complete_cb(std::move(cb));
       }
     );
   }
 
-  void send(chops::const_shared_buffer buf, const endpoint_type& endp) {
+  // use post for thread safety; zero for both disables the read budget
+  void set_read_budget(std::size_t max_msgs, std::size_t max_bytes) {
     auto self { shared_from_this() };
-    post(m_socket.get_executor(), [this, self, buf, endp] {
-        if (!m_io_common.start_write_setup(buf, endp)) {
-          return; // buf queued or shutdown happening
-        }
-        start_write(buf, endp);
+    asio::post(m_io_exec, [this, self, max_msgs, max_bytes] {
+        m_io_common.set_read_budget(max_msgs, max_bytes);
       }
     );
   }
 
+  void send(chops::const_shared_buffer buf) {
+    send(buf, queue_attrs { m_io_common.make_expiry() });
+  }
+
+  void send(chops::const_shared_buffer buf, std::chrono::steady_clock::duration max_age) {
+    send(buf, queue_attrs { m_io_common.make_expiry(max_age) });
+  }
+
+  void send(chops::const_shared_buffer buf, std::size_t lane) {
+    send(buf, queue_attrs { m_io_common.make_expiry(), 0u, false, lane });
+  }
+
+  void send(chops::const_shared_buffer buf, const endpoint_type& endp) {
+    send(buf, endp, queue_attrs { m_io_common.make_expiry() });
+  }
+
+  void send(chops::const_shared_buffer buf, const endpoint_type& endp,
+            std::chrono::steady_clock::duration max_age) {
+    send(buf, endp, queue_attrs { m_io_common.make_expiry(max_age) });
+  }
+
+  void send(chops::const_shared_buffer buf, const endpoint_type& endp, std::size_t lane) {
+    send(buf, endp, queue_attrs { m_io_common.make_expiry(), 0u, false, lane });
+  }
+
+  void send(std::uint64_t key, chops::const_shared_buffer buf) {
+    send(buf, queue_attrs { m_io_common.make_expiry(), key, true });
+  }
+
+  void send(std::uint64_t key, chops::const_shared_buffer buf, std::size_t lane) {
+    send(buf, queue_attrs { m_io_common.make_expiry(), key, true, lane });
+  }
+
+  void send(std::uint64_t key, chops::const_shared_buffer buf, const endpoint_type& endp) {
+    send(buf, endp, queue_attrs { m_io_common.make_expiry(), key, true });
+  }
+
+  void send(intrusive_buffer buf) {
+    send(out_buffer(std::move(buf)), queue_attrs { m_io_common.make_expiry() });
+  }
+
+  void send(intrusive_buffer buf, const endpoint_type& endp) {
+    send(out_buffer(std::move(buf)), endp, queue_attrs { m_io_common.make_expiry() });
+  }
+
 private:
 
+  // when called from within the strand (e.g. a reply from the message handler) the 
+  // write is started or the buffer queued immediately, without the post
+  void send(out_buffer buf, const queue_attrs& attrs) {
+    if (m_io_exec.running_in_this_thread()) {
+      send_in_strand(buf, attrs);
+      return;
+    }
+    auto self { shared_from_this() };
+    asio::post(m_io_exec, [this, self, buf, attrs] {
+        send_in_strand(buf, attrs);
+      }
+    );
+  }
+
+  void send_in_strand(const out_buffer& buf, const queue_attrs& attrs) {
+    if (!m_io_common.start_write_setup(buf, attrs)) {
+      return; // buf queued or conflated or shutdown happening
+    }
+    start_write(buf, m_default_dest_endp);
+  }
+
+  void send(out_buffer buf, const endpoint_type& endp, const queue_attrs& attrs) {
+    if (m_io_exec.running_in_this_thread()) {
+      send_in_strand(buf, endp, attrs);
+      return;
+    }
+    auto self { shared_from_this() };
+    asio::post(m_io_exec, [this, self, buf, endp, attrs] {
+        send_in_strand(buf, endp, attrs);
+      }
+    );
+  }
+
+  void send_in_strand(const out_buffer& buf, const endpoint_type& endp, 
+                      const queue_attrs& attrs) {
+    if (!m_io_common.start_write_setup(buf, endp, attrs)) {
+      return; // buf queued or conflated or shutdown happening
+    }
+    start_write(buf, endp);
+  }
+
   template <typename MH>
   void start_read(MH&& msg_hdlr) {
-    auto self { shared_from_this() };
     m_byte_vec.resize(m_max_size);
     m_socket.async_receive_from(
               asio::mutable_buffer(m_byte_vec.data(), m_byte_vec.size()),
               m_sender_endp,
-                [this, self, mh = std::move(msg_hdlr)] 
+                asio::bind_executor(m_io_exec, [this, op = m_ops.start_op(*this), 
+                                                mh = std::move(msg_hdlr)] 
                   (const std::error_code& err, std::size_t nb) mutable {
         handle_read(err, nb, mh);
-      }
+      } )
+    );
+  }
+
+  template <typename MH>
+  void start_batch_read(MH&& batch_hdlr) {
+    m_socket.async_receive_from(
+              asio::mutable_buffer(m_byte_vec.data(), m_max_size),
+              m_sender_endp,
+                asio::bind_executor(m_io_exec, [this, op = m_ops.start_op(*this), 
+                                                mh = std::move(batch_hdlr)] 
+                  (const std::error_code& err, std::size_t nb) mutable {
+        handle_batch_read(err, nb, mh);
+      } )
     );
   }
 
+  template <typename MH>
+  void handle_batch_read(const std::error_code&, std::size_t, MH&&);
+
   void err_notify (const std::error_code& err) {
     m_entity_common.call_error_cb(shared_from_this(), err);
   }
@@ -221,7 +422,7 @@ private:
   template <typename MH>
   void handle_read(const std::error_code&, std::size_t, MH&&);
 
-  void start_write(chops::const_shared_buffer, const endpoint_type&);
+  void start_write(out_buffer, const endpoint_type&);
 
   void handle_write(const std::error_code&, std::size_t);
 
@@ -238,35 +439,100 @@ void udp_entity_io::handle_read(const std::error_code& err, std::size_t num_byte
     return;
   }
   if (!msg_hdlr(asio::const_buffer(m_byte_vec.data(), num_bytes), 
-                basic_io_interface<udp_entity_io>(weak_from_this()), m_sender_endp)) {
+                basic_io_interface<udp_entity_io>(*this), m_sender_endp)) {
     // message handler not happy, tear everything down
     err_notify(std::make_error_code(net_ip_errc::message_handler_terminated));
     stop();
     return;
   }
+  if (m_io_common.msg_read(num_bytes)) { // read budget used up, let other handlers run
+    asio::post(m_io_exec, [this, op = m_ops.start_op(*this), 
+                           mh = std::forward<MH>(msg_hdlr)] () mutable {
+        if (!m_io_common.is_io_started()) {
+          return; // stopped while yielding
+        }
+        start_read(std::move(mh));
+      }
+    );
+    return;
+  }
   start_read(std::forward<MH>(msg_hdlr));
 }
 
-inline void udp_entity_io::start_write(chops::const_shared_buffer buf, const endpoint_type& endp) {
-  auto self { shared_from_this() };
+template <typename MH>
+void udp_entity_io::handle_batch_read(const std::error_code& err, std::size_t num_bytes, 
+                                      MH&& batch_hdlr) {
+
+  if (err) {
+    err_notify(err);
+    stop();
+    return;
+  }
+  m_batch_bufs.clear();
+  m_batch_endps.clear();
+  m_batch_bufs.emplace_back(m_byte_vec.data(), num_bytes);
+  m_batch_endps.push_back(m_sender_endp);
+  // pick up whatever else is already waiting, a would block error ends the batch and
+  // any other error will be reported by the next async receive
+  while (m_batch_bufs.size() < m_batch_max) {
+    auto* slot = m_byte_vec.data() + m_batch_bufs.size() * m_max_size;
+    std::error_code ec;
+    std::size_t nb = m_socket.receive_from(asio::mutable_buffer(slot, m_max_size), 
+                                           m_sender_endp, 0, ec);
+    if (ec) {
+      break;
+    }
+    m_batch_bufs.emplace_back(slot, nb);
+    m_batch_endps.push_back(m_sender_endp);
+  }
+  // every datagram received is counted, even if the batch handler stops on one of them
+  bool yield = false;
+  for (const auto& b : m_batch_bufs) {
+    yield = m_io_common.msg_read(b.size()) || yield;
+  }
+  if (!batch_hdlr(m_batch_bufs, basic_io_interface<udp_entity_io>(*this), 
+                  m_batch_endps)) {
+    // message handler not happy, tear everything down
+    err_notify(std::make_error_code(net_ip_errc::message_handler_terminated));
+    stop();
+    return;
+  }
+  if (yield) { // read budget used up, let other handlers run
+    asio::post(m_io_exec, [this, op = m_ops.start_op(*this), 
+                           mh = std::forward<MH>(batch_hdlr)] () mutable {
+        if (!m_io_common.is_io_started()) {
+          return; // stopped while yielding
+        }
+        start_batch_read(std::move(mh));
+      }
+    );
+    return;
+  }
+  start_batch_read(std::forward<MH>(batch_hdlr));
+}
+
+inline void udp_entity_io::start_write(out_buffer buf, const endpoint_type& endp) {
+  // buf is captured so the data stays alive until the send completes
   m_socket.async_send_to(asio::const_buffer(buf.data(), buf.size()), endp,
-            [this, self] (const std::error_code& err, std::size_t nb) {
+            asio::bind_executor(m_io_exec, [this, op = m_ops.start_op(*this), buf] 
+                                (const std::error_code& err, std::size_t nb) {
       handle_write(err, nb);
-    }
+    } )
   );
 }
 
-inline void udp_entity_io::handle_write(const std::error_code& err, std::size_t /* num_bytes */) {
+inline void udp_entity_io::handle_write(const std::error_code& err, std::size_t num_bytes) {
   if (err) {
     err_notify(err);
     stop();
     return;
   }
+  m_io_common.write_complete(1u, num_bytes);
   auto elem = m_io_common.get_next_element();
   if (!elem) {
     return;
   }
-  start_write(elem->first, elem->second ? *(elem->second) : m_default_dest_endp);
+  start_write(std::move(elem->first), elem->second ? *(elem->second) : m_default_dest_endp);
 }
 
 using udp_entity_io_ptr = std::shared_ptr<udp_entity_io>;
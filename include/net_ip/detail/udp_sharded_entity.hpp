@@ -0,0 +1,178 @@
+/** @file
+ *
+ *  @ingroup net_ip_module
+ *
+ *  @brief Internal class that binds multiple UDP sockets to one local endpoint, each
+ *  running on its own @c io_context, so UDP input is spread across threads.
+ *
+ *  @note For internal use only.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef UDP_SHARDED_ENTITY_HPP_INCLUDED
+#define UDP_SHARDED_ENTITY_HPP_INCLUDED
+
+#include "asio/io_context.hpp"
+#include "asio/ip/udp.hpp"
+
+#include <memory> // std::shared_ptr, std::make_shared
+#include <system_error>
+#include <atomic>
+#include <functional> // std::function
+#include <utility> // std::forward
+#include <vector>
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#endif
+
+#include "net_ip/detail/udp_entity_io.hpp"
+
+#include "net_ip/queue_stats.hpp"
+#include "net_ip/basic_io_interface.hpp"
+
+namespace chops {
+namespace net {
+namespace detail {
+
+// each shard is a complete UDP entity and IO handler; the sharded entity starts and
+// stops them together and the kernel picks which shard receives each incoming flow
+class udp_sharded_entity {
+public:
+  using socket_type = udp_entity_io::socket_type;
+  using endpoint_type = udp_entity_io::endpoint_type;
+
+private:
+  using io_state_chg_cb =
+    std::function<void (basic_io_interface<udp_entity_io>, std::size_t, bool)>;
+
+private:
+  std::vector<udp_entity_io_ptr>              m_shards;
+  std::atomic_bool                            m_started;
+  // shared with the shard callbacks, which can run after this object is gone
+  std::shared_ptr<std::atomic<std::size_t> >  m_num_up;
+  bool                                        m_cpu_steering;
+
+public:
+  udp_sharded_entity(const std::vector<asio::io_context*>& iocs,
+                     const endpoint_type& local_endp, bool cpu_steering) :
+    m_shards(), m_started(false),
+    m_num_up(std::make_shared<std::atomic<std::size_t> >(0u)),
+    m_cpu_steering(cpu_steering) {
+#if defined(SO_REUSEPORT)
+    for (auto* ioc : iocs) {
+      m_shards.push_back(std::make_shared<udp_entity_io>(*ioc, local_endp, true));
+    }
+#else
+    // without port reuse only one socket can bind the endpoint
+    m_shards.push_back(std::make_shared<udp_entity_io>(*iocs.front(), local_endp));
+#endif
+  }
+
+private:
+  // no copy or assignment semantics for this class
+  udp_sharded_entity(const udp_sharded_entity&) = delete;
+  udp_sharded_entity(udp_sharded_entity&&) = delete;
+  udp_sharded_entity& operator=(const udp_sharded_entity&) = delete;
+  udp_sharded_entity& operator=(udp_sharded_entity&&) = delete;
+
+public:
+
+  bool is_started() const noexcept { return m_started; }
+
+  // the first shard socket, socket options set here are not applied to the other shards
+  socket_type& get_socket() noexcept { return m_shards.front()->get_socket(); }
+
+  std::size_t num_shards() const noexcept { return m_shards.size(); }
+
+  std::vector<shard_stats> get_shard_stats() const {
+    std::vector<shard_stats> st;
+    for (const auto& sh : m_shards) {
+      st.push_back(shard_stats { sh->get_input_stats(), sh->get_output_queue_stats() });
+    }
+    return st;
+  }
+
+  // the io state change callback is invoked once per shard, with the number of shards
+  // currently up, in the same way a TCP acceptor reports connections
+  template <typename F1, typename F2>
+  bool start(F1&& io_state_chg, F2&& err_cb) {
+    bool expected = false;
+    if (!m_started.compare_exchange_strong(expected, true)) {
+      return false;
+    }
+    *m_num_up = 0u;
+    auto chg = [num_up = m_num_up, ios = io_state_chg_cb(std::forward<F1>(io_state_chg))]
+                 (basic_io_interface<udp_entity_io> io, std::size_t, bool starting) {
+      ios(io, starting ? ++(*num_up) : --(*num_up), starting);
+    };
+    for (auto& sh : m_shards) {
+      // a bind failure has already been reported through the error callback
+      if (!sh->start(chg, err_cb)) {
+        stop();
+        return false;
+      }
+    }
+    if (m_cpu_steering && m_shards.size() > 1u) {
+      auto ec = attach_cpu_steering();
+      if (ec) { // not fatal, the kernel falls back to hashing flows
+        err_cb(basic_io_interface<udp_entity_io>(m_shards.front()), ec);
+      }
+    }
+    return true;
+  }
+
+  bool stop() {
+    bool expected = true;
+    if (!m_started.compare_exchange_strong(expected, false)) {
+      return false;
+    }
+    for (auto& sh : m_shards) {
+      sh->stop();
+    }
+    return true;
+  }
+
+private:
+
+  // a classic BPF program for the port reuse group that picks the shard by the CPU
+  // handling the packet, so shard N should run on a thread pinned to CPU N
+  std::error_code attach_cpu_steering() {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    sock_filter code[] = {
+      { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<std::uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+      { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<std::uint32_t>(m_shards.size()) },
+      { BPF_RET | BPF_A, 0, 0, 0 }
+    };
+    sock_fprog prog { static_cast<unsigned short>(sizeof(code) / sizeof(code[0])), code };
+    if (::setsockopt(m_shards.front()->get_socket().native_handle(), SOL_SOCKET,
+                     SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) != 0) {
+      return std::error_code(errno, std::system_category());
+    }
+    return std::error_code();
+#else
+    return std::make_error_code(std::errc::operation_not_supported);
+#endif
+  }
+
+};
+
+using udp_sharded_entity_ptr = std::shared_ptr<udp_sharded_entity>;
+
+} // end detail namespace
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -0,0 +1,224 @@
+/** @file
+ *
+ *  @ingroup net_ip_module
+ *
+ *  @brief An immutable reference counted byte buffer, with the reference count and
+ *  size stored inline in the same allocation as the bytes.
+ *
+ *  A @c chops::const_shared_buffer holds a @c std::shared_ptr to a @c std::vector, which
+ *  is a separate control block and vector buffer, and a two pointer handle that is copied
+ *  into every output queue element and completion handler. An @c intrusive_buffer is
+ *  one allocation (a small header followed by the bytes) and a one pointer handle.
+ *
+ *  The reference count is atomic by default. When a buffer is created, copied and released
+ *  only in one thread (e.g. an application that sends from within message handlers on a
+ *  single threaded @c io_context), the reference count can be made non-atomic, which
+ *  avoids the locked instructions on every copy.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#ifndef INTRUSIVE_BUFFER_HPP_INCLUDED
+#define INTRUSIVE_BUFFER_HPP_INCLUDED
+
+#include <cstddef> // std::size_t, std::byte
+#include <cstdint> // std::uint32_t
+#include <cstring> // std::memcpy, std::memcmp
+#include <atomic>
+#include <new> // operator new, operator delete, placement new
+#include <utility> // std::swap, std::forward
+
+#include "utility/shared_buffer.hpp"
+
+namespace chops {
+namespace net {
+
+/**
+ *  @brief Reference count mode of an @c intrusive_buffer, chosen when the buffer is created.
+ *
+ *  A @c single_thread buffer, and every copy of it, must only be copied and destroyed
+ *  in one thread at a time. In particular, it must not be sent through an IO handler
+ *  that runs in a different thread than the sender, or sent to IO handlers running in
+ *  different threads (e.g. through @c send_to_all).
+ */
+enum class refcount_mode { atomic, single_thread };
+
+/**
+ *  @brief An immutable, reference counted byte buffer with a single allocation and an
+ *  8 byte (one pointer) handle.
+ *
+ *  Copying an @c intrusive_buffer increments the reference count, the bytes are freed
+ *  when the last copy is destroyed. The bytes cannot be changed once the buffer is
+ *  created, so copies can be read concurrently. A default constructed @c intrusive_buffer
+ *  is empty, with a null @c data pointer.
+ *
+ *  An @c intrusive_buffer can be sent through a @c basic_io_interface (and
+ *  @c send_to_all), and is queued without copying the bytes.
+ */
+class intrusive_buffer {
+private:
+
+  // the bytes follow the header in the same allocation
+  struct header {
+    std::atomic<std::uint32_t>  refcnt;
+    bool                        atomic_mode;
+    std::size_t                 size;
+
+    header(std::size_t sz, refcount_mode mode) noexcept :
+      refcnt(1u), atomic_mode(mode == refcount_mode::atomic), size(sz) { }
+
+    std::byte* bytes() noexcept { return reinterpret_cast<std::byte*>(this + 1); }
+  };
+
+private:
+  header*   m_hdr;
+
+public:
+
+  intrusive_buffer() noexcept : m_hdr(nullptr) { }
+
+/**
+ *  @brief Construct by copying bytes from an array.
+ *
+ *  @param buf Pointer to the bytes to copy.
+ *
+ *  @param sz Number of bytes.
+ *
+ *  @param mode Reference count mode.
+ */
+  intrusive_buffer(const void* buf, std::size_t sz,
+                   refcount_mode mode = refcount_mode::atomic) : m_hdr(allocate(sz, mode)) {
+    if (sz != 0u) {
+      std::memcpy(m_hdr->bytes(), buf, sz);
+    }
+  }
+
+/**
+ *  @brief Construct by copying the bytes of a @c chops::const_shared_buffer.
+ */
+  explicit intrusive_buffer(const chops::const_shared_buffer& buf,
+                            refcount_mode mode = refcount_mode::atomic) :
+    intrusive_buffer(buf.data(), buf.size(), mode) { }
+
+/**
+ *  @brief Construct by copying the bytes of a @c chops::mutable_shared_buffer.
+ */
+  explicit intrusive_buffer(const chops::mutable_shared_buffer& buf,
+                            refcount_mode mode = refcount_mode::atomic) :
+    intrusive_buffer(buf.data(), buf.size(), mode) { }
+
+  intrusive_buffer(const intrusive_buffer& rhs) noexcept : m_hdr(rhs.m_hdr) {
+    add_ref();
+  }
+
+  intrusive_buffer(intrusive_buffer&& rhs) noexcept : m_hdr(rhs.m_hdr) {
+    rhs.m_hdr = nullptr;
+  }
+
+  intrusive_buffer& operator=(intrusive_buffer rhs) noexcept {
+    std::swap(m_hdr, rhs.m_hdr);
+    return *this;
+  }
+
+  ~intrusive_buffer() { release(); }
+
+/**
+ *  @brief Create a buffer and fill in the bytes in place, without an intermediate copy.
+ *
+ *  @param sz Number of bytes.
+ *
+ *  @param fill Function object with the signature @c void(std::byte*, std::size_t),
+ *  called once with a pointer to the (uninitialized) bytes and the size.
+ *
+ *  @param mode Reference count mode.
+ */
+  template <typename F>
+  static intrusive_buffer make(std::size_t sz, F&& fill,
+                               refcount_mode mode = refcount_mode::atomic) {
+    intrusive_buffer b;
+    b.m_hdr = allocate(sz, mode);
+    std::forward<F>(fill)(b.m_hdr->bytes(), sz);
+    return b;
+  }
+
+  const std::byte* data() const noexcept { return m_hdr ? m_hdr->bytes() : nullptr; }
+
+  std::size_t size() const noexcept { return m_hdr ? m_hdr->size : 0u; }
+
+  bool empty() const noexcept { return size() == 0u; }
+
+  bool is_atomic() const noexcept { return m_hdr ? m_hdr->atomic_mode : true; }
+
+  // number of copies sharing the bytes, zero for a default constructed buffer
+  std::size_t use_count() const noexcept {
+    return m_hdr ? m_hdr->refcnt.load(std::memory_order_relaxed) : 0u;
+  }
+
+private:
+
+  static header* allocate(std::size_t sz, refcount_mode mode) {
+    return new (::operator new(sizeof(header) + sz)) header(sz, mode);
+  }
+
+  // in single thread mode the count is a plain load and store, no locked instruction
+  void add_ref() const noexcept {
+    if (!m_hdr) {
+      return;
+    }
+    if (m_hdr->atomic_mode) {
+      m_hdr->refcnt.fetch_add(1u, std::memory_order_relaxed);
+      return;
+    }
+    m_hdr->refcnt.store(m_hdr->refcnt.load(std::memory_order_relaxed) + 1u,
+                        std::memory_order_relaxed);
+  }
+
+  void release() noexcept {
+    if (!m_hdr) {
+      return;
+    }
+    if (m_hdr->atomic_mode) {
+      if (m_hdr->refcnt.fetch_sub(1u, std::memory_order_acq_rel) != 1u) {
+        return;
+      }
+    }
+    else {
+      auto cnt = m_hdr->refcnt.load(std::memory_order_relaxed);
+      if (cnt != 1u) {
+        m_hdr->refcnt.store(cnt - 1u, std::memory_order_relaxed);
+        return;
+      }
+    }
+    m_hdr->~header();
+    ::operator delete(m_hdr);
+    m_hdr = nullptr;
+  }
+
+};
+
+static_assert(sizeof(intrusive_buffer) == sizeof(void*), "intrusive_buffer handle is one pointer");
+
+/**
+ *  @brief Compare two @c intrusive_buffer objects for equality, the bytes are compared.
+ */
+inline bool operator==(const intrusive_buffer& lhs, const intrusive_buffer& rhs) noexcept {
+  return lhs.size() == rhs.size() &&
+         (lhs.data() == rhs.data() || lhs.size() == 0u ||
+          std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+inline bool operator!=(const intrusive_buffer& lhs, const intrusive_buffer& rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+} // end net namespace
+} // end chops namespace
+
+#endif
+
@@ -22,6 +22,7 @@
 #include "net_ip/detail/tcp_acceptor.hpp"
 #include "net_ip/detail/tcp_connector.hpp"
 #include "net_ip/detail/udp_entity_io.hpp"
+#include "net_ip/detail/udp_sharded_entity.hpp"
 
 namespace chops {
 namespace net {
@@ -47,6 +48,14 @@ using tcp_acceptor_net_entity = basic_net_entity<detail::tcp_acceptor>;
  */
 using udp_net_entity = basic_net_entity<detail::udp_entity_io>;
 
+/**
+ *  @brief Using declaration for a sharded UDP @c basic_net_entity type, where multiple
+ *  sockets on different @c io_context objects receive on the same local endpoint.
+ *
+ *  @relates basic_net_entity
+ */
+using udp_sharded_net_entity = basic_net_entity<detail::udp_sharded_entity>;
+
 } // end net namespace
 } // end chops namespace
 
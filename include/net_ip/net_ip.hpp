@@ -20,6 +20,7 @@
 
 #include <memory> // for std::shared_ptr
 #include <cstddef> // for std::size_t
+#include <utility> // std::move
 #include <string_view>
 #include <vector>
 #include <chrono>
@@ -38,6 +39,7 @@
 #include "net_ip/detail/tcp_connector.hpp"
 #include "net_ip/detail/tcp_acceptor.hpp"
 #include "net_ip/detail/udp_entity_io.hpp"
+#include "net_ip/detail/udp_sharded_entity.hpp"
 #include "net_ip/detail/tcp_io.hpp"
 
 #include "utility/erase_where.hpp"
@@ -106,7 +108,13 @@ namespace net {
  *    wk.reset(); // or wk.stop();
  *  @endcode
  *
- *  The @c net_ip class is safe for multiple threads to use concurrently. 
+ *  The @c net_ip class is safe for multiple threads to use concurrently.
+ *
+ *  The @c io_context can be run by multiple threads (e.g. a thread pool). Each
+ *  internal IO handler and network entity serializes its own handlers through an
+ *  @c asio::strand. If exactly one thread runs the @c io_context, the strands can
+ *  be elided by defining @c CHOPS_NET_IP_SINGLE_THREADED before including any
+ *  Chops Net IP header.
  *
  *  It should be noted, however, that race conditions are possible, specially for 
  *  similar operations invoked between @c net_entity and @c io_interface 
@@ -123,6 +131,7 @@ private:
   std::vector<detail::tcp_acceptor_ptr>  m_acceptors;
   std::vector<detail::tcp_connector_ptr> m_connectors;
   std::vector<detail::udp_entity_io_ptr> m_udp_entities;
+  std::vector<detail::udp_sharded_entity_ptr> m_udp_sharded_entities;
 
 private:
   using lg = std::lock_guard<std::mutex>;
@@ -135,7 +144,8 @@ public:
  *  @param ioc IO context for asynchronous operations.
  */
   explicit net_ip(asio::io_context& ioc) :
-    m_ioc(ioc), m_acceptors(), m_connectors(), m_udp_entities() { }
+    m_ioc(ioc), m_acceptors(), m_connectors(), m_udp_entities(),
+    m_udp_sharded_entities() { }
 
 private:
 
@@ -202,6 +212,72 @@ public:
     return tcp_acceptor_net_entity(p);
   }
 
+/**
+ *  @brief Create a TCP acceptor @c net_entity that places each accepted connection on
+ *  the @c io_context pinned to the CPU processing its incoming packets.
+ *
+ *  When a connection is handled on a different core than the one processing its network
+ *  interrupts, every packet moves between CPU caches. With this @c make method the 
+ *  acceptor reads the @c SO_INCOMING_CPU socket option (Linux) of each accepted 
+ *  connection and moves the socket to the @c io_context whose thread is pinned to that 
+ *  CPU, or to the nearest CPU if none is. The IO handler callbacks for the connection are
+ *  then invoked from that thread. Where the incoming CPU is not available connections are 
+ *  placed round-robin. Placement statistics are available through the @c net_entity
+ *  @c get_placement_stats method.
+ *
+ *  The @c worker class in the @c component directory can pin its thread to a CPU.
+ *
+ *  @param endp A @c asio::ip::tcp::endpoint that the acceptor uses for the local
+ *  bind (when @c start is called).
+ *
+ *  @param placements The @c io_context objects and the CPU each is pinned to, which must
+ *  outlive the accepted connections.
+ *
+ *  @param reuse_addr If @c true (default), the @c reuse_address socket option is set upon 
+ *  socket open.
+ *
+ *  @return @c tcp_acceptor_net_entity object.
+ *
+ */
+  tcp_acceptor_net_entity make_tcp_acceptor (const asio::ip::tcp::endpoint& endp,
+                                             std::vector<cpu_placement> placements,
+                                             bool reuse_addr = true) {
+    auto p = std::make_shared<detail::tcp_acceptor>(m_ioc, endp, reuse_addr, 
+                                                    std::move(placements));
+    lg g(m_mutex);
+    m_acceptors.push_back(p);
+    return tcp_acceptor_net_entity(p);
+  }
+
+/**
+ *  @brief Create a TCP acceptor @c net_entity that places each accepted connection on
+ *  the @c io_context returned from a placement function object.
+ *
+ *  This allows the set of @c io_context objects to change over time, e.g. with the
+ *  @c elastic_worker_pool in the @c component directory.
+ *
+ *  @param endp A @c asio::ip::tcp::endpoint that the acceptor uses for the local
+ *  bind (when @c start is called).
+ *
+ *  @param placement_func A @c connection_placement_func, invoked from the acceptor's 
+ *  @c io_context for each accepted connection.
+ *
+ *  @param reuse_addr If @c true (default), the @c reuse_address socket option is set upon 
+ *  socket open.
+ *
+ *  @return @c tcp_acceptor_net_entity object.
+ *
+ */
+  tcp_acceptor_net_entity make_tcp_acceptor (const asio::ip::tcp::endpoint& endp,
+                                             connection_placement_func placement_func,
+                                             bool reuse_addr = true) {
+    auto p = std::make_shared<detail::tcp_acceptor>(m_ioc, endp, reuse_addr, 
+                                                    std::move(placement_func));
+    lg g(m_mutex);
+    m_acceptors.push_back(p);
+    return tcp_acceptor_net_entity(p);
+  }
+
 /**
  *  @brief Create a TCP connector @c net_entity, which will perform an active TCP
  *  connect to the specified host and port (once started).
@@ -349,7 +425,9 @@ public:
  */
   udp_net_entity make_udp_unicast (const asio::ip::udp::endpoint& endp) {
     auto p = std::make_shared<detail::udp_entity_io>(m_ioc, endp);
-    asio::post(m_ioc.get_executor(), [p, this] () { m_udp_entities.push_back(p); } );
+//    asio::post(m_ioc.get_executor(), [p, this] () { m_udp_entities.push_back(p); } );
+    lg g(m_mutex);
+    m_udp_entities.push_back(p);
     return udp_net_entity(p);
   }
 
@@ -365,6 +443,52 @@ public:
     return make_udp_unicast(asio::ip::udp::endpoint());
   }
 
+/**
+ *  @brief Create a sharded UDP @c net_entity, where multiple UDP sockets bind to the same
+ *  local endpoint, each running on its own @c io_context.
+ *
+ *  A single UDP socket is read by one thread at a time, which limits the input rate to 
+ *  what one core can process. With a sharded entity one socket per @c io_context is bound
+ *  with the @c SO_REUSEPORT socket option, and the kernel spreads incoming flows (by
+ *  source and destination address and port) across the sockets. All datagrams from a 
+ *  given sender arrive on the same shard, so per-sender ordering is kept.
+ *
+ *  Each shard is a separate UDP IO handler, so the IO state change function object is 
+ *  invoked once per shard when @c start is called, and @c start_io is called on each 
+ *  @c basic_io_interface, usually with the same message handler. The count parameter of 
+ *  the IO state change callback is the number of shards currently up. Per-shard statistics
+ *  are available through the @c get_shard_stats method of the @c net_entity.
+ *
+ *  Optionally the kernel can instead pick the shard by the CPU handling the incoming 
+ *  packet (Linux only, using a classic BPF program attached with
+ *  @c SO_ATTACH_REUSEPORT_CBPF), so shard N receives the packets processed on CPU N modulo 
+ *  the number of shards. This keeps processing CPU-local when the thread running 
+ *  @c io_context N is pinned to CPU N. If the program cannot be attached an error is
+ *  reported through the error function object and flow hashing is used.
+ *
+ *  On platforms without @c SO_REUSEPORT only one shard is created, on the first 
+ *  @c io_context.
+ *
+ *  @param endp A @c asio::ip::udp::endpoint used for the local bind of each shard 
+ *  (when @c start is called).
+ *
+ *  @param iocs The @c io_context objects, one per shard, which must not be empty and 
+ *  must outlive the @c net_entity.
+ *
+ *  @param cpu_steering If @c true, attach the CPU steering program.
+ *
+ *  @return @c udp_sharded_net_entity object.
+ *
+ */
+  udp_sharded_net_entity make_udp_sharded (const asio::ip::udp::endpoint& endp,
+                                           const std::vector<asio::io_context*>& iocs,
+                                           bool cpu_steering = false) {
+    auto p = std::make_shared<detail::udp_sharded_entity>(iocs, endp, cpu_steering);
+    lg g(m_mutex);
+    m_udp_sharded_entities.push_back(p);
+    return udp_sharded_net_entity(p);
+  }
+
 // TODO: multicast make methods 
 
 /**
@@ -426,6 +550,21 @@ public:
     chops::erase_where(m_udp_entities, udp_ent.get_shared_ptr());
   }
 
+/**
+ *  @brief Remove a sharded UDP @c net_entity from the internal list of sharded UDP 
+ *  entities.
+ *
+ *  @c stop should first be called by the application, or the @c stop_all 
+ *  method can be called to stop all net entities.
+ *
+ *  @param udp_ent Sharded UDP @c net_entity to be removed.
+ *
+ */
+  void remove(udp_sharded_net_entity udp_ent) {
+    lg g(m_mutex);
+    chops::erase_where(m_udp_sharded_entities, udp_ent.get_shared_ptr());
+  }
+
 /**
  *  @brief Remove all acceptors, connectors, and UDP entities.
  *
@@ -441,6 +580,7 @@ public:
 //      }
 //    );
     lg g(m_mutex);
+    m_udp_sharded_entities.clear();
     m_udp_entities.clear();
     m_connectors.clear();
     m_acceptors.clear();
@@ -460,6 +600,7 @@ public:
 //      }
 //    );
     lg g(m_mutex);
+    for (auto i : m_udp_sharded_entities) { i->stop(); }
     for (auto i : m_udp_entities) { i->stop(); }
     for (auto i : m_connectors) { i->stop(); }
     for (auto i : m_acceptors) { i->stop(); }
@@ -24,6 +24,8 @@
 #include <system_error>
 #include <string>
 
+#include "nonstd/expected.hpp"
+
 namespace chops {
 namespace net {
 
@@ -35,6 +37,8 @@ enum class net_ip_errc {
   tcp_acceptor_stopped = 5,
   tcp_connector_stopped = 6,
   udp_entity_stopped = 7,
+  io_already_started = 8,
+  io_not_started = 9,
 };
 
 namespace detail {
@@ -59,6 +63,10 @@ struct net_ip_err_category : public std::error_category {
       return "tcp connector stopped";
     case net_ip_errc::udp_entity_stopped:
       return "udp entity stopped";
+    case net_ip_errc::io_already_started:
+      return "io already started";
+    case net_ip_errc::io_not_started:
+      return "io not started";
     }
     return "(unknown error)";
   }
@@ -101,6 +109,17 @@ public:
   std::error_code err;
 };
 
+/**
+ *  @brief Return type of the non-throwing (@c try_) methods, holding either a value 
+ *  (possibly @c void) or the @c std::error_code that the corresponding throwing method
+ *  would have thrown in a @c net_ip_exception.
+ *
+ *  This is Martin Moene's @c expected-lite, which uses @c std::expected when it is
+ *  available.
+ */
+template <typename T>
+using expected = nonstd::expected<T, std::error_code>;
+
 } // end net namespace
 } // end chops namespace
 
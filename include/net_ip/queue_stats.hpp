@@ -2,7 +2,7 @@
  *
  *  @ingroup net_ip_module
  *
- *  @brief Structures containing statistics gathered on internal queues.
+ *  @brief Structures containing statistics gathered on internal queues and IO handlers.
  *
  *  @author Cliff Green
  *
@@ -17,21 +17,160 @@
 #define QUEUE_STATS_HPP_INCLUDED
 
 #include <cstddef> // std::size_t 
+#include <array>
+#include <chrono>
 
 namespace chops {
 namespace net {
 
+/**
+ *  @brief Number of priority lanes in each output queue.
+ *
+ *  Lane 0 is the highest priority lane. A lane number greater than the maximum
+ *  is treated as the lowest priority lane.
+ */
+constexpr std::size_t max_output_lanes = 4;
+
+/**
+ *  @brief @c output_lane_stats provides information on one priority lane of 
+ *  the internal output queue.
+ */
+
+struct output_lane_stats {
+
+  std::size_t output_queue_size = 0;
+  std::size_t bytes_in_output_queue = 0;
+};
+
 /**
  *  @brief @c output_queue_stats provides information on the internal output 
  *  queue.
+ *
+ *  The queue size and bytes fields are totals across all priority lanes, and the
+ *  @c lanes array provides the same information for each lane.
+ *
+ *  The expired counts are cumulative, and are incremented when a queued buffer 
+ *  exceeds its maximum age and is discarded instead of being sent. The conflated
+ *  count is cumulative, and is incremented when a keyed send replaces a queued
+ *  buffer with the same key. The sent totals are cumulative, and are incremented 
+ *  when a write completes (the data has been handed to the OS).
+ *
+ *  The write counts are cumulative; multiple buffers can be written in one gathered 
+ *  write (TCP only), so @c total_bufs_sent divided by @c total_writes is the average 
+ *  batch size. The coalesce fields are only non-zero when an output coalescing window 
+ *  is set, and count the windows and the total time buffers were held back by them.
+ *
+ *  The speculative write fields are only non-zero when speculative writes are enabled
+ *  (TCP only), and count the writes attempted inline and how many of them were written
+ *  completely, without an asynchronous write for the remainder.
  */
 
 struct output_queue_stats {
 
   std::size_t output_queue_size = 0;
   std::size_t bytes_in_output_queue = 0;
-  // std::size_t total_bufs_sent;
-  // std::size_t total_bytes_sent;
+  std::size_t expired_bufs = 0;
+  std::size_t expired_bytes = 0;
+  std::size_t conflated_bufs = 0;
+  std::array<output_lane_stats, max_output_lanes> lanes { };
+  std::size_t total_bufs_sent = 0;
+  std::size_t total_bytes_sent = 0;
+  std::size_t total_writes = 0;
+  std::size_t max_write_batch = 0;
+  std::size_t coalesce_windows = 0;
+  std::chrono::steady_clock::duration total_coalesce_delay { };
+  std::size_t speculative_writes = 0;
+  std::size_t speculative_writes_completed = 0;
+};
+
+/**
+ *  @brief @c input_stats provides information on the input side of an IO handler.
+ *
+ *  The totals are cumulative, and are incremented each time a message is delivered
+ *  to the message handler, so the busiest connections can be found by comparing them.
+ *  The yield count is incremented each time the read budget (see 
+ *  @c basic_io_interface::set_read_budget) is used up and the IO handler lets other
+ *  handlers run before reading more data.
+ */
+
+struct input_stats {
+
+  std::size_t total_msgs_read = 0;
+  std::size_t total_bytes_read = 0;
+  std::size_t read_budget_yields = 0;
+};
+
+/**
+ *  @brief @c ring_queue_stats provides information on the bounded lock-free queues used
+ *  to hand data from IO threads to an application thread (e.g. @c msg_handoff).
+ *
+ *  Occupancy is the current number of entries, and the high water mark is the maximum
+ *  seen. The pushed and dropped counts are cumulative; an entry is dropped when the queue
+ *  is full. The park count is incremented each time the consumer blocks waiting for data.
+ */
+
+struct ring_queue_stats {
+
+  std::size_t capacity = 0;
+  std::size_t occupancy = 0;
+  std::size_t high_water = 0;
+  std::size_t total_pushed = 0;
+  std::size_t total_dropped = 0;
+  std::size_t consumer_parks = 0;
+};
+
+/**
+ *  @brief @c shard_stats provides information on one socket of a sharded UDP entity.
+ *
+ *  Comparing the input totals across shards shows how evenly the kernel is spreading
+ *  incoming flows.
+ */
+
+struct shard_stats {
+
+  input_stats input;
+  output_queue_stats output;
+};
+
+/**
+ *  @brief @c placement_stats provides information on CPU-affine placement of the
+ *  connections accepted by a TCP acceptor.
+ *
+ *  A connection is placed locally when an @c io_context is pinned to the CPU that
+ *  processes its incoming packets, otherwise it is placed on the @c io_context pinned to
+ *  the nearest CPU. When the incoming CPU is not available (e.g. not supported by the
+ *  platform) connections are placed round-robin. A placement failure means the socket 
+ *  could not be moved and the connection stays on the acceptor's @c io_context. When a
+ *  placement function is used instead, only the total and failure counts are incremented.
+ *  All counts are cumulative.
+ */
+
+struct placement_stats {
+
+  std::size_t total_placed = 0;
+  std::size_t placed_local = 0;
+  std::size_t placed_nearest = 0;
+  std::size_t placed_round_robin = 0;
+  std::size_t placement_failures = 0;
+};
+
+/**
+ *  @brief @c object_pool_stats provides information on the pool of recycled TCP IO 
+ *  handler memory blocks of a TCP acceptor or TCP connector.
+ *
+ *  A pool hit is an IO handler created in a pre-allocated or recycled block, a miss
+ *  needed a new allocation. Owned blocks are the blocks in use plus the free blocks. The
+ *  allocation, hit and miss counts are cumulative. All counts are zero if the net entity
+ *  does not have a pool.
+ */
+
+struct object_pool_stats {
+
+  std::size_t total_allocs = 0;
+  std::size_t pool_hits = 0;
+  std::size_t pool_misses = 0;
+  std::size_t blocks_owned = 0;
+  std::size_t blocks_free = 0;
 };
 
 } // end net namespace
@@ -35,16 +35,20 @@
 #include <cstddef> // std::size_t, std::byte
 #include <cstdint> // std::uint16_t
 #include <vector>
+#include <array>
 #include <utility> // std::forward, std::move
 #include <atomic>
 #include <memory> // std::shared_ptr
 #include <thread>
 #include <system_error>
+#include <chrono>
+#include <functional>
 
 #include <cassert>
 #include <limits>
 
 #include "asio/buffer.hpp"
+#include "asio/io_context.hpp"
 #include "asio/ip/udp.hpp" // ip::udp::endpoint
 #include "asio/ip/address.hpp" // make_address
 
@@ -151,6 +155,25 @@ struct msg_hdlr {
 using tcp_msg_hdlr = msg_hdlr<chops::net::tcp_io>;
 using udp_msg_hdlr = msg_hdlr<chops::net::udp_io>;
 
+// batch handler that processes each message the same as msg_hdlr
+struct tcp_batch_msg_hdlr {
+  tcp_msg_hdlr       hdlr;
+  test_counter&      batch_cnt;
+
+  tcp_batch_msg_hdlr(bool rep, test_counter& c, test_counter& bc) : hdlr(rep, c), batch_cnt(bc) { }
+
+  bool operator()(const std::vector<asio::const_buffer>& bufs, 
+                  chops::net::tcp_io_interface io_intf, asio::ip::tcp::endpoint endp) {
+    ++batch_cnt;
+    for (const auto& buf : bufs) {
+      if (!hdlr(buf, io_intf, endp)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
 inline bool tcp_start_io (chops::net::tcp_io_interface io, bool reply, 
                    std::string_view delim, test_counter& cnt) {
   if (delim.empty()) {
@@ -160,6 +183,15 @@ inline bool tcp_start_io (chops::net::tcp_io_interface io, bool reply,
   return io.start_io(delim, tcp_msg_hdlr(reply, cnt));
 }
 
+inline bool tcp_start_io_batch (chops::net::tcp_io_interface io, bool reply, 
+                                std::string_view delim, test_counter& cnt, test_counter& batch_cnt) {
+  if (delim.empty()) {
+    return io.start_io_batch(2, tcp_batch_msg_hdlr(reply, cnt, batch_cnt), 
+                       chops::net::make_simple_variable_len_msg_frame(decode_variable_len_msg_hdr));
+  }
+  return io.start_io_batch(delim, tcp_batch_msg_hdlr(reply, cnt, batch_cnt));
+}
+
 constexpr int udp_max_buf_size = 65507;
 
 inline bool udp_start_io (chops::net::udp_io_interface io, bool reply, test_counter& cnt) {
@@ -174,7 +206,7 @@ inline bool udp_start_io (chops::net::udp_io_interface io, bool receiving, test_
   return io.start_io(remote_endp);
 }
 
-struct io_handler_mock {
+struct io_handler_mock : public std::enable_shared_from_this<io_handler_mock> {
   using socket_type = int;
   using endpoint_type = asio::ip::udp::endpoint;
 
@@ -190,10 +222,63 @@ struct io_handler_mock {
     return chops::net::output_queue_stats { qs_base, qs_base +1 };
   }
 
+  chops::net::input_stats get_input_stats() const { 
+    return chops::net::input_stats { qs_base, qs_base + 1 };
+  }
+
+  std::size_t read_budget_msgs = 0;
+
+  void set_read_budget(std::size_t m, std::size_t) { read_budget_msgs = m; }
+
+  asio::io_context* migrate_ioc = nullptr;
+
+  void migrate_to(asio::io_context& ioc) { migrate_ioc = &ioc; }
+
   bool send_called = false;
 
   void send(chops::const_shared_buffer) { send_called = true; }
   void send(chops::const_shared_buffer, const endpoint_type&) { send_called = true; }
+  void send(chops::const_shared_buffer, std::chrono::steady_clock::duration) { send_called = true; }
+  void send(chops::const_shared_buffer, const endpoint_type&, 
+            std::chrono::steady_clock::duration) { send_called = true; }
+
+  void send(std::uint64_t, chops::const_shared_buffer) { send_called = true; }
+  void send(std::uint64_t, chops::const_shared_buffer, const endpoint_type&) { send_called = true; }
+  void send(chops::const_shared_buffer, std::size_t) { send_called = true; }
+  void send(chops::const_shared_buffer, const endpoint_type&, std::size_t) { send_called = true; }
+  void send(std::uint64_t, chops::const_shared_buffer, std::size_t) { send_called = true; }
+  template <std::size_t N>
+  void send(const std::array<chops::const_shared_buffer, N>&) { send_called = true; }
+  template <std::size_t N>
+  void send(const std::array<chops::const_shared_buffer, N>&, std::size_t) { send_called = true; }
+  void send(chops::net::intrusive_buffer) { send_called = true; }
+  void send(chops::net::intrusive_buffer, const endpoint_type&) { send_called = true; }
+
+  std::chrono::steady_clock::duration max_age { };
+
+  void set_output_max_age(std::chrono::steady_clock::duration ma) { max_age = ma; }
+
+  std::size_t lane_weight = 0;
+
+  void set_output_lane_weight(std::size_t, std::size_t w) { lane_weight = w; }
+
+  std::chrono::steady_clock::duration coalesce_delay { };
+
+  void set_output_coalescing(std::chrono::steady_clock::duration d, std::size_t) { coalesce_delay = d; }
+
+  bool speculative_write = false;
+
+  void set_speculative_write(bool enable) { speculative_write = enable; }
+
+  std::size_t speculative_read_budget = 0;
+
+  void set_speculative_read(std::size_t budget) { speculative_read_budget = budget; }
+
+  std::function<void (std::size_t, std::size_t)> write_complete_cb;
+
+  void set_write_completion_handler(std::function<void (std::size_t, std::size_t)> cb) { 
+    write_complete_cb = cb;
+  }
 
   bool mf_sio_called = false;
   bool delim_sio_called = false;
@@ -201,33 +286,51 @@ struct io_handler_mock {
   bool rd_endp_sio_called = false;
   bool send_sio_called = false;
   bool send_endp_sio_called = false;
+  bool mf_batch_sio_called = false;
+  bool delim_batch_sio_called = false;
+  bool rd_batch_sio_called = false;
 
   template <typename MH, typename MF>
   bool start_io(std::size_t, MH&&, MF&&) {
-    return started ? false : started = true, mf_sio_called = true, true;
+    return started ? false : (started = true, mf_sio_called = true, true);
   }
 
   template <typename MH>
   bool start_io(std::string_view, MH&&) {
-    return started ? false : started = true, delim_sio_called = true, true;
+    return started ? false : (started = true, delim_sio_called = true, true);
   }
 
   template <typename MH>
   bool start_io(std::size_t, MH&&) {
-    return started ? false : started = true, rd_sio_called = true, true;
+    return started ? false : (started = true, rd_sio_called = true, true);
   }
 
   template <typename MH>
   bool start_io(const endpoint_type&, std::size_t, MH&&) {
-    return started ? false : started = true, rd_endp_sio_called = true, true;
+    return started ? false : (started = true, rd_endp_sio_called = true, true);
   }
 
   bool start_io() {
-    return started ? false : started = true, send_sio_called = true, true;
+    return started ? false : (started = true, send_sio_called = true, true);
+  }
+
+  template <typename MH, typename MF>
+  bool start_io_batch(std::size_t, MH&&, MF&&) {
+    return started ? false : (started = true, mf_batch_sio_called = true, true);
+  }
+
+  template <typename MH>
+  bool start_io_batch(std::string_view, MH&&) {
+    return started ? false : (started = true, delim_batch_sio_called = true, true);
+  }
+
+  template <typename MH>
+  bool start_io_batch(std::size_t, MH&&) {
+    return started ? false : (started = true, rd_batch_sio_called = true, true);
   }
 
   bool start_io(const endpoint_type&) {
-    return started ? false : started = true, send_endp_sio_called = true, true;
+    return started ? false : (started = true, send_endp_sio_called = true, true);
   }
 
   bool stop_io() {
@@ -258,6 +361,20 @@ struct net_entity_mock {
 
   double& get_socket() { return dummy; }
 
+  std::vector<chops::net::shard_stats> get_shard_stats() const {
+    return std::vector<chops::net::shard_stats>(2u);
+  }
+
+  chops::net::placement_stats get_placement_stats() const {
+    return chops::net::placement_stats { 3u, 1u, 1u, 1u, 0u };
+  }
+
+  bool enable_io_pool(std::size_t, std::size_t) { return !started; }
+
+  chops::net::object_pool_stats get_io_pool_stats() const {
+    return chops::net::object_pool_stats { 5u, 4u, 1u, 3u, 2u };
+  }
+
   template <typename F1, typename F2>
   bool start(F1&& io_state_chg_func, F2&& err_func ) {
     if (started) {
@@ -15,9 +15,11 @@
 
 #include "catch2/catch.hpp"
 
+#include <array>
 #include <memory> // std::shared_ptr
 #include <set>
 #include <cstddef> // std::size_t
+#include <chrono>
 
 #include "net_ip/queue_stats.hpp"
 #include "net_ip/basic_io_interface.hpp"
@@ -47,6 +49,10 @@ void basic_io_interface_test_default_constructed() {
         REQUIRE_THROWS (io_intf.is_io_started());
         REQUIRE_THROWS (io_intf.get_socket());
         REQUIRE_THROWS (io_intf.get_output_queue_stats());
+        REQUIRE_THROWS (io_intf.get_input_stats());
+        REQUIRE_THROWS (io_intf.set_read_budget(10u));
+        asio::io_context ioc;
+        REQUIRE_THROWS (io_intf.migrate_to(ioc));
 
         REQUIRE_THROWS (io_intf.send(nullptr, 0));
         REQUIRE_THROWS (io_intf.send(buf));
@@ -54,6 +60,23 @@ void basic_io_interface_test_default_constructed() {
         REQUIRE_THROWS (io_intf.send(nullptr, 0, endp_t()));
         REQUIRE_THROWS (io_intf.send(buf, endp_t()));
         REQUIRE_THROWS (io_intf.send(chops::mutable_shared_buffer(), endp_t()));
+        REQUIRE_THROWS (io_intf.send(buf, std::chrono::milliseconds(200)));
+        REQUIRE_THROWS (io_intf.send(buf, endp_t(), std::chrono::milliseconds(200)));
+        REQUIRE_THROWS (io_intf.set_output_max_age(std::chrono::milliseconds(200)));
+        REQUIRE_THROWS (io_intf.send(42u, buf));
+        REQUIRE_THROWS (io_intf.send(42u, buf, endp_t()));
+        REQUIRE_THROWS (io_intf.send(buf, 1u));
+        REQUIRE_THROWS (io_intf.send(buf, endp_t(), 1u));
+        REQUIRE_THROWS (io_intf.send(42u, buf, 1u));
+        REQUIRE_THROWS (io_intf.send(std::array<chops::const_shared_buffer, 2> { buf, buf }));
+        REQUIRE_THROWS (io_intf.send(std::array<chops::const_shared_buffer, 2> { buf, buf }, 1u));
+        REQUIRE_THROWS (io_intf.send(chops::net::intrusive_buffer(buf)));
+        REQUIRE_THROWS (io_intf.send(chops::net::intrusive_buffer(buf), endp_t()));
+        REQUIRE_THROWS (io_intf.set_output_lane_weight(0u, 3u));
+        REQUIRE_THROWS (io_intf.set_output_coalescing(std::chrono::microseconds(100)));
+        REQUIRE_THROWS (io_intf.set_speculative_write(true));
+        REQUIRE_THROWS (io_intf.set_speculative_read(8u));
+        REQUIRE_THROWS (io_intf.set_write_completion_handler([] (std::size_t, std::size_t) { }));
 
         REQUIRE_THROWS (io_intf.start_io(0, [] { }, [] { }));
         REQUIRE_THROWS (io_intf.start_io("testing, hah!", [] { }));
@@ -61,10 +84,42 @@ void basic_io_interface_test_default_constructed() {
         REQUIRE_THROWS (io_intf.start_io(endp_t(), 0, [] { }));
         REQUIRE_THROWS (io_intf.start_io());
         REQUIRE_THROWS (io_intf.start_io(endp_t()));
+        REQUIRE_THROWS (io_intf.start_io_batch(0, [] { }, [] { }));
+        REQUIRE_THROWS (io_intf.start_io_batch("testing, hah!", [] { }));
+        REQUIRE_THROWS (io_intf.start_io_batch(0, [] { }));
 
         REQUIRE_THROWS (io_intf.stop_io());
       }
     }
+    AND_WHEN ("a try_ method is called on an invalid basic_io_interface") {
+      THEN ("an error is returned instead of an exception being thrown") {
+
+        chops::const_shared_buffer buf(nullptr, 0);
+        using endp_t = typename IOT::endpoint_type;
+        auto expired = std::make_error_code(chops::net::net_ip_errc::weak_ptr_expired);
+
+        REQUIRE_FALSE (io_intf.try_send(nullptr, 0).has_value());
+        REQUIRE (io_intf.try_send(buf).error() == expired);
+        REQUIRE_FALSE (io_intf.try_send(chops::mutable_shared_buffer()).has_value());
+        REQUIRE_FALSE (io_intf.try_send(buf, std::chrono::milliseconds(200)).has_value());
+        REQUIRE_FALSE (io_intf.try_send(buf, 1u).has_value());
+        REQUIRE_FALSE (io_intf.try_send(42u, buf).has_value());
+        REQUIRE_FALSE (io_intf.try_send(42u, buf, 1u).has_value());
+        REQUIRE_FALSE (io_intf.try_send(std::array<chops::const_shared_buffer, 2> { buf, buf }).has_value());
+        REQUIRE_FALSE (io_intf.try_send(std::array<chops::const_shared_buffer, 2> { buf, buf }, 1u).has_value());
+        REQUIRE_FALSE (io_intf.try_send(nullptr, 0, endp_t()).has_value());
+        REQUIRE_FALSE (io_intf.try_send(buf, endp_t()).has_value());
+        REQUIRE_FALSE (io_intf.try_send(buf, endp_t(), std::chrono::milliseconds(200)).has_value());
+        REQUIRE_FALSE (io_intf.try_send(buf, endp_t(), 1u).has_value());
+        REQUIRE_FALSE (io_intf.try_send(42u, buf, endp_t()).has_value());
+        REQUIRE_FALSE (io_intf.try_send(chops::mutable_shared_buffer(), endp_t()).has_value());
+        REQUIRE_FALSE (io_intf.try_send(chops::net::intrusive_buffer(buf)).has_value());
+        REQUIRE_FALSE (io_intf.try_send(chops::net::intrusive_buffer(buf), endp_t()).has_value());
+        REQUIRE (io_intf.try_start_io(0, [] { }, [] { }).error() == expired);
+        REQUIRE (io_intf.try_start_io().error() == expired);
+        REQUIRE (io_intf.try_stop_io().error() == expired);
+      }
+    }
   } // end given
 
 }
@@ -89,6 +144,9 @@ void basic_io_interface_test_methods() {
         chops::net::output_queue_stats s = io_intf.get_output_queue_stats();
         REQUIRE (s.output_queue_size == chops::test::io_handler_mock::qs_base);
         REQUIRE (s.bytes_in_output_queue == (chops::test::io_handler_mock::qs_base + 1));
+        chops::net::input_stats is = io_intf.get_input_stats();
+        REQUIRE (is.total_msgs_read == chops::test::io_handler_mock::qs_base);
+        REQUIRE (is.total_bytes_read == (chops::test::io_handler_mock::qs_base + 1));
       }
     }
     AND_WHEN ("send or start_io or stop_io is called") {
@@ -105,7 +163,35 @@ void basic_io_interface_test_methods() {
         io_intf.send(nullptr, 0, endp_t());
         io_intf.send(buf, endp_t());
         io_intf.send(chops::mutable_shared_buffer(), endp_t());
+        io_intf.send(buf, std::chrono::milliseconds(200));
+        io_intf.send(buf, endp_t(), std::chrono::milliseconds(200));
+        io_intf.send(42u, buf);
+        io_intf.send(42u, buf, endp_t());
+        io_intf.send(buf, 1u);
+        io_intf.send(buf, endp_t(), 1u);
+        io_intf.send(42u, buf, 1u);
+        io_intf.send(std::array<chops::const_shared_buffer, 2> { buf, buf });
+        io_intf.send(std::array<chops::const_shared_buffer, 3> { buf, buf, buf }, 1u);
+        io_intf.send(chops::net::intrusive_buffer(buf));
+        io_intf.send(chops::net::intrusive_buffer(buf), endp_t());
         REQUIRE(ioh->send_called);
+        io_intf.set_output_lane_weight(0u, 3u);
+        REQUIRE(ioh->lane_weight == 3u);
+        io_intf.set_output_coalescing(std::chrono::microseconds(100), 1024u);
+        REQUIRE(ioh->coalesce_delay == std::chrono::microseconds(100));
+        io_intf.set_speculative_write(true);
+        REQUIRE(ioh->speculative_write);
+        io_intf.set_speculative_read(8u);
+        io_intf.set_read_budget(10u, 2048u);
+        REQUIRE(ioh->read_budget_msgs == 10u);
+        REQUIRE(ioh->speculative_read_budget == 8u);
+        asio::io_context ioc;
+        io_intf.migrate_to(ioc);
+        REQUIRE(ioh->migrate_ioc == &ioc);
+        io_intf.set_write_completion_handler([] (std::size_t, std::size_t) { });
+        REQUIRE(ioh->write_complete_cb);
+        io_intf.set_output_max_age(std::chrono::milliseconds(200));
+        REQUIRE(ioh->max_age == std::chrono::milliseconds(200));
 
         REQUIRE (io_intf.start_io(0, [] { }, [] { }));
         REQUIRE (io_intf.is_io_started());
@@ -126,9 +212,58 @@ void basic_io_interface_test_methods() {
         REQUIRE (io_intf.start_io());
         REQUIRE (io_intf.is_io_started());
         REQUIRE (io_intf.stop_io());
+        REQUIRE (io_intf.start_io_batch(0, [] { }, [] { }));
+        REQUIRE (ioh->mf_batch_sio_called);
+        REQUIRE (io_intf.stop_io());
+        REQUIRE (io_intf.start_io_batch("testing, hah!", [] { }));
+        REQUIRE (ioh->delim_batch_sio_called);
+        REQUIRE (io_intf.stop_io());
+        REQUIRE (io_intf.start_io_batch(0, [] { }));
+        REQUIRE (ioh->rd_batch_sio_called);
+        REQUIRE (io_intf.stop_io());
         REQUIRE_FALSE (io_intf.is_io_started());
       }
     }
+    AND_WHEN ("try_send or try_start_io or try_stop_io is called") {
+      THEN ("an empty expected or the appropriate error is returned") {
+
+        chops::const_shared_buffer buf(nullptr, 0);
+        using endp_t = typename IOT::endpoint_type;
+
+        // each try_send is checked to reach the io handler send
+        auto sent = [&ioh] (chops::net::expected<void> r) {
+          bool called = ioh->send_called;
+          ioh->send_called = false;
+          return r.has_value() && called;
+        };
+        ioh->send_called = false;
+        REQUIRE (sent(io_intf.try_send(nullptr, 0)));
+        REQUIRE (sent(io_intf.try_send(buf)));
+        REQUIRE (sent(io_intf.try_send(chops::mutable_shared_buffer())));
+        REQUIRE (sent(io_intf.try_send(chops::net::intrusive_buffer(buf))));
+        REQUIRE (sent(io_intf.try_send(buf, std::chrono::milliseconds(200))));
+        REQUIRE (sent(io_intf.try_send(buf, 1u)));
+        REQUIRE (sent(io_intf.try_send(42u, buf)));
+        REQUIRE (sent(io_intf.try_send(42u, buf, 1u)));
+        REQUIRE (sent(io_intf.try_send(std::array<chops::const_shared_buffer, 2> { buf, buf })));
+        REQUIRE (sent(io_intf.try_send(std::array<chops::const_shared_buffer, 3> { buf, buf, buf }, 1u)));
+        REQUIRE (sent(io_intf.try_send(nullptr, 0, endp_t())));
+        REQUIRE (sent(io_intf.try_send(buf, endp_t())));
+        REQUIRE (sent(io_intf.try_send(buf, endp_t(), std::chrono::milliseconds(200))));
+        REQUIRE (sent(io_intf.try_send(buf, endp_t(), 1u)));
+        REQUIRE (sent(io_intf.try_send(42u, buf, endp_t())));
+        REQUIRE (sent(io_intf.try_send(chops::mutable_shared_buffer(), endp_t())));
+        REQUIRE (sent(io_intf.try_send(chops::net::intrusive_buffer(buf), endp_t())));
+
+        REQUIRE (io_intf.try_start_io(0, [] { }).has_value());
+        REQUIRE (ioh->rd_sio_called);
+        REQUIRE (io_intf.try_start_io(0, [] { }).error() == 
+                 std::make_error_code(chops::net::net_ip_errc::io_already_started));
+        REQUIRE (io_intf.try_stop_io().has_value());
+        REQUIRE (io_intf.try_stop_io().error() == 
+                 std::make_error_code(chops::net::net_ip_errc::io_not_started));
+      }
+    }
   } // end given
 
 }
@@ -187,10 +322,45 @@ void basic_io_interface_test_compare() {
 
 }
 
+template <typename IOT>
+void basic_io_interface_test_borrowed() {
+
+  auto ioh = std::make_shared<IOT>();
+
+  GIVEN ("A basic_io_interface borrowing an io handler, as passed to a message handler") {
+    chops::net::basic_io_interface<IOT> borrowed(*ioh);
+
+    WHEN ("methods are called on it") {
+      borrowed.send(chops::const_shared_buffer(nullptr, 0));
+      THEN ("they go to the io handler without a reference being taken") {
+        REQUIRE (borrowed.is_valid());
+        REQUIRE (ioh->send_called);
+        REQUIRE (ioh.use_count() == 1);
+        REQUIRE (borrowed == chops::net::basic_io_interface<IOT>(ioh));
+        REQUIRE (borrowed.get_shared_ptr() == ioh);
+      }
+    }
+    AND_WHEN ("it is copied and the io handler goes away") {
+      chops::net::basic_io_interface<IOT> kept(borrowed);
+      chops::net::basic_io_interface<IOT> moved(std::move(borrowed));
+      REQUIRE (kept.is_valid());
+      REQUIRE (moved == kept);
+      ioh.reset();
+      THEN ("the copies hold a weak pointer and are no longer valid") {
+        REQUIRE_FALSE (kept.is_valid());
+        REQUIRE_FALSE (moved.is_valid());
+        REQUIRE_FALSE (kept.try_send(nullptr, 0).has_value());
+      }
+    }
+  } // end given
+
+}
+
 SCENARIO ( "Basic io interface test, io_handler_mock used for IO handler type",
            "[basic_io_interface] [io_handler_mock]" ) {
   basic_io_interface_test_default_constructed<chops::test::io_handler_mock>();
   basic_io_interface_test_methods<chops::test::io_handler_mock>();
   basic_io_interface_test_compare<chops::test::io_handler_mock>();
+  basic_io_interface_test_borrowed<chops::test::io_handler_mock>();
 }
 
@@ -41,6 +41,10 @@ void basic_net_entity_test_default_constructed() {
         REQUIRE_THROWS (net_ent.is_started());
         REQUIRE_THROWS (net_ent.start(chops::test::io_state_chg_mock, chops::test::err_func_mock));
         REQUIRE_THROWS (net_ent.stop());
+        REQUIRE_THROWS (net_ent.get_shard_stats());
+        REQUIRE_THROWS (net_ent.get_placement_stats());
+        REQUIRE_THROWS (net_ent.enable_io_pool(10u));
+        REQUIRE_THROWS (net_ent.get_io_pool_stats());
       }
     }
   } // end given
@@ -79,6 +83,26 @@ void basic_net_entity_test_methods() {
         REQUIRE (net_ent.get_socket() == chops::test::net_entity_mock::special_val);
       }
     }
+    AND_WHEN ("get_shard_stats is called") {
+      THEN ("the stats of each shard are returned") {
+        REQUIRE (net_ent.get_shard_stats().size() == 2u);
+      }
+    }
+    AND_WHEN ("get_placement_stats is called") {
+      THEN ("the placement stats are returned") {
+        auto ps = net_ent.get_placement_stats();
+        REQUIRE (ps.total_placed == 3u);
+        REQUIRE (ps.placed_local == 1u);
+      }
+    }
+    AND_WHEN ("enable_io_pool and get_io_pool_stats are called") {
+      THEN ("the pool is enabled and the pool stats are returned") {
+        REQUIRE (net_ent.enable_io_pool(10u, 20u));
+        auto ps = net_ent.get_io_pool_stats();
+        REQUIRE (ps.total_allocs == 5u);
+        REQUIRE (ps.pool_hits == 4u);
+      }
+    }
   } // end given
 
 }
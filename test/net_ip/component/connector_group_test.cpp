@@ -0,0 +1,242 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenarios for the @c connector_group class, with TCP connectors
+ *  connecting to a TCP acceptor on loopback.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include "asio/ip/tcp.hpp"
+#include "asio/io_context.hpp"
+
+#include <system_error> // std::error_code
+#include <cstddef> // std::size_t
+#include <memory> // std::make_shared
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <thread> // std::this_thread::sleep_for
+
+#include "net_ip/component/connector_group.hpp"
+#include "net_ip/component/worker.hpp"
+
+#include "net_ip/detail/tcp_acceptor.hpp"
+#include "net_ip/detail/tcp_connector.hpp"
+#include "net_ip/net_entity.hpp"
+#include "net_ip/io_interface.hpp"
+
+#include "utility/repeat.hpp"
+
+constexpr unsigned short group_test_port = 30995;
+
+void connector_group_test (int num_conns, std::size_t max_in_flight, double ramp_rate,
+                           int num_high_priority) {
+
+  chops::net::worker wk;
+  wk.start();
+  auto& ioc = wk.get_io_context();
+
+  asio::ip::tcp::endpoint endp(asio::ip::make_address("127.0.0.1"), group_test_port);
+  auto acc_ptr = std::make_shared<chops::net::detail::tcp_acceptor>(ioc, endp, true);
+  acc_ptr->start( [] (chops::net::tcp_io_interface, std::size_t, bool) { },
+                  [] (chops::net::tcp_io_interface, std::error_code) { } );
+
+  std::mutex order_mutex;
+  std::vector<int> connect_order;
+
+  GIVEN ("A connector group and a set of connectors, some with a higher priority") {
+
+    std::vector<chops::net::detail::tcp_connector_ptr> conn_ptrs;
+    {
+      chops::net::connector_group grp(ioc, max_in_flight, ramp_rate);
+
+      std::vector<asio::ip::tcp::endpoint> endps { endp };
+      chops::repeat(num_conns, [&] (int i) {
+          conn_ptrs.push_back(std::make_shared<chops::net::detail::tcp_connector>(ioc,
+                                  endps.cbegin(), endps.cend(), std::chrono::milliseconds(100)));
+          // the high priority connectors are added last, but start first
+          int prio = (i >= num_conns - num_high_priority) ? 1 : 0;
+          grp.add(chops::net::tcp_connector_net_entity(conn_ptrs.back()),
+            [i, &order_mutex, &connect_order] (chops::net::tcp_io_interface, std::size_t, bool starting) {
+              if (starting) {
+                std::lock_guard<std::mutex> lk(order_mutex);
+                connect_order.push_back(i);
+              }
+            },
+            [] (chops::net::tcp_io_interface, std::error_code) { },
+            prio);
+        }
+      );
+      REQUIRE (grp.get_stats().num_pending == static_cast<std::size_t>(num_conns));
+
+      WHEN ("the group is started") {
+        grp.start();
+        bool all = grp.wait_all_connected(std::chrono::seconds(10));
+        auto st = grp.get_stats();
+        grp.stop();
+
+        THEN ("every connector connects, within the in-flight limit and ramp rate") {
+          REQUIRE (all);
+          REQUIRE (st.all_connected);
+          REQUIRE (st.num_connected == static_cast<std::size_t>(num_conns));
+          REQUIRE (st.num_pending == 0u);
+          REQUIRE (st.num_in_flight == 0u);
+          REQUIRE (st.num_failed == 0u);
+          REQUIRE (st.peak_in_flight <= max_in_flight);
+          if (ramp_rate > 0.0) {
+            auto min_time = std::chrono::duration<double>((num_conns - 1) / ramp_rate);
+            REQUIRE (st.time_to_all_connected >=
+                     std::chrono::duration_cast<std::chrono::steady_clock::duration>(min_time));
+          }
+          std::lock_guard<std::mutex> lk(order_mutex);
+          REQUIRE (connect_order.size() == static_cast<std::size_t>(num_conns));
+          if (max_in_flight == 1u) { // strictly one at a time, so connect order is start order
+            chops::repeat(num_high_priority, [&] (int i) {
+                REQUIRE (connect_order[i] == num_conns - num_high_priority + i);
+              }
+            );
+            REQUIRE (connect_order[num_high_priority] == 0);
+          }
+        }
+      }
+    }
+  } // end given
+
+  acc_ptr->stop();
+  wk.reset();
+}
+
+SCENARIO ( "Connector group test, one in flight, priorities",
+           "[connector_group]" ) {
+  connector_group_test(10, 1u, 0.0, 3);
+}
+
+SCENARIO ( "Connector group test, 4 in flight, ramp rate 100 per second",
+           "[connector_group]" ) {
+  connector_group_test(30, 4u, 100.0, 5);
+}
+
+
+SCENARIO ( "Connector group test, dropped connections and a stop and restart",
+           "[connector_group]" ) {
+
+  constexpr int num_conns = 5;
+
+  chops::net::worker wk;
+  wk.start();
+  auto& ioc = wk.get_io_context();
+
+  asio::ip::tcp::endpoint endp(asio::ip::make_address("127.0.0.1"), group_test_port);
+  std::mutex acc_mutex;
+  std::vector<chops::net::tcp_io_interface> accepted;
+  auto acc_ptr = std::make_shared<chops::net::detail::tcp_acceptor>(ioc, endp, true);
+  acc_ptr->start( [&acc_mutex, &accepted] (chops::net::tcp_io_interface io, std::size_t, 
+                                           bool starting) {
+                    if (starting) {
+                      io.start_io(1u, [] (asio::const_buffer, chops::net::tcp_io_interface,
+                                          asio::ip::tcp::endpoint) { return true; } );
+                      std::lock_guard<std::mutex> lk(acc_mutex);
+                      accepted.push_back(io);
+                    }
+                  },
+                  [] (chops::net::tcp_io_interface, std::error_code) { } );
+
+  std::atomic_int num_connects { 0 };
+  std::atomic_bool cleared_on_drop { true };
+  // a connector is connected before the acceptor side has seen the connection, and a
+  // dropped connection is only reconnected after the connector has been restarted
+  auto wait_for = [] (auto pred) {
+    chops::repeat(500, [&] {
+        if (!pred()) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+      }
+    );
+    return pred();
+  };
+  auto num_accepted = [&acc_mutex, &accepted] {
+    std::lock_guard<std::mutex> lk(acc_mutex);
+    return accepted.size();
+  };
+
+  GIVEN ("A started connector group, with all connectors connected") {
+
+    std::vector<chops::net::detail::tcp_connector_ptr> conn_ptrs;
+    chops::net::connector_group grp(ioc, 2u);
+
+    std::vector<asio::ip::tcp::endpoint> endps { endp };
+    chops::repeat(num_conns, [&] {
+        conn_ptrs.push_back(std::make_shared<chops::net::detail::tcp_connector>(ioc,
+                                endps.cbegin(), endps.cend(), std::chrono::milliseconds(100)));
+        grp.add(chops::net::tcp_connector_net_entity(conn_ptrs.back()),
+          [&grp, &num_connects, &cleared_on_drop] (chops::net::tcp_io_interface io, 
+                                                   std::size_t, bool starting) {
+            if (starting) {
+              // reads are started so that a connection dropped by the remote side is seen
+              io.start_io(1u, [] (asio::const_buffer, chops::net::tcp_io_interface,
+                                  asio::ip::tcp::endpoint) { return true; } );
+              ++num_connects;
+            }
+            else if (grp.get_stats().all_connected) {
+              cleared_on_drop = false;
+            }
+          },
+          [] (chops::net::tcp_io_interface, std::error_code) { } );
+      }
+    );
+    grp.start();
+    REQUIRE (grp.wait_all_connected(std::chrono::seconds(10)));
+
+    WHEN ("the connections are dropped by the remote side") {
+      REQUIRE (wait_for([&num_accepted] { return num_accepted() == num_conns; }));
+      {
+        std::lock_guard<std::mutex> lk(acc_mutex);
+        for (auto& io : accepted) {
+          io.stop_io();
+        }
+      }
+      THEN ("all connected is cleared and the connectors reconnect") {
+        REQUIRE (wait_for([&num_connects] { return num_connects == 2 * num_conns; }));
+        REQUIRE (grp.wait_all_connected(std::chrono::seconds(10)));
+        REQUIRE (cleared_on_drop);
+        auto st = grp.get_stats();
+        REQUIRE (st.num_connected == static_cast<std::size_t>(num_conns));
+        REQUIRE (st.num_in_flight == 0u);
+        REQUIRE (st.num_failed == 0u);
+      }
+    }
+
+    AND_WHEN ("the group is stopped and started again") {
+      grp.stop();
+      auto st = grp.get_stats();
+      REQUIRE_FALSE (st.all_connected);
+      REQUIRE (st.num_pending == static_cast<std::size_t>(num_conns));
+      REQUIRE (st.num_connected == 0u);
+      REQUIRE (st.num_in_flight == 0u);
+      grp.start();
+      THEN ("every connector is restarted and connects") {
+        REQUIRE (wait_for([&num_connects] { return num_connects == 2 * num_conns; }));
+        REQUIRE (grp.wait_all_connected(std::chrono::seconds(10)));
+        st = grp.get_stats();
+        REQUIRE (st.num_connected == static_cast<std::size_t>(num_conns));
+        REQUIRE (st.num_pending == 0u);
+        REQUIRE (st.num_failed == 0u);
+      }
+    }
+    grp.stop();
+  } // end given
+
+  acc_ptr->stop();
+  wk.reset();
+}
@@ -0,0 +1,159 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Load ramp test for the @c elastic_worker_pool class, using TCP connections on
+ *  loopback placed through a TCP acceptor.
+ *
+ *  Connectors are started one at a time, each sending messages that take a while to
+ *  process, so the load on the pool ramps up and threads are added. When the connectors
+ *  finish the pool is idle and threads are retired.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include "asio/ip/tcp.hpp"
+#include "asio/io_context.hpp"
+#include "asio/write.hpp"
+#include "asio/read.hpp"
+#include "asio/buffer.hpp"
+
+#include <system_error> // std::error_code
+#include <cstddef> // std::size_t
+#include <memory> // std::make_shared
+#include <thread>
+#include <future>
+#include <chrono>
+#include <vector>
+
+#include "net_ip/component/elastic_worker_pool.hpp"
+#include "net_ip/component/worker.hpp"
+
+#include "net_ip/detail/tcp_acceptor.hpp"
+#include "net_ip/io_interface.hpp"
+#include "net_ip/component/simple_variable_len_msg_frame.hpp"
+
+#include "net_ip/shared_utility_test.hpp"
+
+#include "utility/repeat.hpp"
+
+using namespace chops::test;
+
+constexpr unsigned short pool_test_port = 30990;
+constexpr int NumConnectors = 6;
+
+// each message keeps the handling thread busy for a while
+void spin_for (std::chrono::microseconds us) {
+  auto until = std::chrono::steady_clock::now() + us;
+  while (std::chrono::steady_clock::now() < until) { }
+}
+
+std::size_t ramp_connector_func (const asio::ip::tcp::endpoint& endp,
+                                 std::chrono::steady_clock::time_point until) {
+  asio::io_context ioc;
+  asio::ip::tcp::socket sock(ioc);
+  sock.connect(endp);
+  auto msg = make_variable_len_msg(make_body_buf("Ramp!", 'R', 10));
+  std::size_t cnt = 0;
+  while (std::chrono::steady_clock::now() < until) {
+    asio::write(sock, asio::const_buffer(msg.data(), msg.size()));
+    ++cnt;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto empty_msg = make_empty_variable_len_msg();
+  asio::write(sock, asio::const_buffer(empty_msg.data(), empty_msg.size()));
+  char c;
+  std::error_code ec;
+  asio::read(sock, asio::mutable_buffer(&c, 1), ec); // wait for the connection to close
+  return cnt;
+}
+
+SCENARIO ( "Elastic worker pool load ramp test", "[elastic_worker_pool]" ) {
+
+  chops::net::worker_pool_params params;
+  params.min_threads = 1;
+  params.max_threads = 3;
+  params.high_utilization = 0.3;
+  params.low_utilization = 0.05;
+  params.max_lag = std::chrono::milliseconds(20);
+  params.sample_interval = std::chrono::milliseconds(20);
+  params.grow_samples = 2;
+  params.shrink_samples = 10;
+
+  chops::net::elastic_worker_pool pool(params);
+  pool.start();
+
+  chops::net::worker wk;
+  wk.start();
+
+  test_counter recv_cnt = 0;
+
+  GIVEN ("An acceptor placing connections through an elastic worker pool") {
+
+    REQUIRE (pool.num_active() == 1u);
+
+    asio::ip::tcp::endpoint endp(asio::ip::make_address("127.0.0.1"), pool_test_port);
+    auto acc_ptr = std::make_shared<chops::net::detail::tcp_acceptor>(wk.get_io_context(),
+                                                  endp, true, pool.make_placement_func());
+    acc_ptr->start(
+      [&recv_cnt] (chops::net::tcp_io_interface io, std::size_t, bool starting) {
+        if (starting) {
+          io.start_io(2, [hdlr = tcp_msg_hdlr(false, recv_cnt)]
+                  (asio::const_buffer buf, chops::net::tcp_io_interface io_intf,
+                   asio::ip::tcp::endpoint ep) mutable {
+                spin_for(std::chrono::microseconds(400));
+                return hdlr(buf, io_intf, ep);
+              },
+              chops::net::make_simple_variable_len_msg_frame(decode_variable_len_msg_hdr));
+        }
+      },
+      [] (chops::net::tcp_io_interface, std::error_code) { }
+    );
+
+    WHEN ("the load ramps up with connectors started one at a time, then stops") {
+
+      auto until = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+      std::vector<std::future<std::size_t> > futs;
+      chops::repeat(NumConnectors, [&] {
+          futs.push_back(std::async(std::launch::async, ramp_connector_func, endp, until));
+          std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        }
+      );
+      std::size_t sent = 0;
+      for (auto& f : futs) {
+        sent += f.get();
+      }
+      auto busy_stats = pool.get_stats();
+
+      int tries = 0;
+      while ((pool.num_active() > params.min_threads || pool.get_stats().num_draining != 0u) &&
+             ++tries < 50) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      acc_ptr->stop();
+      auto idle_stats = pool.get_stats();
+
+      THEN ("threads are added under load and retired when idle, and no messages are lost") {
+        REQUIRE (recv_cnt == sent);
+        REQUIRE (busy_stats.peak_active > 1u);
+        REQUIRE (idle_stats.num_active == params.min_threads);
+        REQUIRE (idle_stats.num_draining == 0u);
+        REQUIRE (idle_stats.total_retired > 0u);
+        REQUIRE (acc_ptr->get_placement_stats().total_placed ==
+                 static_cast<std::size_t>(NumConnectors));
+      }
+    }
+  } // end given
+
+  wk.reset();
+  pool.stop();
+}
+
@@ -23,6 +23,10 @@
 #include <chrono>
 
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory> // std::make_shared
 
 #include "net_ip/net_ip_error.hpp"
 
@@ -71,3 +75,73 @@ SCENARIO ( "Testing ostream_error_sink_with_wait_queue function",
 
 
 
+SCENARIO ( "Testing ostream_error_sink_with_error_ring function",
+           "[error_delivery] [error_ring]" ) {
+
+  using namespace chops::test;
+
+  auto ioh1 = std::make_shared<io_handler_mock>();
+  auto ioh2 = std::make_shared<io_handler_mock>();
+
+  auto io1 = io_interface_mock(ioh1);
+  auto io2 = io_interface_mock(ioh2);
+
+  GIVEN ("An error ring and an error function") {
+
+    chops::net::err_ring ring(8);
+    auto err_func = chops::net::make_error_func_with_error_ring<io_handler_mock>(ring);
+
+    WHEN ("more errors than the ring capacity are reported before the sink runs") {
+      for (int i = 0; i < 10; ++i) {
+        err_func(io1, std::make_error_code(chops::net::net_ip_errc::tcp_io_handler_stopped));
+      }
+      err_func(io2, std::make_error_code(chops::net::net_ip_errc::tcp_io_handler_stopped));
+      err_func(io2, std::make_error_code(chops::net::net_ip_errc::tcp_connector_stopped));
+      THEN ("the extra errors are dropped and counted, the rest coalesced by entity and code") {
+        auto st = ring.get_stats();
+        REQUIRE (st.total_pushed == 8u);
+        REQUIRE (st.total_dropped == 4u);
+
+        std::ostringstream os;
+        auto sink_fut = std::async(std::launch::async, 
+                                   chops::net::ostream_error_sink_with_error_ring,
+                                   std::ref(ring), std::ref(os), std::chrono::seconds(1));
+        ring.close();
+        REQUIRE (sink_fut.get() == 8u);
+        auto out = os.str();
+        REQUIRE (out.find("(8 times)") != std::string::npos);
+        REQUIRE (out.find("4 errors dropped") != std::string::npos);
+      }
+    }
+
+    WHEN ("an error storm is reported from multiple threads while the sink runs") {
+      std::ostringstream os;
+      chops::net::err_ring big_ring(1024);
+      auto big_err_func = chops::net::make_error_func_with_error_ring<io_handler_mock>(big_ring);
+      auto sink_fut = std::async(std::launch::async, 
+                                 chops::net::ostream_error_sink_with_error_ring,
+                                 std::ref(big_ring), std::ref(os), std::chrono::milliseconds(10));
+      std::vector<std::thread> thrs;
+      for (int t = 0; t < 4; ++t) {
+        thrs.emplace_back([&, t] {
+            for (int i = 0; i < 10000; ++i) {
+              big_err_func((t % 2 == 0) ? io1 : io2, 
+                           std::make_error_code(chops::net::net_ip_errc::message_handler_terminated));
+            }
+          }
+        );
+      }
+      for (auto& thr : thrs) {
+        thr.join();
+      }
+      big_ring.close();
+      auto cnt = sink_fut.get();
+      THEN ("every error is either processed or counted as dropped") {
+        auto st = big_ring.get_stats();
+        REQUIRE (cnt == st.total_pushed);
+        REQUIRE (cnt + st.total_dropped == 40000u);
+      }
+    }
+  } // end given
+}
+
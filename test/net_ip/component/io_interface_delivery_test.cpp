@@ -19,6 +19,8 @@
 #include <thread>
 #include <memory>
 #include <future>
+#include <vector>
+#include <atomic>
 
 #include "net_ip/component/io_interface_delivery.hpp"
 #include "net_ip/component/io_state_change.hpp"
@@ -96,3 +98,100 @@ SCENARIO ( "Testing start_with_wait_queue",
 }
 
 
+SCENARIO ( "Testing start_with_io_ring and io_ready_latch",
+           "[io_interface_delivery] [io_ring]" ) {
+
+  using namespace chops::test;
+  using basic_net_mock = chops::net::basic_net_entity<net_entity_mock>;
+
+  constexpr int num_ents = 5;
+
+  GIVEN ("Multiple entity objects, an io_ring and a latch for 3 of the 5 entities") {
+    std::vector<std::shared_ptr<net_entity_mock> > ent_ptrs;
+    std::vector<basic_net_mock> ents;
+    for (int i = 0; i < num_ents; ++i) {
+      ent_ptrs.push_back(std::make_shared<net_entity_mock>());
+      ents.push_back(basic_net_mock(ent_ptrs.back()));
+    }
+    chops::net::io_ring<io_handler_mock> ring(16);
+    std::atomic_size_t cb_up { 0u };
+    chops::net::io_ready_latch latch(3u, [&cb_up] (std::size_t up) { cb_up = up; } );
+
+    WHEN ("start_with_io_ring is called for each entity") {
+      for (auto& ent : ents) {
+        chops::net::start_with_io_ring<io_handler_mock>(ent, io_state_chg_mock, 
+                                                        ring, err_func_mock, &latch);
+      }
+      THEN ("the latch is released and the state changes are delivered through the ring") {
+        REQUIRE (latch.wait_for(std::chrono::seconds(10)));
+        REQUIRE (latch.is_ready());
+        REQUIRE (cb_up >= 3u);
+        REQUIRE (latch.time_to_ready() > std::chrono::steady_clock::duration::zero());
+
+        std::size_t starts = 0;
+        std::size_t stops = 0;
+        while (starts + stops < 2 * num_ents) {
+          ring.wait_and_consume([&] (chops::net::io_state_chg_data<io_handler_mock>& d) {
+              if (d.starting) {
+                REQUIRE (d.num_handlers == 1u);
+                ++starts;
+              }
+              else {
+                REQUIRE (d.num_handlers == 0u);
+                ++stops;
+              }
+            }, 4u);
+        }
+        REQUIRE (starts == num_ents);
+        REQUIRE (stops == num_ents);
+        REQUIRE (latch.total_started() == num_ents);
+        REQUIRE (latch.num_up() == 0u);
+        REQUIRE (ring.get_stats().total_dropped == 0u);
+        for (auto& ent : ents) {
+          ent.stop();
+        }
+      }
+    }
+    AND_WHEN ("start_with_latch is called for each entity") {
+      for (auto& ent : ents) {
+        chops::net::start_with_latch<io_handler_mock>(ent, io_state_chg_mock, 
+                                                      latch, err_func_mock);
+      }
+      THEN ("the latch is released") {
+        latch.wait();
+        REQUIRE (latch.is_ready());
+        for (auto& ent : ents) {
+          ent.stop();
+        }
+        REQUIRE (latch.total_started() == num_ents);
+      }
+    }
+  } // end given
+}
+
+
+SCENARIO ( "Testing io_ready_latch start time",
+           "[io_interface_delivery] [io_ready_latch]" ) {
+
+  using namespace std::chrono_literals;
+
+  GIVEN ("A latch constructed well before the IO handlers are started") {
+    chops::net::io_ready_latch latch(2u);
+    std::this_thread::sleep_for(200ms);
+
+    WHEN ("start is called and then the IO handlers come up") {
+      latch.start();
+      latch.state_change(true);
+      latch.state_change(true);
+      THEN ("the time to ready is measured from the start call, not construction") {
+        REQUIRE (latch.is_ready());
+        auto ttr = latch.time_to_ready();
+        REQUIRE (ttr > std::chrono::steady_clock::duration::zero());
+        REQUIRE (ttr < 200ms);
+        std::this_thread::sleep_for(10ms);
+        latch.start(); // only the first call has an effect
+        REQUIRE (latch.time_to_ready() == ttr);
+      }
+    }
+  } // end given
+}
@@ -0,0 +1,155 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenarios for @c msg_handoff component.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0. 
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include "asio/buffer.hpp"
+
+#include <cstddef> // std::size_t
+#include <memory> // std::make_shared
+#include <vector>
+#include <thread>
+#include <future>
+#include <string>
+
+#include "net_ip/component/msg_handoff.hpp"
+
+#include "net_ip/shared_utility_test.hpp"
+
+using namespace chops::test;
+
+using handoff_type = chops::net::msg_handoff<io_handler_mock>;
+using endp_type = io_handler_mock::endpoint_type;
+
+SCENARIO ( "Msg handoff test, single thread push and consume",
+           "[msg_handoff]" ) {
+
+  auto ioh = std::make_shared<io_handler_mock>();
+  io_interface_mock io_intf(ioh);
+  auto endp = make_udp_endpoint("127.0.0.1", 31234);
+
+  GIVEN ("A msg handoff with 6 slots, which is rounded up to 8") {
+    handoff_type ho(6);
+    REQUIRE (ho.get_stats().capacity == 8u);
+
+    WHEN ("10 messages are pushed") {
+      std::size_t pushed = 0;
+      for (int i = 0; i < 10; ++i) {
+        std::string s(i+1, 'a');
+        if (ho.try_push(asio::buffer(s), io_intf, endp)) {
+          ++pushed;
+        }
+      }
+      THEN ("8 are queued and 2 dropped") {
+        REQUIRE (pushed == 8u);
+        auto st = ho.get_stats();
+        REQUIRE (st.occupancy == 8u);
+        REQUIRE (st.high_water == 8u);
+        REQUIRE (st.total_pushed == 8u);
+        REQUIRE (st.total_dropped == 2u);
+      }
+      AND_THEN ("they are consumed in order and in batches") {
+        std::vector<std::size_t> sizes;
+        auto f = [&] (asio::const_buffer buf, io_interface_mock io, endp_type e) {
+          REQUIRE (io == io_intf);
+          REQUIRE (e == endp);
+          sizes.push_back(buf.size());
+        };
+        REQUIRE (ho.consume(f, 5u) == 5u);
+        REQUIRE (ho.consume(f, 5u) == 3u);
+        REQUIRE (ho.consume(f, 5u) == 0u);
+        REQUIRE (sizes == std::vector<std::size_t> { 1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u });
+        REQUIRE (ho.get_stats().occupancy == 0u);
+        std::string s("again");
+        REQUIRE (ho.try_push(asio::buffer(s), io_intf, endp));
+      }
+    }
+    WHEN ("the msg handoff is closed") {
+      ho.close();
+      THEN ("pushes fail and a consumer returns immediately") {
+        std::string s("closed");
+        REQUIRE_FALSE (ho.try_push(asio::buffer(s), io_intf, endp));
+        REQUIRE (ho.wait_and_consume([] (asio::const_buffer, io_interface_mock, endp_type) { }, 
+                                     10u) == 0u);
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Msg handoff test, message handler with multiple producer threads",
+           "[msg_handoff] [multi_thread]" ) {
+
+  constexpr int num_producers = 4;
+  constexpr int num_msgs = 20000;
+
+  auto ioh = std::make_shared<io_handler_mock>();
+  io_interface_mock io_intf(ioh);
+  auto endp = make_udp_endpoint("127.0.0.1", 31234);
+
+  GIVEN ("A msg handoff, a consumer thread and producer threads using the message handler") {
+    handoff_type ho(1024, 100);
+
+    auto cons_fut = std::async(std::launch::async, [&ho] {
+        std::size_t cnt = 0;
+        std::size_t bytes = 0;
+        for (;;) {
+          auto n = ho.wait_and_consume([&bytes] (asio::const_buffer buf, io_interface_mock, endp_type) {
+              bytes += buf.size();
+            }, 64u);
+          if (n == 0) {
+            break;
+          }
+          cnt += n;
+        }
+        return cnt;
+      }
+    );
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < num_producers; ++i) {
+      producers.emplace_back([&] {
+          auto hdlr = chops::net::make_msg_handoff_handler(ho);
+          std::vector<asio::const_buffer> bufs;
+          std::string s("Hand it off!");
+          for (int j = 0; j < num_msgs; ++j) {
+            if (j % 2 == 0) {
+              hdlr(asio::buffer(s), io_intf, endp);
+            }
+            else { // batch handler signature
+              bufs.assign(1u, asio::buffer(s));
+              hdlr(bufs, io_intf, endp);
+            }
+          }
+        }
+      );
+    }
+    for (auto& t : producers) {
+      t.join();
+    }
+    ho.close();
+    auto cnt = cons_fut.get();
+
+    WHEN ("all producers are done and the msg handoff closed") {
+      THEN ("every message is either consumed or counted as dropped") {
+        auto st = ho.get_stats();
+        REQUIRE (cnt == st.total_pushed);
+        REQUIRE (cnt + st.total_dropped == static_cast<std::size_t>(num_producers * num_msgs));
+        REQUIRE (st.occupancy == 0u);
+        REQUIRE (st.high_water <= st.capacity);
+      }
+    }
+  } // end given
+}
+
@@ -0,0 +1,105 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenario for @c io_rebalancer class template.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include "asio/io_context.hpp"
+
+#include <cstddef> // std::size_t
+#include <memory> // std::make_shared
+#include <vector>
+
+#include "net_ip/component/rebalancer.hpp"
+
+#include "net_ip/queue_stats.hpp"
+
+#include "net_ip/shared_utility_test.hpp"
+
+struct traffic_mock : public chops::test::io_handler_mock {
+  std::size_t bytes = 0;
+
+  chops::net::input_stats get_input_stats() const {
+    return chops::net::input_stats { 0u, bytes };
+  }
+  chops::net::output_queue_stats get_output_queue_stats() const {
+    return chops::net::output_queue_stats { };
+  }
+};
+
+SCENARIO ( "Testing io_rebalancer class",
+           "[rebalancer]" ) {
+
+  asio::io_context ioc0;
+  asio::io_context ioc1;
+  chops::net::io_rebalancer<traffic_mock> rb { { &ioc0, &ioc1 } };
+  using io_intf = chops::net::basic_io_interface<traffic_mock>;
+
+  std::vector<std::shared_ptr<traffic_mock> > mocks;
+  for (std::size_t i = 0; i < 4; ++i) {
+    mocks.push_back(std::make_shared<traffic_mock>());
+    rb(io_intf(mocks.back()), 0u, true);
+  }
+  REQUIRE (rb.size() == 4u);
+
+  GIVEN ("Four connections on the first io_context with different traffic") {
+    for (std::size_t i = 0; i < 4; ++i) {
+      mocks[i]->bytes = (i + 1) * 100u;
+    }
+    WHEN ("rebalance is called") {
+      auto moved = rb.rebalance();
+      THEN ("the busiest connection that narrows the gap is migrated") {
+        REQUIRE (moved == 1u);
+        REQUIRE (mocks[3]->migrate_ioc == &ioc1);
+        REQUIRE (rb.get_io_context_index(io_intf(mocks[3])) == 1u);
+        REQUIRE (mocks[0]->migrate_ioc == nullptr);
+        auto loads = rb.get_loads();
+        REQUIRE (loads[0] == 600u);
+        REQUIRE (loads[1] == 400u);
+      }
+    }
+    AND_WHEN ("rebalance is called again with the same traffic rates") {
+      rb.rebalance();
+      for (std::size_t i = 0; i < 4; ++i) {
+        mocks[i]->bytes += (i + 1) * 100u;
+      }
+      auto moved = rb.rebalance();
+      THEN ("a smaller connection is migrated and the load is even") {
+        REQUIRE (moved == 1u);
+        REQUIRE (mocks[0]->migrate_ioc == &ioc1);
+        auto loads = rb.get_loads();
+        REQUIRE (loads[0] == 500u);
+        REQUIRE (loads[1] == 500u);
+        REQUIRE (rb.rebalance() == 0u);
+        REQUIRE (rb.total_moves() == 2u);
+      }
+    }
+    AND_WHEN ("a connection has closed") {
+      mocks[3].reset();
+      auto moved = rb.rebalance();
+      THEN ("it is removed from the collection") {
+        REQUIRE (rb.size() == 3u);
+        REQUIRE (moved == 1u);
+        REQUIRE (mocks[2]->migrate_ioc == &ioc1);
+      }
+    }
+    AND_WHEN ("a connection is removed through the io state change interface") {
+      rb(io_intf(mocks[1]), 0u, false);
+      THEN ("the size is decremented") {
+        REQUIRE (rb.size() == 3u);
+      }
+    }
+  }
+}
+
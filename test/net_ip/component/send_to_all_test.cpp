@@ -18,6 +18,8 @@
 #include <cstddef> // std::size_t
 
 #include <memory> // std::make_shared
+#include <vector>
+#include <chrono>
 
 #include "net_ip/component/send_to_all.hpp"
 
@@ -26,6 +28,8 @@
 
 #include "net_ip/shared_utility_test.hpp"
 
+#include "utility/repeat.hpp"
+
 SCENARIO ( "Testing send_to_all class",
            "[send_to_all]" ) {
 
@@ -75,6 +79,19 @@ SCENARIO ( "Testing send_to_all class",
         REQUIRE(ioh2->send_called);
       }
     }
+    AND_WHEN ("send is called with an intrusive buffer") {
+      std::byte b(static_cast<std::byte>(0xFE));
+      chops::net::intrusive_buffer buf(&b, 1);
+      auto ioh1 = std::make_shared<io_handler_mock>();
+      auto ioh2 = std::make_shared<io_handler_mock>();
+      sta.add_io_interface(io_interface_mock(ioh1));
+      sta.add_io_interface(io_interface_mock(ioh2));
+      THEN ("it is sent to each io handler") {
+        REQUIRE(sta.send(buf) == 2u);
+        REQUIRE(ioh1->send_called);
+        REQUIRE(ioh2->send_called);
+      }
+    }
     AND_WHEN ("get_total_output_queue_stats is called") {
       auto ioh1 = std::make_shared<io_handler_mock>();
       auto ioh2 = std::make_shared<io_handler_mock>();
@@ -89,5 +106,65 @@ SCENARIO ( "Testing send_to_all class",
   } // end given
 }
 
+SCENARIO ( "Send_to_all broadcast benchmark, 10 percent of the subscribers gone away",
+           "[send_to_all] [broadcast_benchmark]" ) {
+
+  using namespace chops::test;
+  using clock = std::chrono::steady_clock;
+
+  constexpr int NumSubscribers = 1000;
+  constexpr int NumBroadcasts = 200;
 
+  chops::net::send_to_all<io_handler_mock> sta { };
+  std::vector<io_interface_mock> subs;
+  std::vector<io_handler_mock_ptr> live;
+  chops::repeat(NumSubscribers, [&] (int i) {
+      auto ioh = std::make_shared<io_handler_mock>();
+      sta.add_io_interface(io_interface_mock(ioh));
+      subs.push_back(io_interface_mock(ioh));
+      if (i % 10 != 0) { // every tenth subscriber goes away without being removed
+        live.push_back(ioh);
+      }
+    }
+  );
+  REQUIRE (sta.size() == static_cast<std::size_t>(NumSubscribers));
+
+  GIVEN ("A send_to_all object with subscribers that have gone away") {
+    std::byte b(static_cast<std::byte>(0xFE));
+    chops::const_shared_buffer buf(&b, 1);
+
+    WHEN ("a buffer is broadcast many times through send_to_all and through throwing sends") {
+      std::size_t sent = 0;
+      auto start = clock::now();
+      chops::repeat(NumBroadcasts, [&] { sent += sta.send(buf); } );
+      auto try_send_time = clock::now() - start;
+
+      std::size_t thrown = 0;
+      start = clock::now();
+      chops::repeat(NumBroadcasts, [&] {
+          for (const auto& io : subs) {
+            try {
+              io.send(buf);
+            }
+            catch (const chops::net::net_ip_exception&) {
+              ++thrown;
+            }
+          }
+        }
+      );
+      auto throw_time = clock::now() - start;
+
+      THEN ("the dead subscribers are skipped without exceptions") {
+        REQUIRE (sent == live.size() * NumBroadcasts);
+        REQUIRE (thrown == (NumSubscribers - live.size()) * NumBroadcasts);
+        using us = std::chrono::microseconds;
+        WARN ("Broadcast to " << NumSubscribers << " subscribers, " << 
+              (NumSubscribers - live.size()) << " gone away, average per broadcast: try_send " <<
+              std::chrono::duration_cast<us>(try_send_time).count() / NumBroadcasts <<
+              " us, send with exceptions " <<
+              std::chrono::duration_cast<us>(throw_time).count() / NumBroadcasts << " us");
+      }
+    }
+  } // end given
+}
 
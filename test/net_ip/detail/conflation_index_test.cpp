@@ -0,0 +1,83 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenarios for @c conflation_index detail class.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0. 
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <cstdint> // std::uint64_t
+
+#include "net_ip/detail/conflation_index.hpp"
+
+#include "utility/repeat.hpp"
+
+SCENARIO ( "Conflation index test", "[conflation_index]" ) {
+
+  using namespace chops::net::detail;
+
+  constexpr int num_keys = 1000;
+
+  GIVEN ("A default constructed conflation_index") {
+    conflation_index idx { };
+    REQUIRE (idx.empty());
+    REQUIRE (idx.find(1) == nullptr);
+    REQUIRE_FALSE (idx.erase(1));
+
+    WHEN ("Keys are inserted") {
+      chops::repeat(num_keys, [&idx] (int i) { idx.insert(i * 3, i); } );
+      THEN ("each key can be found with the correct value and missing keys are not found") {
+        REQUIRE (idx.size() == num_keys);
+        chops::repeat(num_keys, [&idx] (int i) {
+            auto p = idx.find(i * 3);
+            REQUIRE (p);
+            REQUIRE (*p == static_cast<std::uint64_t>(i));
+            REQUIRE (idx.find(i * 3 + 1) == nullptr);
+          }
+        );
+      }
+    }
+    AND_WHEN ("Every other key is erased") {
+      chops::repeat(num_keys, [&idx] (int i) { idx.insert(i, i + 10); } );
+      chops::repeat(num_keys, [&idx] (int i) { if (i % 2 == 0) { REQUIRE (idx.erase(i)); } } );
+      THEN ("the remaining keys are still found and the erased keys are not") {
+        REQUIRE (idx.size() == num_keys / 2);
+        chops::repeat(num_keys, [&idx] (int i) {
+            auto p = idx.find(i);
+            if (i % 2 == 0) {
+              REQUIRE (p == nullptr);
+            }
+            else {
+              REQUIRE (p);
+              REQUIRE (*p == static_cast<std::uint64_t>(i + 10));
+            }
+          }
+        );
+      }
+    }
+    AND_WHEN ("Keys are repeatedly inserted and erased in FIFO order") {
+      chops::repeat(num_keys * 10, [&idx] (int i) {
+          idx.insert(i, i);
+          if (i >= 16) {
+            REQUIRE (idx.erase(i - 16));
+          }
+        }
+      );
+      THEN ("only the last keys remain") {
+        REQUIRE (idx.size() == 16);
+        REQUIRE (idx.find(num_keys * 10 - 1));
+        REQUIRE (idx.find(num_keys * 10 - 17) == nullptr);
+      }
+    }
+  } // end given
+}
+
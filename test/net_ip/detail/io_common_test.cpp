@@ -18,8 +18,12 @@
 #include "asio/io_context.hpp"
 
 #include <memory> // std::shared_ptr
+#include <thread>
 #include <system_error> // std::error_code
 #include <utility> // std::move
+#include <chrono>
+#include <vector>
+#include <array>
 
 #include "net_ip/detail/output_queue.hpp"
 #include "net_ip/detail/io_common.hpp"
@@ -143,6 +147,161 @@ void io_common_test(chops::const_shared_buffer buf, int num_bufs,
       }
     }
 
+    AND_WHEN ("Start_write_setup is called many times with the same conflation key") {
+      bool ret = iocommon.set_io_started();
+      REQUIRE (ret);
+      chops::net::detail::queue_attrs keyed { chops::net::detail::no_expiry, 42u, true };
+      chops::repeat(num_bufs, [&iocommon, &buf, &endp, &keyed] () { 
+          iocommon.start_write_setup(buf, endp, keyed);
+        }
+      );
+      THEN ("only one buf is queued, the rest replace it") {
+        REQUIRE (iocommon.is_write_in_progress());
+        auto qs = iocommon.get_output_queue_stats();
+        REQUIRE (qs.output_queue_size == 1);
+        REQUIRE (qs.conflated_bufs == (num_bufs - 2));
+      }
+    }
+
+    AND_WHEN ("Start_write_setup is called many times and get_next_elements is called") {
+      REQUIRE (iocommon.set_io_started());
+      chops::repeat(num_bufs, [&iocommon, &buf, &endp] () { 
+          iocommon.start_write_setup(buf, endp);
+        }
+      );
+      std::vector<chops::net::detail::out_buffer> bufs;
+      THEN ("queued bufs are gathered up to the max, and write_in_progress is cleared when empty") {
+        REQUIRE (iocommon.output_queue_bytes() == ((num_bufs - 1) * buf.size()));
+        REQUIRE (iocommon.get_next_elements(bufs, 2));
+        REQUIRE (bufs.size() == 2);
+        bufs.clear();
+        REQUIRE (iocommon.get_next_elements(bufs, num_bufs));
+        REQUIRE (bufs.size() == (num_bufs - 3));
+        REQUIRE (iocommon.output_queue_bytes() == 0);
+        bufs.clear();
+        REQUIRE_FALSE (iocommon.get_next_elements(bufs, num_bufs));
+        REQUIRE_FALSE (iocommon.is_write_in_progress());
+      }
+    }
+
+    AND_WHEN ("Multi-part messages are queued and get_next_elements is called with a small max") {
+      REQUIRE (iocommon.set_io_started());
+      std::array<chops::const_shared_buffer, 3> parts { buf, buf, buf };
+      REQUIRE (iocommon.start_write_setup(parts));
+      iocommon.start_write_setup(parts);
+      iocommon.start_write_setup(parts);
+      std::vector<chops::net::detail::out_buffer> bufs;
+      THEN ("a message is not split across gathered writes") {
+        REQUIRE (iocommon.get_output_queue_stats().output_queue_size == 6);
+        REQUIRE (iocommon.get_next_elements(bufs, 2));
+        REQUIRE (bufs.size() == 3);
+        bufs.clear();
+        REQUIRE (iocommon.get_next_elements(bufs, 4));
+        REQUIRE (bufs.size() == 3);
+      }
+    }
+
+    AND_WHEN ("A write completion callback is set and write_complete is called") {
+      std::size_t cb_bufs = 0;
+      std::size_t cb_bytes = 0;
+      int cb_calls = 0;
+      iocommon.set_write_complete_cb([&cb_bufs, &cb_bytes, &cb_calls] (std::size_t nb, std::size_t nbytes) {
+          cb_bufs += nb;
+          cb_bytes += nbytes;
+          ++cb_calls;
+        }
+      );
+      chops::repeat(num_bufs, [&iocommon, &buf] () { iocommon.write_complete(1u, buf.size()); } );
+      iocommon.write_complete(3u, 3u * buf.size());
+      THEN ("the callback is invoked once per write and the sent totals are updated") {
+        REQUIRE (cb_calls == (num_bufs + 1));
+        REQUIRE (cb_bufs == (num_bufs + 3));
+        REQUIRE (cb_bytes == ((num_bufs + 3) * buf.size()));
+        auto qs = iocommon.get_output_queue_stats();
+        REQUIRE (qs.total_bufs_sent == (num_bufs + 3));
+        REQUIRE (qs.total_bytes_sent == ((num_bufs + 3) * buf.size()));
+        REQUIRE (qs.total_writes == (num_bufs + 1));
+        REQUIRE (qs.max_write_batch == 3);
+      }
+    }
+
+    AND_WHEN ("Coalescing windows are closed") {
+      using namespace std::chrono_literals;
+      iocommon.coalesce_window_closed(100us);
+      iocommon.coalesce_window_closed(50us);
+      THEN ("the window count and total delay are updated") {
+        auto qs = iocommon.get_output_queue_stats();
+        REQUIRE (qs.coalesce_windows == 2);
+        REQUIRE (qs.total_coalesce_delay == 150us);
+      }
+    }
+
+    AND_WHEN ("A read budget is set and messages are read") {
+      iocommon.set_read_budget(3u, 0u);
+      int yields = 0;
+      chops::repeat(num_bufs, [&iocommon, &buf, &yields] () {
+          if (iocommon.msg_read(buf.size())) {
+            ++yields;
+          }
+        }
+      );
+      THEN ("the budget is used up every third message and the totals are updated") {
+        auto is = iocommon.get_input_stats();
+        REQUIRE (yields == (num_bufs / 3));
+        REQUIRE (is.read_budget_yields == static_cast<std::size_t>(num_bufs / 3));
+        REQUIRE (is.total_msgs_read == static_cast<std::size_t>(num_bufs));
+        REQUIRE (is.total_bytes_read == (num_bufs * buf.size()));
+      }
+    }
+
+    AND_WHEN ("A byte read budget is set and messages are read") {
+      iocommon.set_read_budget(0u, 2u * buf.size());
+      int yields = 0;
+      chops::repeat(num_bufs, [&iocommon, &buf, &yields] () {
+          if (iocommon.msg_read(buf.size())) {
+            ++yields;
+          }
+        }
+      );
+      THEN ("the budget is used up every second message") {
+        REQUIRE (yields == (num_bufs / 2));
+      }
+    }
+
+    AND_WHEN ("Speculative writes are counted") {
+      iocommon.speculative_write(true);
+      iocommon.speculative_write(false);
+      iocommon.speculative_write(true);
+      THEN ("the attempt and completed counts are updated") {
+        auto qs = iocommon.get_output_queue_stats();
+        REQUIRE (qs.speculative_writes == 3);
+        REQUIRE (qs.speculative_writes_completed == 2);
+      }
+    }
+
+    AND_WHEN ("A max age is set and bufs are queued and left to expire") {
+      using namespace std::chrono_literals;
+      using chops::net::detail::queue_attrs;
+      REQUIRE (iocommon.make_expiry() == chops::net::detail::no_expiry);
+      iocommon.set_max_age(1ms);
+      REQUIRE (iocommon.get_max_age() == 1ms);
+      REQUIRE (iocommon.set_io_started());
+      REQUIRE (iocommon.start_write_setup(buf, endp, queue_attrs { iocommon.make_expiry() }));
+      chops::repeat((num_bufs - 1), [&iocommon, &buf, &endp] () { 
+          iocommon.start_write_setup(buf, endp, queue_attrs { iocommon.make_expiry() });
+        }
+      );
+      std::this_thread::sleep_for(5ms);
+      THEN ("get_next_element discards the expired bufs and write_in_progress is false") {
+        auto e = iocommon.get_next_element();
+        REQUIRE_FALSE (e);
+        REQUIRE_FALSE (iocommon.is_write_in_progress());
+        auto qs = iocommon.get_output_queue_stats();
+        REQUIRE (qs.output_queue_size == 0);
+        REQUIRE (qs.expired_bufs == (num_bufs - 1));
+      }
+    }
+
   } // end given
 }
 
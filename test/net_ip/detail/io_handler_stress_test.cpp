@@ -0,0 +1,305 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Multi-threaded stress test for the @c tcp_io and @c udp_entity_io strands.
+ *
+ *  Sends, @c stop_io, @c close and entity @c stop are called concurrently from several
+ *  application threads against one IO handler, while the @c io_context is run by a pool
+ *  of threads. The test passes if nothing crashes or hangs and every IO handler is
+ *  released; it is mostly useful when built with the thread sanitizer (see the
+ *  CHOPS_NET_IP_OPT_TSAN CMake option).
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include "asio/ip/tcp.hpp"
+#include "asio/ip/udp.hpp"
+#include "asio/connect.hpp"
+#include "asio/io_context.hpp"
+#include "asio/executor_work_guard.hpp"
+#include "asio/read.hpp"
+#include "asio/write.hpp"
+
+#include <system_error> // std::error_code
+#include <cstddef> // std::size_t
+#include <memory> // std::make_shared, std::weak_ptr
+#include <vector>
+#include <functional> // std::function
+#include <thread>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <string_view>
+
+#include "net_ip/detail/tcp_io.hpp"
+#include "net_ip/detail/tcp_acceptor.hpp"
+#include "net_ip/detail/udp_entity_io.hpp"
+
+#include "net_ip/net_ip_error.hpp"
+#include "net_ip/endpoints_resolver.hpp"
+
+#include "net_ip/shared_utility_test.hpp"
+#include "utility/shared_buffer.hpp"
+#include "utility/repeat.hpp"
+
+using namespace chops::test;
+
+const char*   test_addr = "127.0.0.1";
+const char*   tcp_test_port = "30468";
+const char*   acc_test_port = "30469";
+constexpr int udp_test_port = 30470;
+
+constexpr int NumRounds = 20;
+constexpr int NumSenders = 3;
+constexpr int NumSends = 200;
+constexpr int NumRunThreads = 4;
+
+// an io_context run by several threads, so handlers of different strands run in parallel
+struct run_pool {
+  asio::io_context                                          ioc;
+  asio::executor_work_guard<asio::io_context::executor_type>  guard;
+  std::vector<std::thread>                                  threads;
+
+  run_pool() : ioc(), guard(asio::make_work_guard(ioc)), threads() {
+    chops::repeat(NumRunThreads, [this] { threads.emplace_back([this] { ioc.run(); } ); } );
+  }
+  ~run_pool() {
+    guard.reset();
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+};
+
+// each function runs in its own thread, all released at the same time
+void run_together(const std::vector<std::function<void ()> >& funcs) {
+  std::atomic_bool go { false };
+  std::vector<std::thread> threads;
+  for (const auto& f : funcs) {
+    threads.emplace_back([&go, &f] {
+        while (!go) {
+          std::this_thread::yield();
+        }
+        f();
+      }
+    );
+  }
+  go = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+template <typename P>
+bool wait_for (P pred) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!pred() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return pred();
+}
+
+// reads (and discards) everything until the other side closes
+std::future<void> start_drain(asio::ip::tcp::socket& sock) {
+  return std::async(std::launch::async, [&sock] {
+      std::vector<char> buf(4096);
+      std::error_code ec;
+      while (!ec) {
+        sock.read_some(asio::buffer(buf), ec);
+      }
+    }
+  );
+}
+
+// the IO handler has some incoming messages to read while it is being stopped
+void write_msgs(asio::ip::tcp::socket& sock) {
+  chops::repeat(NumSends, [&sock] {
+      auto msg = make_variable_len_msg(make_body_buf("Incoming", 'I', 20));
+      asio::write(sock, asio::const_buffer(msg.data(), msg.size()));
+    }
+  );
+}
+
+void add_delayed(std::vector<std::function<void ()> >& funcs, int delay_us,
+                 std::function<void ()> f) {
+  funcs.push_back([delay_us, f] {
+      std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+      f();
+    }
+  );
+}
+
+SCENARIO ( "IO handler stress test, tcp_io send, stop_io and close from many threads",
+           "[tcp_io] [stress] [tsan]" ) {
+
+  run_pool rp;
+  auto endps = chops::net::endpoints_resolver<asio::ip::tcp>(rp.ioc).make_endpoints(true,
+                                                                 test_addr, tcp_test_port);
+  int num_released = 0;
+
+  GIVEN ("A started IO handler on an io_context with several run threads") {
+    chops::repeat(NumRounds, [&] (int round) {
+        asio::ip::tcp::socket peer(rp.ioc);
+        std::shared_ptr<chops::net::detail::tcp_io> iohp;
+        {
+          asio::ip::tcp::acceptor acc(rp.ioc, *(endps.cbegin()));
+          asio::ip::tcp::socket sock(rp.ioc);
+          asio::connect(sock, endps);
+          peer = acc.accept();
+          // the notifier plays the part of the net entity
+          iohp = std::make_shared<chops::net::detail::tcp_io>(std::move(sock),
+                   [] (std::error_code, chops::net::detail::tcp_io_ptr p) { p->close(); } );
+        }
+        std::weak_ptr<chops::net::detail::tcp_io> wp(iohp);
+        test_counter cnt = 0;
+        tcp_start_io(chops::net::tcp_io_interface(iohp), false, std::string_view(), cnt);
+        write_msgs(peer);
+        auto drain = start_drain(peer);
+
+        std::vector<std::function<void ()> > funcs;
+        chops::repeat(NumSenders, [&] {
+            funcs.push_back([iohp] {
+                auto msg = make_variable_len_msg(make_body_buf("Outgoing", 'O', 20));
+                chops::repeat(NumSends, [&] { iohp->send(msg); } );
+              }
+            );
+          }
+        );
+        add_delayed(funcs, 50 * (round % 5), [iohp] { iohp->stop_io(); } );
+        add_delayed(funcs, 50 * (round % 3), [iohp] { iohp->close(); } );
+        run_together(funcs);
+        funcs.clear();
+        iohp.reset();
+        drain.get();
+        if (wait_for([&wp] { return wp.expired(); })) {
+          ++num_released;
+        }
+      }
+    );
+    THEN ("every IO handler is closed and released") {
+      REQUIRE (num_released == NumRounds);
+    }
+  } // end given
+
+}
+
+SCENARIO ( "IO handler stress test, tcp_acceptor IO handler send and stop_io with entity stop",
+           "[tcp_acceptor] [stress] [tsan]" ) {
+
+  run_pool rp;
+  auto endps = chops::net::endpoints_resolver<asio::ip::tcp>(rp.ioc).make_endpoints(true,
+                                                                 test_addr, acc_test_port);
+  int num_released = 0;
+
+  GIVEN ("A started acceptor with one connection, on an io_context with several run threads") {
+    chops::repeat(NumRounds, [&] (int round) {
+        auto acc_ptr = std::make_shared<chops::net::detail::tcp_acceptor>(rp.ioc,
+                                                                *(endps.cbegin()), true);
+        std::promise<chops::net::tcp_io_interface> io_prom;
+        auto io_fut = io_prom.get_future();
+        test_counter cnt = 0;
+        acc_ptr->start(
+          [&io_prom, &cnt] (chops::net::tcp_io_interface io, std::size_t, bool starting) {
+            if (starting) {
+              tcp_start_io(io, false, std::string_view(), cnt);
+              io_prom.set_value(io);
+            }
+          },
+          [] (chops::net::tcp_io_interface, std::error_code) { }
+        );
+        asio::ip::tcp::socket peer(rp.ioc);
+        asio::connect(peer, endps);
+        auto io = io_fut.get();
+        write_msgs(peer);
+        auto drain = start_drain(peer);
+
+        // the IO handler may be gone by the time a call is made
+        std::vector<std::function<void ()> > funcs;
+        chops::repeat(NumSenders, [&] {
+            funcs.push_back([io] {
+                auto msg = make_variable_len_msg(make_body_buf("Outgoing", 'O', 20));
+                try {
+                  chops::repeat(NumSends, [&] { io.send(msg); } );
+                }
+                catch (const chops::net::net_ip_exception&) { }
+              }
+            );
+          }
+        );
+        add_delayed(funcs, 50 * (round % 5), [io] () mutable {
+            try {
+              io.stop_io();
+            }
+            catch (const chops::net::net_ip_exception&) { }
+          }
+        );
+        add_delayed(funcs, 50 * (round % 3), [acc_ptr] { acc_ptr->stop(); } );
+        run_together(funcs);
+        funcs.clear();
+        acc_ptr->stop();
+        drain.get();
+        std::weak_ptr<chops::net::detail::tcp_acceptor> acc_wp(acc_ptr);
+        acc_ptr.reset();
+        if (wait_for([&io, &acc_wp] { return !io.is_valid() && acc_wp.expired(); })) {
+          ++num_released;
+        }
+      }
+    );
+    THEN ("every IO handler and acceptor is stopped and released") {
+      REQUIRE (num_released == NumRounds);
+    }
+  } // end given
+
+}
+
+SCENARIO ( "IO handler stress test, udp_entity_io send and stop_io with entity stop",
+           "[udp_entity_io] [stress] [tsan]" ) {
+
+  run_pool rp;
+  auto endp = make_udp_endpoint(test_addr, udp_test_port);
+  int num_released = 0;
+
+  GIVEN ("A started UDP entity sending to itself, on an io_context with several run threads") {
+    chops::repeat(NumRounds, [&] (int round) {
+        auto iohp = std::make_shared<chops::net::detail::udp_entity_io>(rp.ioc, endp);
+        std::weak_ptr<chops::net::detail::udp_entity_io> wp(iohp);
+        test_counter cnt = 0;
+        iohp->start([] (chops::net::udp_io_interface, std::size_t, bool) { },
+                    [] (chops::net::udp_io_interface, std::error_code) { } );
+        iohp->start_io(udp_max_buf_size, udp_msg_hdlr(false, cnt));
+
+        std::vector<std::function<void ()> > funcs;
+        chops::repeat(NumSenders, [&] {
+            funcs.push_back([iohp, endp] {
+                auto msg = make_variable_len_msg(make_body_buf("Datagram", 'D', 20));
+                chops::repeat(NumSends, [&] { iohp->send(msg, endp); } );
+              }
+            );
+          }
+        );
+        add_delayed(funcs, 50 * (round % 5), [iohp] { iohp->stop_io(); } );
+        add_delayed(funcs, 50 * (round % 3), [iohp] { iohp->stop(); } );
+        run_together(funcs);
+        funcs.clear();
+        iohp.reset();
+        if (wait_for([&wp] { return wp.expired(); })) {
+          ++num_released;
+        }
+      }
+    );
+    THEN ("every UDP entity is stopped and released") {
+      REQUIRE (num_released == NumRounds);
+    }
+  } // end given
+
+}
+
@@ -0,0 +1,120 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenarios for @c object_pool detail class.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <memory> // std::shared_ptr, std::enable_shared_from_this
+#include <vector>
+#include <cstddef> // std::size_t
+
+#include "net_ip/detail/object_pool.hpp"
+
+#include "utility/repeat.hpp"
+
+struct pooled_obj : std::enable_shared_from_this<pooled_obj> {
+  int  val;
+  char filler[200];
+  explicit pooled_obj(int v) : val(v), filler() { }
+};
+
+SCENARIO ( "Object pool test, no pool", "[object_pool]" ) {
+
+  chops::net::detail::object_pool<pooled_obj> pool;
+
+  GIVEN ("A default constructed object pool") {
+    WHEN ("an object is created") {
+      auto p = pool.make_shared(42);
+      THEN ("the object is created with make_shared and the stats are all zero") {
+        REQUIRE_FALSE (pool.is_pooled());
+        REQUIRE (pool.block_size() == 0u);
+        REQUIRE (p->val == 42);
+        auto st = pool.get_stats();
+        REQUIRE (st.total_allocs == 0u);
+        REQUIRE (st.blocks_owned == 0u);
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Object pool test, pre-allocation and recycling", "[object_pool]" ) {
+
+  chops::net::detail::object_pool<pooled_obj> pool(3u, 0u);
+
+  GIVEN ("An object pool with pre-allocated blocks") {
+    REQUIRE (pool.is_pooled());
+    REQUIRE (pool.block_size() > sizeof(pooled_obj));
+    REQUIRE (pool.get_stats().blocks_free == 3u);
+    REQUIRE (pool.get_stats().total_allocs == 0u);
+
+    WHEN ("more objects are created than were pre-allocated, then released") {
+      {
+        std::vector<std::shared_ptr<pooled_obj> > objs;
+        chops::repeat(5, [&] (int i) { objs.push_back(pool.make_shared(i)); } );
+        REQUIRE (objs[4]->val == 4);
+        REQUIRE (objs[2]->shared_from_this() == objs[2]);
+        auto st = pool.get_stats();
+        REQUIRE (st.pool_hits == 3u);
+        REQUIRE (st.pool_misses == 2u);
+        REQUIRE (st.blocks_free == 0u);
+      }
+      THEN ("the blocks are kept and the next objects are created in recycled blocks") {
+        auto st = pool.get_stats();
+        REQUIRE (st.blocks_owned == 5u);
+        REQUIRE (st.blocks_free == 5u);
+        auto p = pool.make_shared(7);
+        REQUIRE (p->val == 7);
+        st = pool.get_stats();
+        REQUIRE (st.total_allocs == 6u);
+        REQUIRE (st.pool_hits == 4u);
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Object pool test, limit on free blocks", "[object_pool]" ) {
+
+  chops::net::detail::object_pool<pooled_obj> pool(0u, 2u);
+
+  GIVEN ("An object pool with a free block limit") {
+    WHEN ("more objects than the limit are created, then released") {
+      {
+        std::vector<std::shared_ptr<pooled_obj> > objs;
+        chops::repeat(4, [&] (int i) { objs.push_back(pool.make_shared(i)); } );
+      }
+      THEN ("only the limit is kept") {
+        auto st = pool.get_stats();
+        REQUIRE (st.pool_misses == 4u);
+        REQUIRE (st.blocks_free == 2u);
+        REQUIRE (st.blocks_owned == 2u);
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Object pool test, objects outlive the pool", "[object_pool]" ) {
+
+  std::shared_ptr<pooled_obj> p;
+  {
+    chops::net::detail::object_pool<pooled_obj> pool(1u, 0u);
+    p = pool.make_shared(11);
+  }
+  GIVEN ("An object created from a pool that has been destroyed") {
+    THEN ("the object is still valid") {
+      REQUIRE (p->val == 11);
+      p.reset();
+    }
+  } // end given
+}
+
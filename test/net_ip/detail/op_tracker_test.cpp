@@ -0,0 +1,89 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenarios for @c op_tracker detail class.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <memory> // std::shared_ptr, std::weak_ptr, std::enable_shared_from_this
+#include <vector>
+#include <utility> // std::move
+#include <functional> // std::function
+
+#include "net_ip/detail/op_tracker.hpp"
+
+#include "utility/repeat.hpp"
+
+struct tracked_ioh : std::enable_shared_from_this<tracked_ioh> {
+  chops::net::detail::op_tracker<tracked_ioh> ops;
+};
+
+using op_ref = chops::net::detail::op_tracker<tracked_ioh>::op_ref;
+
+SCENARIO ( "Op tracker test, handler kept alive by outstanding operations", "[op_tracker]" ) {
+
+  auto ioh = std::make_shared<tracked_ioh>();
+  std::weak_ptr<tracked_ioh> wp(ioh);
+
+  GIVEN ("An IO handler with an op tracker") {
+    REQUIRE (ioh->ops.num_outstanding() == 0u);
+    REQUIRE (ioh->ops.is_drained());
+
+    WHEN ("operations are started and the owner releases the handler") {
+      std::vector<op_ref> ops;
+      chops::repeat(3, [&] { ops.push_back(ioh->ops.start_op(*ioh)); } );
+      REQUIRE (ioh.use_count() == 2); // one reference for all of the operations
+      REQUIRE (ioh->ops.num_outstanding() == 3u);
+      REQUIRE_FALSE (ioh->ops.is_drained());
+      ioh.reset();
+      THEN ("the handler lives until the last operation finishes") {
+        REQUIRE_FALSE (wp.expired());
+        op_ref moved(std::move(ops[0]));
+        ops.clear();
+        REQUIRE_FALSE (wp.expired());
+        REQUIRE (wp.lock()->ops.num_outstanding() == 1u);
+        { op_ref gone(std::move(moved)); }
+        REQUIRE (wp.expired());
+      }
+    }
+    AND_WHEN ("one operation starts the next before it finishes, as completion handlers do") {
+      {
+        op_ref first = ioh->ops.start_op(*ioh);
+        chops::repeat(1000, [&] {
+            op_ref next = ioh->ops.start_op(*ioh);
+            first = std::move(next);
+          }
+        );
+      }
+      THEN ("the reference to the handler is released when the chain ends") {
+        REQUIRE (ioh->ops.num_outstanding() == 0u);
+        REQUIRE (ioh->ops.is_drained());
+        REQUIRE (ioh.use_count() == 1);
+      }
+    }
+    AND_WHEN ("a pending operation is destroyed without being run") {
+      std::function<void ()> pending;
+      {
+        auto ref = std::make_shared<op_ref>(ioh->ops.start_op(*ioh));
+        pending = [ref] { };
+      }
+      ioh.reset();
+      REQUIRE_FALSE (wp.expired());
+      pending = nullptr;
+      THEN ("the handler is released") {
+        REQUIRE (wp.expired());
+      }
+    }
+  } // end given
+}
+
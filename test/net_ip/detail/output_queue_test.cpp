@@ -6,7 +6,7 @@
  *
  *  @author Cliff Green
  *
- *  Copyright (c) 2017-2018 by Cliff Green
+ *  Copyright (c) 2017-2019 by Cliff Green
  *
  *  Distributed under the Boost Software License, Version 1.0. 
  *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
@@ -16,6 +16,10 @@
 #include "catch2/catch.hpp"
 
 #include <utility> // std::move
+#include <chrono>
+#include <array>
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
 
 #include <asio/ip/udp.hpp> // endpoint declarations
 #include <asio/ip/tcp.hpp> // endpoint declarations
@@ -25,6 +29,16 @@
 #include "utility/repeat.hpp"
 #include "utility/make_byte_array.hpp"
 
+using chops::net::detail::queue_attrs;
+
+queue_attrs keyed(std::uint64_t key) {
+  return queue_attrs { chops::net::detail::no_expiry, key, true };
+}
+
+queue_attrs on_lane(std::size_t lane) {
+  return queue_attrs { chops::net::detail::no_expiry, 0u, false, lane };
+}
+
 template <typename E>
 void add_element_test(chops::const_shared_buffer buf, int num_bufs) {
 
@@ -56,6 +70,14 @@ void add_element_test(chops::const_shared_buffer buf, int num_bufs) {
         REQUIRE_FALSE (e);
       }
     }
+    AND_WHEN ("The size of a queued element is checked") {
+      using outq_type = chops::net::detail::output_queue<E>;
+      THEN ("the attributes take no more than an expiry and a key on top of the element") {
+        REQUIRE (outq_type::stored_element_size() <=
+                 sizeof(typename outq_type::opt_queue_element::value_type) +
+                 sizeof(chops::net::detail::time_point) + sizeof(typename outq_type::key_type));
+      }
+    }
   } // end given
 }
 
@@ -84,6 +106,241 @@ void get_next_element_test(chops::const_shared_buffer buf, int num_bufs,
   } // end given
 }
 
+template <typename E>
+void expiry_test(chops::const_shared_buffer buf, int num_bufs) {
+
+  using namespace std::chrono_literals;
+
+  GIVEN ("A default constructed output_queue") {
+    chops::net::detail::output_queue<E> outq { };
+
+    WHEN ("Bufs with an expiry in the past are added ahead of bufs without an expiry") {
+      auto past = std::chrono::steady_clock::now() - 1ms;
+      chops::repeat(num_bufs, [&outq, &buf, past] () { outq.add_element(buf, queue_attrs { past }); } );
+      outq.add_element(buf);
+      THEN ("the expired bufs are discarded and counted and the last buf is returned") {
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == (num_bufs + 1));
+        auto e = outq.get_next_element();
+        REQUIRE (e);
+        REQUIRE (e->first == buf);
+        REQUIRE_FALSE (outq.get_next_element());
+        qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == 0);
+        REQUIRE (qs.bytes_in_output_queue == 0);
+        REQUIRE (qs.expired_bufs == num_bufs);
+        REQUIRE (qs.expired_bytes == (num_bufs * buf.size()));
+      }
+    }
+    AND_WHEN ("Bufs with an expiry in the future are added") {
+      auto future = std::chrono::steady_clock::now() + 10s;
+      chops::repeat(num_bufs, [&outq, &buf, future] () { outq.add_element(buf, queue_attrs { future }); } );
+      THEN ("all of the bufs are returned and none are counted as expired") {
+        chops::repeat(num_bufs, [&outq] () { REQUIRE (outq.get_next_element()); } );
+        REQUIRE_FALSE (outq.get_next_element());
+        REQUIRE (outq.get_queue_stats().expired_bufs == 0);
+      }
+    }
+  } // end given
+}
+
+template <typename E>
+void conflation_test(chops::const_shared_buffer buf1, chops::const_shared_buffer buf2, 
+                     int num_keys) {
+
+  GIVEN ("A default constructed output_queue") {
+    chops::net::detail::output_queue<E> outq { };
+
+    WHEN ("Keyed bufs are added twice for each key, with an unkeyed buf in between") {
+      chops::repeat(num_keys, [&outq, &buf1] (int i) { outq.add_element(buf1, keyed(i)); } );
+      outq.add_element(buf1);
+      chops::repeat(num_keys, [&outq, &buf2] (int i) { outq.add_element(buf2, keyed(i)); } );
+      THEN ("the second keyed bufs replace the first, keeping the original position") {
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == (num_keys + 1));
+        REQUIRE (qs.bytes_in_output_queue == (num_keys * buf2.size() + buf1.size()));
+        REQUIRE (qs.conflated_bufs == num_keys);
+        chops::repeat(num_keys, [&outq, &buf2] () {
+            auto e = outq.get_next_element();
+            REQUIRE (e);
+            REQUIRE (e->first == buf2);
+          }
+        );
+        auto e = outq.get_next_element();
+        REQUIRE (e);
+        REQUIRE (e->first == buf1);
+        REQUIRE_FALSE (outq.get_next_element());
+        qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == 0);
+        REQUIRE (qs.bytes_in_output_queue == 0);
+      }
+    }
+    AND_WHEN ("A keyed buf is removed and then the same key is added again") {
+      outq.add_element(buf1, keyed(7));
+      outq.add_element(buf1, keyed(8));
+      REQUIRE (outq.get_next_element());
+      outq.add_element(buf2, keyed(7));
+      THEN ("a new element is appended instead of replacing") {
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == 2);
+        REQUIRE (qs.conflated_bufs == 0);
+        auto e = outq.get_next_element();
+        REQUIRE (e->first == buf1);
+        e = outq.get_next_element();
+        REQUIRE (e->first == buf2);
+      }
+    }
+  } // end given
+}
+
+template <typename E>
+void lane_test(chops::const_shared_buffer buf1, chops::const_shared_buffer buf2, int num_bufs) {
+
+  using chops::net::max_output_lanes;
+
+  GIVEN ("A default constructed output_queue") {
+    chops::net::detail::output_queue<E> outq { };
+
+    WHEN ("Bufs are added to a low priority lane and then to the highest priority lane") {
+      chops::repeat(num_bufs, [&outq, &buf2] () { outq.add_element(buf2, on_lane(2)); } );
+      chops::repeat(num_bufs, [&outq, &buf1] () { outq.add_element(buf1, on_lane(0)); } );
+      THEN ("lane stats are reported and the highest priority lane is drained first") {
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == (2 * num_bufs));
+        REQUIRE (qs.lanes[0].output_queue_size == num_bufs);
+        REQUIRE (qs.lanes[0].bytes_in_output_queue == (num_bufs * buf1.size()));
+        REQUIRE (qs.lanes[1].output_queue_size == 0);
+        REQUIRE (qs.lanes[2].output_queue_size == num_bufs);
+        REQUIRE (qs.lanes[2].bytes_in_output_queue == (num_bufs * buf2.size()));
+        chops::repeat(num_bufs, [&outq, &buf1] () { REQUIRE (outq.get_next_element()->first == buf1); } );
+        chops::repeat(num_bufs, [&outq, &buf2] () { REQUIRE (outq.get_next_element()->first == buf2); } );
+        REQUIRE_FALSE (outq.get_next_element());
+        qs = outq.get_queue_stats();
+        REQUIRE (qs.lanes[0].output_queue_size == 0);
+        REQUIRE (qs.lanes[2].output_queue_size == 0);
+        REQUIRE (qs.lanes[2].bytes_in_output_queue == 0);
+      }
+    }
+    AND_WHEN ("The highest priority lane has a weight of 2") {
+      outq.set_lane_weight(0, 2);
+      chops::repeat(2 * num_bufs, [&outq, &buf1] () { outq.add_element(buf1, on_lane(0)); } );
+      chops::repeat(num_bufs, [&outq, &buf2] () { outq.add_element(buf2, on_lane(max_output_lanes-1)); } );
+      THEN ("one buf from the lower lane is returned after every 2 bufs from the higher lane") {
+        chops::repeat(num_bufs, [&outq, &buf1, &buf2] () {
+            REQUIRE (outq.get_next_element()->first == buf1);
+            REQUIRE (outq.get_next_element()->first == buf1);
+            REQUIRE (outq.get_next_element()->first == buf2);
+          }
+        );
+        REQUIRE_FALSE (outq.get_next_element());
+      }
+    }
+    AND_WHEN ("A buf is added with a lane number past the maximum") {
+      outq.add_element(buf1, on_lane(max_output_lanes + 10));
+      THEN ("it is placed in the lowest priority lane") {
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.lanes[max_output_lanes-1].output_queue_size == 1);
+        REQUIRE (outq.get_next_element()->first == buf1);
+      }
+    }
+  } // end given
+}
+
+template <typename E>
+void multi_part_test(chops::const_shared_buffer buf1, chops::const_shared_buffer buf2, int num_msgs) {
+
+  using namespace std::chrono_literals;
+
+  GIVEN ("A default constructed output_queue with a weighted lane") {
+    chops::net::detail::output_queue<E> outq { };
+    outq.set_lane_weight(0, 1);
+    std::array<chops::const_shared_buffer, 3> parts { buf1, buf2, buf2 };
+
+    WHEN ("Multi-part messages are added to a lower lane, interleaved with single bufs in lane 0") {
+      chops::repeat(num_msgs, [&outq, &buf1, &parts] () {
+          outq.add_element(parts.data(), parts.size(), on_lane(1));
+          outq.add_element(buf1, on_lane(0));
+        }
+      );
+      THEN ("the parts of each message are returned consecutively") {
+        REQUIRE (outq.get_queue_stats().output_queue_size == (4 * num_msgs));
+        REQUIRE (outq.get_next_element()->first == buf1); // lane 0 first
+        chops::repeat(num_msgs, [&outq, &buf1, &buf2, num_msgs] (int i) {
+            REQUIRE (outq.get_next_element()->first == buf1); // message from lane 1
+            REQUIRE (outq.mid_message());
+            REQUIRE (outq.get_next_element()->first == buf2);
+            REQUIRE (outq.mid_message());
+            REQUIRE (outq.get_next_element()->first == buf2);
+            REQUIRE_FALSE (outq.mid_message());
+            if (i < (num_msgs - 1)) {
+              REQUIRE (outq.get_next_element()->first == buf1); // lane 0
+            }
+          }
+        );
+        REQUIRE_FALSE (outq.get_next_element());
+      }
+    }
+    AND_WHEN ("An expired multi-part message is ahead of a single buf") {
+      outq.add_element(parts.data(), parts.size(), 
+                       queue_attrs { std::chrono::steady_clock::now() - 1ms });
+      outq.add_element(buf2);
+      THEN ("all of the parts are discarded") {
+        auto e = outq.get_next_element();
+        REQUIRE (e);
+        REQUIRE (e->first == buf2);
+        REQUIRE_FALSE (outq.mid_message());
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.expired_bufs == 3);
+        REQUIRE (qs.expired_bytes == (buf1.size() + 2 * buf2.size()));
+      }
+    }
+  } // end given
+}
+
+template <typename E>
+void intrusive_buffer_test(chops::const_shared_buffer buf1, chops::const_shared_buffer buf2, 
+                           int num_bufs) {
+
+  GIVEN ("A default constructed output_queue and intrusive buffers") {
+    chops::net::detail::output_queue<E> outq { };
+    chops::net::intrusive_buffer ibuf1(buf1);
+    chops::net::intrusive_buffer ibuf2(buf2, chops::net::refcount_mode::single_thread);
+
+    WHEN ("Intrusive and shared bufs are interleaved in the queue") {
+      chops::repeat(num_bufs, [&outq, &buf1, &ibuf2] () {
+          outq.add_element(buf1);
+          outq.add_element(ibuf2);
+        }
+      );
+      THEN ("the bytes are shared, not copied, and come out in order") {
+        REQUIRE (ibuf2.use_count() == static_cast<std::size_t>(num_bufs + 1));
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == (2 * num_bufs));
+        REQUIRE (qs.bytes_in_output_queue == (num_bufs * (buf1.size() + buf2.size())));
+        chops::repeat(num_bufs, [&outq, &buf1, &ibuf2] () {
+            REQUIRE (outq.get_next_element()->first == buf1);
+            auto e = outq.get_next_element();
+            REQUIRE (e->first == ibuf2);
+            REQUIRE (e->first.data() == ibuf2.data());
+          }
+        );
+        REQUIRE (ibuf2.use_count() == 1u);
+      }
+    }
+    AND_WHEN ("A keyed shared buf is conflated with a keyed intrusive buf") {
+      outq.add_element(buf2, keyed(7u));
+      outq.add_element(ibuf1, keyed(7u));
+      THEN ("the intrusive buf replaces it") {
+        auto qs = outq.get_queue_stats();
+        REQUIRE (qs.output_queue_size == 1);
+        REQUIRE (qs.conflated_bufs == 1);
+        REQUIRE (qs.bytes_in_output_queue == ibuf1.size());
+        REQUIRE (outq.get_next_element()->first == buf1);
+      }
+    }
+  } // end given
+}
+
 SCENARIO ( "Output_queue test, udp endpoint", 
            "[output_queue] [udp]" ) {
 
@@ -92,6 +349,15 @@ SCENARIO ( "Output_queue test, udp endpoint",
   add_element_test<asio::ip::udp::endpoint>(chops::const_shared_buffer(std::move(mb)), 10);
   get_next_element_test<asio::ip::udp::endpoint>(chops::const_shared_buffer(std::move(mb)), 20,
                         asio::ip::udp::endpoint(asio::ip::udp::v4(), 1234));
+  expiry_test<asio::ip::udp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()), 15);
+  conflation_test<asio::ip::udp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                           chops::const_shared_buffer(ba.data(), 2), 50);
+  lane_test<asio::ip::udp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                     chops::const_shared_buffer(ba.data(), 2), 15);
+  multi_part_test<asio::ip::udp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                           chops::const_shared_buffer(ba.data(), 2), 10);
+  intrusive_buffer_test<asio::ip::udp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                                 chops::const_shared_buffer(ba.data(), 2), 10);
 }
 
 SCENARIO ( "Output_queue test, tcp endpoint",
@@ -102,5 +368,14 @@ SCENARIO ( "Output_queue test, tcp endpoint",
   add_element_test<asio::ip::tcp::endpoint>(chops::const_shared_buffer(std::move(mb)), 30);
   get_next_element_test<asio::ip::tcp::endpoint>(chops::const_shared_buffer(std::move(mb)), 40,
                         asio::ip::tcp::endpoint(asio::ip::tcp::v6(), 9876));
+  expiry_test<asio::ip::tcp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()), 25);
+  conflation_test<asio::ip::tcp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                           chops::const_shared_buffer(ba.data(), 3), 500);
+  lane_test<asio::ip::tcp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                     chops::const_shared_buffer(ba.data(), 3), 35);
+  multi_part_test<asio::ip::tcp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                           chops::const_shared_buffer(ba.data(), 3), 20);
+  intrusive_buffer_test<asio::ip::tcp::endpoint>(chops::const_shared_buffer(ba.data(), ba.size()),
+                                                 chops::const_shared_buffer(ba.data(), 3), 20);
 }
 
@@ -9,6 +9,9 @@
  *  The TCP acceptor is the Chops Net IP class, but the connector threads are 
  *  using blocking Asio connects and io.
  *
+ *  The multi-threaded scenarios run the @c io_context from a pool of threads, and
+ *  are meant to also be run with the thread sanitizer (@c CHOPS_NET_IP_OPT_TSAN).
+ *
  *  @author Cliff Green
  *
  *  Copyright (c) 2018-2019 by Cliff Green
@@ -37,6 +40,7 @@
 #include <functional> // std::ref, std::cref
 #include <string_view>
 #include <vector>
+#include <algorithm> // std::min
 
 #include "net_ip/detail/tcp_acceptor.hpp"
 
@@ -105,11 +109,32 @@ std::size_t start_connector_funcs (const vec_buf& in_msg_vec, asio::io_context&
 
 
 void acceptor_test (const vec_buf& in_msg_vec, bool reply, int interval, int num_conns,
-                    std::string_view delim, chops::const_shared_buffer empty_msg) {
+                    std::string_view delim, chops::const_shared_buffer empty_msg,
+                    int num_threads = 1, bool placement = false, std::size_t io_pool_size = 0u) {
 
   chops::net::worker wk;
   wk.start();
   auto& ioc = wk.get_io_context();
+  // additional threads running the same io_context, the worker work guard keeps them running
+  std::vector<std::thread> run_thrs;
+  chops::repeat(num_threads - 1, [&ioc, &run_thrs] () {
+      run_thrs.emplace_back([&ioc] () { ioc.run(); } );
+    }
+  );
+
+  // pinned workers for CPU-affine placement of the accepted connections
+  std::vector<std::unique_ptr<chops::net::worker> > placement_wks;
+  std::vector<chops::net::cpu_placement> placements;
+  if (placement) {
+    int num_cpus = static_cast<int>(std::thread::hardware_concurrency());
+    chops::repeat(2, [&] (int i) {
+        int cpu = (num_cpus > 0) ? (i % num_cpus) : 0;
+        placement_wks.push_back(std::make_unique<chops::net::worker>());
+        placement_wks.back()->start(cpu);
+        placements.push_back(chops::net::cpu_placement { &placement_wks.back()->get_io_context(), cpu });
+      }
+    );
+  }
 
   GIVEN ("An executor work guard and a message set") {
  
@@ -119,9 +144,13 @@ void acceptor_test (const vec_buf& in_msg_vec, bool reply, int interval, int num
         auto endp_seq = 
             chops::net::endpoints_resolver<asio::ip::tcp>(ioc).make_endpoints(true, test_host, test_port);
         auto acc_ptr = 
-            std::make_shared<chops::net::detail::tcp_acceptor>(ioc, *(endp_seq.cbegin()), true);
+            std::make_shared<chops::net::detail::tcp_acceptor>(ioc, *(endp_seq.cbegin()), true,
+                                                               placements);
 
         REQUIRE_FALSE(acc_ptr->is_started());
+        if (io_pool_size != 0u) {
+          REQUIRE (acc_ptr->enable_io_pool(io_pool_size, 0u));
+        }
 
         test_counter recv_cnt = 0;
         acc_ptr->start(
@@ -137,6 +166,9 @@ void acceptor_test (const vec_buf& in_msg_vec, bool reply, int interval, int num
         );
 
         REQUIRE(acc_ptr->is_started());
+        if (io_pool_size != 0u) {
+          REQUIRE_FALSE (acc_ptr->enable_io_pool(io_pool_size, 0u)); // already started
+        }
 
         auto conn_cnt = start_connector_funcs(in_msg_vec, ioc, reply, interval, num_conns,
                                                      delim, empty_msg);
@@ -157,10 +189,44 @@ void acceptor_test (const vec_buf& in_msg_vec, bool reply, int interval, int num
         if (reply) {
           REQUIRE (total_msgs == conn_cnt);
         }
+        auto ps = acc_ptr->get_placement_stats();
+        if (placement) {
+          REQUIRE (ps.total_placed == static_cast<std::size_t>(2 * num_conns));
+          REQUIRE (ps.total_placed == 
+                   (ps.placed_local + ps.placed_nearest + ps.placed_round_robin));
+        }
+        else {
+          REQUIRE (ps.total_placed == 0u);
+        }
+        auto pool_st = acc_ptr->get_io_pool_stats();
+        if (io_pool_size != 0u) {
+          REQUIRE (pool_st.total_allocs == static_cast<std::size_t>(2 * num_conns));
+          REQUIRE (pool_st.pool_hits + pool_st.pool_misses == pool_st.total_allocs);
+          // the pre-allocated blocks are used first
+          REQUIRE (pool_st.pool_hits >= std::min(io_pool_size, pool_st.total_allocs));
+          REQUIRE (pool_st.blocks_owned >= io_pool_size);
+        }
+        else {
+          REQUIRE (pool_st.total_allocs == 0u);
+        }
+        if (io_pool_size != 0u) { // accepted once the close has run in the strand
+          auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+          while (!acc_ptr->enable_io_pool(io_pool_size, 0u) && 
+                 std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+          REQUIRE (acc_ptr->get_io_pool_stats().total_allocs == 0u);
+        }
       }
     }
   } // end given
   wk.reset();
+  for (auto& pw : placement_wks) {
+    pw->reset();
+  }
+  for (auto& t : run_thrs) {
+    t.join();
+  }
 
 }
 
@@ -289,3 +355,40 @@ SCENARIO ( "Tcp acceptor test,  LF msgs, two-way, interval 0, 25 connectors, man
                   std::string_view("\n"), make_empty_lf_text_msg() );
 
 }
+
+SCENARIO ( "Tcp acceptor test, var len msgs, two-way, interval 0, 20 connectors, 4 threads", 
+           "[tcp_acc] [var_len_msg] [two_way] [interval_0] [connectors_20] [multi_thread]" ) {
+
+  acceptor_test ( make_msg_vec (make_variable_len_msg, "Threads, threads!", 'M', 20*NumMsgs),
+                  true, 0, 20,
+                  std::string_view(), make_empty_variable_len_msg(), 4 );
+
+}
+
+SCENARIO ( "Tcp acceptor test,  LF msgs, two-way, interval 0, 25 connectors, 8 threads", 
+           "[tcp_acc] [lf_msg] [two_way] [interval_0] [connectors_25] [multi_thread]" ) {
+
+  acceptor_test ( make_msg_vec (make_lf_text_msg, "Pool of threads!", 'P', 20*NumMsgs),
+                  true, 0, 25,
+                  std::string_view("\n"), make_empty_lf_text_msg(), 8 );
+
+}
+
+SCENARIO ( "Tcp acceptor test, var len msgs, two-way, interval 0, 10 connectors, CPU placement", 
+           "[tcp_acc] [var_len_msg] [two_way] [interval_0] [connectors_10] [placement]" ) {
+
+  acceptor_test ( make_msg_vec (make_variable_len_msg, "Placed!", 'C', 10*NumMsgs),
+                  true, 0, 10,
+                  std::string_view(), make_empty_variable_len_msg(), 1, true );
+
+}
+
+SCENARIO ( "Tcp acceptor test, var len msgs, two-way, interval 0, 10 connectors, IO handler pool", 
+           "[tcp_acc] [var_len_msg] [two_way] [interval_0] [connectors_10] [io_pool]" ) {
+
+  acceptor_test ( make_msg_vec (make_variable_len_msg, "Pooled!", 'D', 10*NumMsgs),
+                  true, 0, 10,
+                  std::string_view(), make_empty_variable_len_msg(), 1, false, 4u );
+
+}
+
@@ -0,0 +1,158 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Per connection memory footprint report for TCP IO handlers.
+ *
+ *  The size of the IO handler classes is reported, along with the resident set size
+ *  growth per accepted connection (Linux only), so that changes to the per connection
+ *  memory use are easy to spot.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include "asio/ip/tcp.hpp"
+#include "asio/io_context.hpp"
+
+#include <system_error> // std::error_code
+#include <cstddef> // std::size_t
+#include <memory> // std::make_shared
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <fstream>
+
+#if defined(__linux__)
+#include <unistd.h> // sysconf
+#endif
+
+#include "net_ip/detail/tcp_acceptor.hpp"
+#include "net_ip/detail/tcp_io.hpp"
+#include "net_ip/detail/io_common.hpp"
+#include "net_ip/detail/output_queue.hpp"
+#include "net_ip/io_interface.hpp"
+#include "net_ip/component/worker.hpp"
+#include "net_ip/component/simple_variable_len_msg_frame.hpp"
+
+#include "net_ip/shared_utility_test.hpp"
+
+#include "utility/repeat.hpp"
+
+using namespace chops::test;
+
+constexpr unsigned short footprint_test_port = 30997;
+constexpr int NumConns = 200;
+
+// upper bounds for 64-bit builds, a little above the current sizes; if one of these
+// fails, a change has grown the per connection footprint and the bound should only be
+// raised if that is intended
+constexpr std::size_t max_tcp_io_size = 512u;
+constexpr std::size_t max_io_common_size = 160u;
+constexpr std::size_t max_output_queue_size = 64u;
+
+// resident set size in bytes, zero if not available
+std::size_t resident_set_size() {
+#if defined(__linux__)
+  std::ifstream statm("/proc/self/statm");
+  std::size_t total_pages = 0;
+  std::size_t resident_pages = 0;
+  if (statm >> total_pages >> resident_pages) {
+    return resident_pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  }
+#endif
+  return 0u;
+}
+
+template <typename Pred>
+bool wait_until (Pred pred) {
+  int tries = 0;
+  while (!pred() && ++tries < 100) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return pred();
+}
+
+SCENARIO ( "Tcp IO handler object sizes", "[tcp_footprint]" ) {
+
+  using namespace chops::net::detail;
+
+  GIVEN ("The classes that make up a TCP connection") {
+    THEN ("their sizes are reported and bounded, and the notifier is shared instead of embedded") {
+      WARN ("sizeof tcp_io: " << sizeof(tcp_io) <<
+            ", io_common: " << sizeof(io_common<tcp_io>) <<
+            ", output_queue: " << sizeof(output_queue<asio::ip::tcp::endpoint>) <<
+            ", socket: " << sizeof(asio::ip::tcp::socket));
+      REQUIRE (sizeof(tcp_io::entity_notifier_ptr) < sizeof(tcp_io::entity_notifier_cb));
+      if (sizeof(void*) == 8u) {
+        REQUIRE (sizeof(tcp_io) <= max_tcp_io_size);
+        REQUIRE (sizeof(io_common<tcp_io>) <= max_io_common_size);
+        REQUIRE (sizeof(output_queue<asio::ip::tcp::endpoint>) <= max_output_queue_size);
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Tcp accepted connection resident memory", "[tcp_footprint]" ) {
+
+  chops::net::worker wk;
+  wk.start();
+
+  std::atomic_size_t num_up { 0u };
+
+  GIVEN ("An acceptor and many connections to it") {
+
+    asio::ip::tcp::endpoint endp(asio::ip::make_address("127.0.0.1"), footprint_test_port);
+    auto acc_ptr = std::make_shared<chops::net::detail::tcp_acceptor>(wk.get_io_context(),
+                                                                      endp, true);
+    test_counter recv_cnt = 0;
+    acc_ptr->start(
+      [&num_up, &recv_cnt] (chops::net::tcp_io_interface io, std::size_t num, bool starting) {
+        num_up = num;
+        if (starting) {
+          io.start_io(2, tcp_msg_hdlr(false, recv_cnt),
+                      chops::net::make_simple_variable_len_msg_frame(decode_variable_len_msg_hdr));
+        }
+      },
+      [] (chops::net::tcp_io_interface, std::error_code) { }
+    );
+
+    WHEN ("the connections are established") {
+
+      asio::io_context cli_ioc;
+      std::vector<asio::ip::tcp::socket> socks;
+      socks.reserve(NumConns);
+      auto rss_before = resident_set_size();
+      chops::repeat(NumConns, [&] {
+          socks.emplace_back(cli_ioc);
+          socks.back().connect(endp);
+        }
+      );
+      bool all_up = wait_until([&num_up] { return num_up == static_cast<std::size_t>(NumConns); } );
+      auto rss_after = resident_set_size();
+
+      acc_ptr->stop();
+      bool all_down = wait_until([&num_up] { return num_up == 0u; } );
+
+      THEN ("every connection is accepted and the memory per connection is reported") {
+        REQUIRE (all_up);
+        REQUIRE (all_down);
+        if (rss_before != 0u && rss_after > rss_before) {
+          WARN ("Resident memory per connection (including client socket): " <<
+                (rss_after - rss_before) / NumConns << " bytes");
+        }
+      }
+    }
+  } // end given
+
+  wk.reset();
+}
+
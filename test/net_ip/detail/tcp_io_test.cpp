@@ -18,16 +18,23 @@
 #include "asio/ip/tcp.hpp"
 #include "asio/connect.hpp"
 #include "asio/io_context.hpp"
+#include "asio/read.hpp"
+#include "asio/write.hpp"
+#include "asio/post.hpp"
 
 #include <system_error> // std::error_code
 #include <cstddef> // std::size_t
-#include <memory> // std::make_shared
+#include <array>
+#include <vector>
+#include <algorithm> // std::equal
+#include <memory> // std::make_shared, std::weak_ptr
 #include <utility> // std::move
 #include <thread>
 #include <future>
 #include <chrono>
 #include <functional> // std::ref, std::cref
 #include <string_view>
+#include <atomic>
 
 #include "net_ip/detail/tcp_io.hpp"
 
@@ -36,6 +43,7 @@
 
 #include "net_ip/shared_utility_test.hpp"
 #include "utility/shared_buffer.hpp"
+#include "utility/repeat.hpp"
 
 // #include <iostream>
 
@@ -64,8 +72,9 @@ struct notify_me {
   }
 };
 
-std::size_t connector_func (const vec_buf& in_msg_vec, asio::io_context& ioc, 
-                            int interval, std::string_view delim, chops::const_shared_buffer empty_msg) {
+std::size_t connector_func (const vec_buf& in_msg_vec, asio::io_context& ioc, bool reply,
+                            int interval, std::string_view delim, chops::const_shared_buffer empty_msg,
+                            std::chrono::microseconds coalesce, bool multi_part, bool speculative) {
 
   auto endps = 
       chops::net::endpoints_resolver<asio::ip::tcp>(ioc).make_endpoints(true, test_addr, test_port);
@@ -81,14 +90,40 @@ std::size_t connector_func (const vec_buf& in_msg_vec, asio::io_context& ioc,
 
   test_counter cnt = 0;
   tcp_start_io(chops::net::tcp_io_interface(iohp), false, delim, cnt);
+  if (coalesce != std::chrono::microseconds::zero()) {
+    iohp->set_output_coalescing(coalesce, 0);
+  }
+  if (speculative) {
+    iohp->set_speculative_write(true);
+    iohp->set_speculative_read(4u);
+  }
 
   for (auto buf : in_msg_vec) {
-    iohp->send(buf);
+    if (multi_part) { // first byte and rest of message sent as separate parts
+      iohp->send(std::array<chops::const_shared_buffer, 2> { 
+                   chops::const_shared_buffer(buf.data(), 1),
+                   chops::const_shared_buffer(buf.data() + 1, buf.size() - 1) } );
+    }
+    else {
+      iohp->send(buf);
+    }
     std::this_thread::sleep_for(std::chrono::milliseconds(interval));
   }
+  // the other side discards queued replies when it shuts down, so wait for them first
+  if (reply) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (cnt < in_msg_vec.size() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
   iohp->send(empty_msg);
 
   auto err = notify_fut.get();
+  if (speculative) {
+    auto qs = iohp->get_output_queue_stats();
+    assert (qs.speculative_writes != 0);
+    assert (qs.speculative_writes_completed <= qs.speculative_writes);
+  }
 
 // std::cerr << "Inside connector func, err: " << err << ", " << err.message() << std::endl;
 
@@ -96,7 +131,9 @@ std::size_t connector_func (const vec_buf& in_msg_vec, asio::io_context& ioc,
 }
 
 void acc_conn_test (const vec_buf& in_msg_vec, bool reply, int interval, std::string_view delim,
-                    chops::const_shared_buffer empty_msg) {
+                    chops::const_shared_buffer empty_msg, 
+                    std::chrono::microseconds coalesce = std::chrono::microseconds::zero(),
+                    bool multi_part = false, bool speculative = false, bool batch = false) {
 
   chops::net::worker wk;
   wk.start();
@@ -114,7 +151,8 @@ void acc_conn_test (const vec_buf& in_msg_vec, bool reply, int interval, std::st
         INFO ("Creating connector asynchronously, msg interval: " << interval);
 
         auto conn_fut = std::async(std::launch::async, connector_func, std::cref(in_msg_vec), 
-                                   std::ref(ioc), interval, delim, empty_msg);
+                                   std::ref(ioc), reply, interval, delim, empty_msg, coalesce, multi_part,
+                                   speculative);
 
         notify_prom_type notify_prom;
         auto notify_fut = notify_prom.get_future();
@@ -122,7 +160,17 @@ void acc_conn_test (const vec_buf& in_msg_vec, bool reply, int interval, std::st
         auto iohp = std::make_shared<chops::net::detail::tcp_io>(std::move(acc.accept()), 
                                                                  notify_me(std::move(notify_prom)));
         test_counter cnt = 0;
-        tcp_start_io(chops::net::tcp_io_interface(iohp), reply, delim, cnt);
+        if (speculative) {
+          iohp->set_speculative_read(8u);
+          iohp->set_read_budget(4u, 0u);
+        }
+        test_counter batch_cnt = 0;
+        if (batch) {
+          tcp_start_io_batch(chops::net::tcp_io_interface(iohp), reply, delim, cnt, batch_cnt);
+        }
+        else {
+          tcp_start_io(chops::net::tcp_io_interface(iohp), reply, delim, cnt);
+        }
 
         auto acc_err = notify_fut.get();
 // std::cerr << "Inside acc_conn_test, acc_err: " << acc_err << ", " << acc_err.message() << std::endl;
@@ -133,6 +181,16 @@ void acc_conn_test (const vec_buf& in_msg_vec, bool reply, int interval, std::st
         if (reply) {
           REQUIRE (in_msg_vec.size() == conn_cnt);
         }
+        auto is = iohp->get_input_stats();
+        // in batch mode the shutdown msg is counted before the handler sees it
+        REQUIRE (is.total_msgs_read == in_msg_vec.size() + (batch ? 1u : 0u));
+        if (speculative) {
+          REQUIRE (is.read_budget_yields == (in_msg_vec.size() / 4u));
+        }
+        if (batch) {
+          REQUIRE (batch_cnt != 0u);
+          REQUIRE (batch_cnt <= in_msg_vec.size() + 1u); // shutdown msg may be alone
+        }
       }
     }
   } // end given
@@ -161,6 +219,66 @@ SCENARIO ( "Tcp IO handler test, variable len msgs, one-way, interval 0",
 
 }
 
+SCENARIO ( "Tcp IO handler test, variable len msgs, one-way, interval 0, coalescing",
+           "[tcp_io] [var_len_msg] [one-way] [interval_0] [coalesce]" ) {
+
+  acc_conn_test ( make_msg_vec (make_variable_len_msg, "Hoo!", 'S', 2*NumMsgs),
+                  false, 0,
+                  std::string_view(), make_empty_variable_len_msg(),
+                  std::chrono::microseconds(200) );
+
+}
+
+SCENARIO ( "Tcp IO handler test, variable len msgs, two-way, interval 0, multi-part sends",
+           "[tcp_io] [var_len_msg] [two_way] [interval_0] [multi_part]" ) {
+
+  acc_conn_test ( make_msg_vec (make_variable_len_msg, "Hee!", 'T', 2*NumMsgs),
+                  true, 0,
+                  std::string_view(), make_empty_variable_len_msg(),
+                  std::chrono::microseconds::zero(), true );
+
+}
+
+SCENARIO ( "Tcp IO handler test, CR / LF msgs, two-way, interval 0, speculative reads and writes",
+           "[tcp_io] [cr_lf_msg] [two_way] [interval_0] [speculative]" ) {
+
+  acc_conn_test ( make_msg_vec (make_cr_lf_text_msg, "Pop!", 'P', 4*NumMsgs),
+                  true, 0,
+                  std::string_view("\r\n"), make_empty_cr_lf_text_msg(),
+                  std::chrono::microseconds::zero(), false, true );
+
+}
+
+SCENARIO ( "Tcp IO handler test, variable len msgs, two-way, interval 0, speculative reads and writes",
+           "[tcp_io] [var_len_msg] [two_way] [interval_0] [speculative]" ) {
+
+  acc_conn_test ( make_msg_vec (make_variable_len_msg, "Hoo hah!", 'W', 2*NumMsgs),
+                  true, 0,
+                  std::string_view(), make_empty_variable_len_msg(),
+                  std::chrono::microseconds::zero(), false, true );
+
+}
+
+SCENARIO ( "Tcp IO handler test, variable len msgs, two-way, interval 0, batch delivery",
+           "[tcp_io] [var_len_msg] [two_way] [interval_0] [batch]" ) {
+
+  acc_conn_test ( make_msg_vec (make_variable_len_msg, "Batch it!", 'B', 10*NumMsgs),
+                  true, 0,
+                  std::string_view(), make_empty_variable_len_msg(),
+                  std::chrono::microseconds(200), false, false, true );
+
+}
+
+SCENARIO ( "Tcp IO handler test, LF msgs, one-way, interval 0, batch delivery",
+           "[tcp_io] [lf_msg] [one-way] [interval_0] [batch]" ) {
+
+  acc_conn_test ( make_msg_vec (make_lf_text_msg, "Batch, batch!", 'C', 10*NumMsgs),
+                  false, 0,
+                  std::string_view("\n"), make_empty_lf_text_msg(),
+                  std::chrono::microseconds(200), false, false, true );
+
+}
+
 SCENARIO ( "Tcp IO handler test, variable len msgs, two-way, interval 50",
            "[tcp_io] [var_len_msg] [two_way] [interval_50]" ) {
 
@@ -251,3 +369,355 @@ SCENARIO ( "Tcp IO handler test, LF msgs, two-way, interval 0, many msgs",
 
 }
 
+
+// a connected pair of sockets, the acceptor is closed once the connection is made
+asio::ip::tcp::socket connect_pair (asio::io_context& ioc, asio::ip::tcp::socket& peer) {
+  auto endps = 
+      chops::net::endpoints_resolver<asio::ip::tcp>(ioc).make_endpoints(true, test_addr, test_port);
+  asio::ip::tcp::acceptor acc(ioc, *(endps.cbegin()));
+  asio::ip::tcp::socket sock(ioc);
+  asio::connect(sock, endps);
+  peer = acc.accept();
+  return sock;
+}
+
+template <typename P>
+bool wait_for (P pred) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!pred() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return pred();
+}
+
+SCENARIO ( "Tcp IO handler test, close with an open coalescing window",
+           "[tcp_io] [coalesce]" ) {
+
+  chops::net::worker wk;
+  wk.start();
+  auto& ioc = wk.get_io_context();
+
+  GIVEN ("A started IO handler with a long coalescing window") {
+    asio::ip::tcp::socket peer(ioc);
+    auto iohp = std::make_shared<chops::net::detail::tcp_io>(connect_pair(ioc, peer),
+                  [] (std::error_code, chops::net::detail::tcp_io_ptr) { } );
+    std::weak_ptr<chops::net::detail::tcp_io> wp(iohp);
+    test_counter cnt = 0;
+    tcp_start_io(chops::net::tcp_io_interface(iohp), false, std::string_view(), cnt);
+    iohp->set_output_coalescing(std::chrono::seconds(30), 0);
+
+    WHEN ("a send opens the window and the IO handler is closed") {
+      iohp->send(make_variable_len_msg(make_body_buf("Hold", 'H', 10)));
+      std::this_thread::sleep_for(std::chrono::milliseconds(50)); // the send is posted
+      iohp->close();
+      iohp.reset();
+      THEN ("the IO handler is released without waiting for the window to expire") {
+        REQUIRE (wait_for([&wp] { return wp.expired(); }));
+      }
+    }
+  } // end given
+
+  wk.reset();
+
+}
+
+SCENARIO ( "Tcp IO handler test, queue attributes of the buffer opening a coalescing window",
+           "[tcp_io] [coalesce]" ) {
+
+  chops::net::worker wk;
+  wk.start();
+  auto& ioc = wk.get_io_context();
+
+  GIVEN ("A started IO handler with a coalescing window") {
+    asio::ip::tcp::socket peer(ioc);
+    auto iohp = std::make_shared<chops::net::detail::tcp_io>(connect_pair(ioc, peer),
+                  [] (std::error_code, chops::net::detail::tcp_io_ptr) { } );
+    test_counter cnt = 0;
+    tcp_start_io(chops::net::tcp_io_interface(iohp), false, std::string_view(), cnt);
+    iohp->set_output_coalescing(std::chrono::milliseconds(100), 0);
+
+    WHEN ("an idle send with a short max age opens the window, then sends on two lanes") {
+      auto low = make_variable_len_msg(make_body_buf("Low", 'L', 10));
+      auto high = make_variable_len_msg(make_body_buf("High", 'H', 10));
+      std::this_thread::sleep_for(std::chrono::milliseconds(20)); // the setting is posted
+      iohp->send(make_variable_len_msg(make_body_buf("Old", 'O', 10)),
+                 std::chrono::milliseconds(1));
+      iohp->send(low, 1u);
+      iohp->send(high, 0u);
+      THEN ("the first buffer expires and the higher lane is written first") {
+        REQUIRE (wait_for([&iohp] {
+            return iohp->get_output_queue_stats().total_bufs_sent == 2u; } ));
+        REQUIRE (iohp->get_output_queue_stats().expired_bufs == 1u);
+        std::vector<char> in(high.size() + low.size());
+        asio::read(peer, asio::buffer(in));
+        REQUIRE (std::equal(high.data(), high.data() + high.size(),
+                            reinterpret_cast<const std::byte*>(in.data())));
+        iohp->close();
+      }
+    }
+  } // end given
+
+  wk.reset();
+
+}
+
+SCENARIO ( "Tcp IO handler test, batch delivery start and large msgs",
+           "[tcp_io] [batch]" ) {
+
+  chops::net::worker wk;
+  wk.start();
+  auto& ioc = wk.get_io_context();
+
+  GIVEN ("An IO handler that is not started") {
+    asio::ip::tcp::socket peer(ioc);
+    auto iohp = std::make_shared<chops::net::detail::tcp_io>(connect_pair(ioc, peer),
+                  [] (std::error_code, chops::net::detail::tcp_io_ptr) { } );
+    test_counter cnt = 0;
+    test_counter batch_cnt = 0;
+
+    WHEN ("batch delivery is started with a zero header size or an empty delimiter") {
+      THEN ("the start is rejected and the IO handler is not started") {
+        REQUIRE_FALSE (iohp->start_io_batch(0, tcp_batch_msg_hdlr(false, cnt, batch_cnt),
+                         chops::net::make_simple_variable_len_msg_frame(decode_variable_len_msg_hdr)));
+        REQUIRE_FALSE (iohp->start_io_batch(std::string_view(),
+                                            tcp_batch_msg_hdlr(false, cnt, batch_cnt)));
+        REQUIRE_FALSE (iohp->is_io_started());
+        REQUIRE (tcp_start_io_batch(chops::net::tcp_io_interface(iohp), false,
+                                    std::string_view(), cnt, batch_cnt));
+        iohp->close();
+      }
+    }
+
+    AND_WHEN ("msgs larger than the batch read size are received") {
+      REQUIRE (tcp_start_io_batch(chops::net::tcp_io_interface(iohp), false,
+                                  std::string_view(), cnt, batch_cnt));
+      constexpr int num_large = 4;
+      for (int i = 0; i < num_large; ++i) {
+        auto msg = make_variable_len_msg(make_body_buf("Large", 'L', 40000 + i * 1000));
+        asio::write(peer, asio::const_buffer(msg.data(), msg.size()));
+      }
+      THEN ("each one is delivered whole") {
+        REQUIRE (wait_for([&cnt] { return cnt == num_large; }));
+        REQUIRE (iohp->get_input_stats().total_msgs_read == num_large);
+        iohp->close();
+      }
+    }
+  } // end given
+
+  wk.reset();
+
+}
+
+SCENARIO ( "Tcp IO handler test, migration with a move only message handler",
+           "[tcp_io] [migrate]" ) {
+
+  chops::net::worker wk1;
+  wk1.start();
+  chops::net::worker wk2;
+  wk2.start();
+  auto& ioc1 = wk1.get_io_context();
+  auto& ioc2 = wk2.get_io_context();
+
+  GIVEN ("An IO handler started with a message handler that can only be moved") {
+    asio::ip::tcp::socket peer(ioc1);
+    auto iohp = std::make_shared<chops::net::detail::tcp_io>(connect_pair(ioc1, peer),
+                  [] (std::error_code, chops::net::detail::tcp_io_ptr) { } );
+    test_counter cnt = 0;
+    std::atomic_bool on_ioc2 { false };
+    iohp->start_io(2, [&cnt, &on_ioc2, &ioc2, tag = std::make_unique<int>(42)] 
+                          (asio::const_buffer, chops::net::tcp_io_interface, 
+                           asio::ip::tcp::endpoint) {
+          ++cnt;
+          on_ioc2 = ioc2.get_executor().running_in_this_thread();
+          return *tag == 42;
+        },
+        chops::net::make_simple_variable_len_msg_frame(decode_variable_len_msg_hdr));
+
+    WHEN ("messages arrive before and after it migrates to another io_context") {
+      auto msg = make_variable_len_msg(make_body_buf("Move!", 'M', 20));
+      auto send_msgs = [&peer, &msg] {
+        chops::repeat(NumMsgs, [&peer, &msg] { 
+            asio::write(peer, asio::const_buffer(msg.data(), msg.size()));
+          }
+        );
+      };
+      send_msgs();
+      REQUIRE (wait_for([&cnt] { return cnt == NumMsgs; }));
+      REQUIRE_FALSE (on_ioc2);
+      iohp->migrate_to(ioc2);
+      send_msgs();
+      THEN ("every message is delivered, the later ones on the new io_context") {
+        REQUIRE (wait_for([&cnt] { return cnt == 2 * NumMsgs; }));
+        REQUIRE (on_ioc2);
+      }
+    }
+    iohp->close();
+  } // end given
+
+  wk2.reset();
+  wk1.reset();
+
+}
+
+// each migration cancels an armed coalescing window, and the cancelled timer completes
+// on the old io_context while the new one is already sending; incoming messages with a 
+// read budget of one message keep a yield pending; build with CHOPS_NET_IP_OPT_TSAN to 
+// check that nothing is shared between the two threads
+
+SCENARIO ( "Tcp IO handler test, migration with an armed coalescing window",
+           "[tcp_io] [migrate] [coalesce] [tsan]" ) {
+
+  constexpr int num_migrations = 10;
+
+  chops::net::worker wk1;
+  wk1.start();
+  chops::net::worker wk2;
+  wk2.start();
+  auto& ioc1 = wk1.get_io_context();
+  auto& ioc2 = wk2.get_io_context();
+
+  GIVEN ("A started IO handler with a coalescing window and a read budget") {
+    asio::ip::tcp::socket peer(ioc1);
+    auto iohp = std::make_shared<chops::net::detail::tcp_io>(connect_pair(ioc1, peer),
+                  [] (std::error_code, chops::net::detail::tcp_io_ptr) { } );
+    std::weak_ptr<chops::net::detail::tcp_io> wp(iohp);
+    test_counter cnt = 0;
+    tcp_start_io(chops::net::tcp_io_interface(iohp), false, std::string_view(), cnt);
+    iohp->set_output_coalescing(std::chrono::milliseconds(5), 0);
+    iohp->set_read_budget(1u, 0u);
+
+    WHEN ("messages are sent and received while it migrates back and forth") {
+      auto msg = make_variable_len_msg(make_body_buf("Hop!", 'H', 20));
+      auto wr = std::async(std::launch::async, [&peer, &msg] {
+          chops::repeat(num_migrations * NumMsgs, [&peer, &msg] {
+              asio::write(peer, asio::const_buffer(msg.data(), msg.size()));
+            }
+          );
+        }
+      );
+      auto rd = std::async(std::launch::async, [&peer, &msg] {
+          std::size_t total = 0;
+          chops::mutable_shared_buffer buf { };
+          buf.resize(msg.size());
+          chops::repeat(num_migrations * NumMsgs, [&] {
+              total += asio::read(peer, asio::mutable_buffer(buf.data(), buf.size()));
+            }
+          );
+          return total;
+        }
+      );
+      chops::repeat(num_migrations, [&] (int i) {
+          chops::repeat(NumMsgs, [&iohp, &msg] { iohp->send(msg); } );
+          iohp->migrate_to(i % 2 == 0 ? ioc2 : ioc1);
+        }
+      );
+      THEN ("every message is delivered, and the IO handler is released after close") {
+        REQUIRE (rd.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+        REQUIRE (rd.get() == num_migrations * NumMsgs * msg.size());
+        wr.get();
+        REQUIRE (wait_for([&cnt] { return cnt == num_migrations * NumMsgs; }));
+        iohp->close();
+        iohp.reset();
+        REQUIRE (wait_for([&wp] { return wp.expired(); }));
+      }
+    }
+  } // end given
+
+  wk2.reset();
+  wk1.reset();
+
+}
+
+// ping-pong latency benchmark, the reply is either sent from within the message handler
+// (inline send) or from a separately posted function, which costs the executor round 
+// trip that every send took before the inline path
+
+std::chrono::nanoseconds ping_pong_client (asio::io_context& ioc, chops::const_shared_buffer msg, 
+                                           int num_round_trips) {
+
+  asio::ip::tcp::socket sock(ioc);
+  auto endps = 
+      chops::net::endpoints_resolver<asio::ip::tcp>(ioc).make_endpoints(true, test_addr, test_port);
+  asio::connect(sock, endps);
+  sock.set_option(asio::ip::tcp::no_delay(true));
+
+  chops::mutable_shared_buffer return_msg { };
+  return_msg.resize(msg.size());
+  auto start = std::chrono::steady_clock::now();
+  chops::repeat(num_round_trips, [&sock, &msg, &return_msg] () {
+      asio::write(sock, asio::const_buffer(msg.data(), msg.size()));
+      asio::read(sock, asio::mutable_buffer(return_msg.data(), return_msg.size()));
+    }
+  );
+  return (std::chrono::steady_clock::now() - start) / num_round_trips;
+}
+
+void ping_pong_test (int num_round_trips, bool post_reply) {
+
+  chops::net::worker wk;
+  wk.start();
+  auto& ioc = wk.get_io_context();
+
+  GIVEN ("An executor work guard and a ping-pong message") {
+ 
+    WHEN ("a connector sends a message and waits for the reply, many times") {
+      THEN ("the average round trip time is reported") {
+
+        auto endps = 
+            chops::net::endpoints_resolver<asio::ip::tcp>(ioc).make_endpoints(true, test_addr, test_port);
+        asio::ip::tcp::acceptor acc(ioc, *(endps.cbegin()));
+
+        auto msg = make_variable_len_msg(make_body_buf("Ping!", 'P', 20));
+        auto conn_fut = std::async(std::launch::async, ping_pong_client, std::ref(ioc), 
+                                   msg, num_round_trips);
+
+        notify_prom_type notify_prom;
+        auto notify_fut = notify_prom.get_future();
+
+        auto sock = acc.accept();
+        sock.set_option(asio::ip::tcp::no_delay(true));
+        auto iohp = std::make_shared<chops::net::detail::tcp_io>(std::move(sock), 
+                                                                 notify_me(std::move(notify_prom)));
+        test_counter cnt = 0;
+        iohp->start_io(2, [&ioc, &cnt, post_reply] (asio::const_buffer buf, 
+                                                      chops::net::tcp_io_interface io, 
+                                                      asio::ip::tcp::endpoint) {
+            chops::const_shared_buffer sh_buf(buf.data(), buf.size());
+            ++cnt;
+            if (post_reply) {
+              asio::post(ioc, [io, sh_buf] { io.send(sh_buf); } );
+            }
+            else {
+              io.send(sh_buf);
+            }
+            return true;
+          },
+          chops::net::make_simple_variable_len_msg_frame(decode_variable_len_msg_hdr));
+
+        auto avg = conn_fut.get();
+        notify_fut.get(); // client closing the connection stops the io handler
+
+        WARN ("Ping-pong average round trip, " << (post_reply ? "posted" : "inline") << 
+              " reply: " << avg.count() << " ns");
+        REQUIRE (cnt == static_cast<std::size_t>(num_round_trips));
+      }
+    }
+  } // end given
+
+  wk.reset();
+
+}
+
+SCENARIO ( "Tcp IO handler ping-pong latency benchmark, inline reply",
+           "[tcp_io] [ping_pong] [.] [benchmark]" ) {
+
+  ping_pong_test(20000, false);
+
+}
+
+SCENARIO ( "Tcp IO handler ping-pong latency benchmark, posted reply",
+           "[tcp_io] [ping_pong] [.] [benchmark]" ) {
+
+  ping_pong_test(20000, true);
+
+}
@@ -31,6 +31,7 @@
 #include <future>
 #include <chrono>
 #include <vector>
+#include <atomic>
 #include <functional> // std::ref, std::cref
 
 #include "net_ip/detail/udp_entity_io.hpp"
@@ -288,3 +289,66 @@ SCENARIO ( "Udp IO handler test, LF msgs, two-way, interval 50, senders 2, many
 }
 
 
+SCENARIO ( "Udp IO handler test, var len msgs, one-way, interval 0, batch delivery",
+           "[udp_io] [var_len_msg] [one_way] [interval_0] [batch]" ) {
+
+  auto in_msg_vec = make_msg_vec (make_variable_len_msg, "Batch!", 'B', 20*NumMsgs);
+
+  chops::net::worker wk;
+  wk.start();
+  auto& ioc = wk.get_io_context();
+
+  GIVEN ("A receiving UDP entity started with a batch handler") {
+
+    auto recv_endp = make_udp_endpoint(test_addr, test_port_base);
+    auto send_endp = make_udp_endpoint(test_addr, test_port_base+1);
+    auto recv_ptr = std::make_shared<chops::net::detail::udp_entity_io>(ioc, recv_endp);
+    recv_ptr->start( [] (chops::net::udp_io_interface, std::size_t, bool) { },
+                     [] (chops::net::udp_io_interface, std::error_code) { } );
+
+    test_counter recv_cnt = 0;
+    test_counter batch_cnt = 0;
+    std::atomic_bool endp_ok { true };
+    recv_ptr->start_io_batch(udp_max_buf_size, 
+        [&] (const std::vector<const_buffer>& bufs, chops::net::udp_io_interface,
+             const std::vector<ip::udp::endpoint>& endps) {
+          ++batch_cnt;
+          recv_cnt += bufs.size();
+          if (endps.size() != bufs.size()) {
+            endp_ok = false;
+          }
+          for (const auto& e : endps) {
+            if (e != send_endp) {
+              endp_ok = false;
+            }
+          }
+          return true;
+        }
+    );
+
+    WHEN ("datagrams are sent back to back") {
+      ip::udp::socket sock(ioc, send_endp);
+      for (auto buf : in_msg_vec) {
+        sock.send_to(const_buffer(buf.data(), buf.size()), recv_endp);
+      }
+      int tries = 0;
+      while (recv_cnt < in_msg_vec.size() && ++tries < 20) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      recv_ptr->stop();
+
+      THEN ("every datagram is delivered with its sender endpoint, in no more handler calls than datagrams") {
+        // CHECK instead of REQUIRE since UDP is an unreliable protocol
+        CHECK (recv_cnt == in_msg_vec.size());
+        REQUIRE (endp_ok);
+        REQUIRE (batch_cnt != 0u);
+        REQUIRE (batch_cnt <= recv_cnt);
+        REQUIRE (recv_ptr->get_input_stats().total_msgs_read == recv_cnt);
+      }
+    }
+  } // end given
+
+  wk.reset();
+
+}
+
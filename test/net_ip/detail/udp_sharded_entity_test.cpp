@@ -0,0 +1,145 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenarios for @c udp_sharded_entity detail class.
+ *
+ *  Many UDP senders (each with its own source port) send to one sharded receiver, and
+ *  the datagrams received by all of the shards are counted.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include "asio/ip/udp.hpp"
+#include "asio/io_context.hpp"
+
+#include <system_error> // std::error_code
+#include <cstddef> // std::size_t
+#include <memory> // std::make_shared, std::unique_ptr
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+
+#include "net_ip/detail/udp_sharded_entity.hpp"
+
+#include "net_ip/net_entity.hpp"
+#include "net_ip/io_interface.hpp"
+#include "net_ip/queue_stats.hpp"
+
+#include "net_ip/component/worker.hpp"
+
+#include "net_ip/shared_utility_test.hpp"
+
+#include "utility/repeat.hpp"
+
+using namespace asio;
+using namespace chops::test;
+
+const char*   sharded_test_addr = "127.0.0.1";
+constexpr int sharded_test_port_base = 30865;
+constexpr int NumShards = 4;
+constexpr int NumSenders = 16;
+constexpr int NumMsgsPerSender = 50;
+
+void sharded_recv_test (bool cpu_steering) {
+
+  auto in_msg_vec = make_msg_vec (make_variable_len_msg, "Shard!", 'S', NumMsgsPerSender);
+
+  std::vector<std::unique_ptr<chops::net::worker> > wks;
+  std::vector<io_context*> iocs;
+  chops::repeat(NumShards, [&] {
+      wks.push_back(std::make_unique<chops::net::worker>());
+      wks.back()->start();
+      iocs.push_back(&wks.back()->get_io_context());
+    }
+  );
+
+  // the callbacks can run until the workers are reset
+  test_counter recv_cnt = 0;
+  std::atomic_size_t max_up { 0u };
+  std::atomic_size_t num_errs { 0u };
+
+  GIVEN ("A sharded UDP entity, one shard per io_context") {
+
+    auto recv_endp = make_udp_endpoint(sharded_test_addr, sharded_test_port_base);
+    auto ent_ptr = std::make_shared<chops::net::detail::udp_sharded_entity>(iocs, recv_endp,
+                                                                            cpu_steering);
+    chops::net::udp_sharded_net_entity ent(ent_ptr);
+
+    REQUIRE (ent.start( [&] (chops::net::udp_io_interface io, std::size_t num, bool starting) {
+                          if (starting) {
+                            max_up = num;
+                            udp_start_io(io, false, recv_cnt);
+                          }
+                        },
+                        [&] (chops::net::udp_io_interface, std::error_code) { ++num_errs; } ));
+
+    WHEN ("datagrams are sent from many senders") {
+      io_context send_ioc;
+      std::vector<ip::udp::socket> senders;
+      chops::repeat(NumSenders, [&] (int i) {
+          senders.emplace_back(send_ioc, make_udp_endpoint(sharded_test_addr,
+                                                           sharded_test_port_base+i+1));
+        }
+      );
+      for (auto buf : in_msg_vec) {
+        for (auto& sock : senders) {
+          sock.send_to(const_buffer(buf.data(), buf.size()), recv_endp);
+        }
+      }
+      std::size_t tot = in_msg_vec.size() * NumSenders;
+      int tries = 0;
+      while (recv_cnt < tot && ++tries < 20) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      ent.stop();
+      // let the last handler invocations finish their accounting
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      auto st = ent.get_shard_stats();
+
+      THEN ("every datagram is received by one of the shards") {
+#if defined(SO_REUSEPORT)
+        REQUIRE (st.size() == static_cast<std::size_t>(NumShards));
+#endif
+        REQUIRE (max_up == st.size());
+        // CHECK instead of REQUIRE since UDP is an unreliable protocol
+        CHECK (recv_cnt == tot);
+        std::size_t sum = 0u;
+        std::size_t shards_used = 0u;
+        for (const auto& s : st) {
+          sum += s.input.total_msgs_read;
+          shards_used += (s.input.total_msgs_read != 0u) ? 1u : 0u;
+        }
+        REQUIRE (sum == recv_cnt);
+        if (!cpu_steering) {
+          // flows are hashed, so with this many senders more than one shard is used
+          CHECK (shards_used > 1u);
+        }
+      }
+    }
+  } // end given
+
+  for (auto& wk : wks) {
+    wk->reset();
+  }
+}
+
+SCENARIO ( "Udp sharded entity test, flow hashing",
+           "[udp_sharded] [var_len_msg] [one_way]" ) {
+  sharded_recv_test(false);
+}
+
+SCENARIO ( "Udp sharded entity test, CPU steering",
+           "[udp_sharded] [var_len_msg] [one_way]" ) {
+  sharded_recv_test(true);
+}
+
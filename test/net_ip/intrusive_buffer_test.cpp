@@ -0,0 +1,180 @@
+/** @file
+ *
+ *  @ingroup test_module
+ *
+ *  @brief Test scenarios for @c intrusive_buffer class.
+ *
+ *  @author Cliff Green
+ *
+ *  Copyright (c) 2019 by Cliff Green
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <cstddef> // std::size_t, std::byte
+#include <cstring> // std::memcmp
+#include <utility> // std::move
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include "net_ip/intrusive_buffer.hpp"
+
+#include "utility/shared_buffer.hpp"
+#include "utility/make_byte_array.hpp"
+#include "utility/repeat.hpp"
+
+using chops::net::intrusive_buffer;
+using chops::net::refcount_mode;
+
+constexpr int NumCopies = 1000000;
+
+void intrusive_buffer_test(refcount_mode mode) {
+
+  auto ba = chops::make_byte_array(0x20, 0x21, 0x22, 0x23, 0x24);
+
+  GIVEN ("An intrusive buffer created from an array of bytes") {
+    intrusive_buffer buf(ba.data(), ba.size(), mode);
+
+    WHEN ("it is queried") {
+      THEN ("the bytes, size, mode and count are correct") {
+        REQUIRE (buf.size() == ba.size());
+        REQUIRE (std::memcmp(buf.data(), ba.data(), ba.size()) == 0);
+        REQUIRE (buf.is_atomic() == (mode == refcount_mode::atomic));
+        REQUIRE (buf.use_count() == 1u);
+        REQUIRE_FALSE (buf.empty());
+      }
+    }
+    AND_WHEN ("it is copied and moved") {
+      {
+        intrusive_buffer b2(buf);
+        REQUIRE (buf.use_count() == 2u);
+        intrusive_buffer b3(std::move(b2));
+        REQUIRE (buf.use_count() == 2u);
+        REQUIRE (b2.use_count() == 0u);
+        REQUIRE (b3.data() == buf.data());
+        intrusive_buffer b4;
+        b4 = b3;
+        REQUIRE (buf.use_count() == 3u);
+        REQUIRE (b4 == buf);
+      }
+      THEN ("the count goes back down when the copies are destroyed") {
+        REQUIRE (buf.use_count() == 1u);
+      }
+    }
+    AND_WHEN ("it is compared with a buffer with different bytes") {
+      intrusive_buffer b2(ba.data(), ba.size() - 1u, mode);
+      THEN ("they are not equal") {
+        REQUIRE (b2 != buf);
+        REQUIRE (intrusive_buffer(ba.data(), ba.size(), mode) == buf);
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Intrusive buffer test, atomic reference count", "[intrusive_buffer]" ) {
+  intrusive_buffer_test(refcount_mode::atomic);
+}
+
+SCENARIO ( "Intrusive buffer test, single thread reference count", "[intrusive_buffer]" ) {
+  intrusive_buffer_test(refcount_mode::single_thread);
+}
+
+SCENARIO ( "Intrusive buffer test, creation and conversion", "[intrusive_buffer]" ) {
+
+  auto ba = chops::make_byte_array(0x30, 0x31, 0x32);
+
+  GIVEN ("Shared buffers and a fill function") {
+    chops::const_shared_buffer sb(ba.data(), ba.size());
+    chops::mutable_shared_buffer mb(ba.data(), ba.size());
+
+    WHEN ("intrusive buffers are created from them") {
+      intrusive_buffer b1(sb);
+      intrusive_buffer b2(mb, refcount_mode::single_thread);
+      auto b3 = intrusive_buffer::make(ba.size(), [&ba] (std::byte* p, std::size_t sz) {
+          for (std::size_t i = 0u; i < sz; ++i) {
+            p[i] = ba[i];
+          }
+        }
+      );
+      intrusive_buffer b4;
+      THEN ("the bytes match and the default constructed buffer is empty") {
+        REQUIRE (b1 == b2);
+        REQUIRE (b1 == b3);
+        REQUIRE (b1.data() != sb.data());
+        REQUIRE (sizeof(b1) == sizeof(void*));
+        REQUIRE (b4.empty());
+        REQUIRE (b4.data() == nullptr);
+        REQUIRE (b4.use_count() == 0u);
+        REQUIRE (intrusive_buffer(nullptr, 0u).empty());
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Intrusive buffer test, copies in multiple threads", "[intrusive_buffer]" ) {
+
+  auto ba = chops::make_byte_array(0x40, 0x41);
+
+  GIVEN ("An intrusive buffer with an atomic reference count") {
+    intrusive_buffer buf(ba.data(), ba.size());
+
+    WHEN ("many copies are made and destroyed concurrently") {
+      std::vector<std::thread> thrs;
+      chops::repeat(4, [&thrs, &buf] {
+          thrs.emplace_back([buf] {
+              chops::repeat(NumCopies / 4, [&buf] { intrusive_buffer b(buf); } );
+            }
+          );
+        }
+      );
+      for (auto& t : thrs) {
+        t.join();
+      }
+      THEN ("the count is back to one") {
+        REQUIRE (buf.use_count() == 1u);
+      }
+    }
+  } // end given
+}
+
+SCENARIO ( "Intrusive buffer test, copy cost compared with shared buffers",
+           "[intrusive_buffer] [buffer_copy_benchmark]" ) {
+
+  using clock = std::chrono::steady_clock;
+  using ns = std::chrono::nanoseconds;
+
+  auto ba = chops::make_byte_array(0x50, 0x51, 0x52, 0x53);
+
+  GIVEN ("A shared buffer and atomic and single thread intrusive buffers") {
+    chops::const_shared_buffer sb(ba.data(), ba.size());
+    intrusive_buffer ib(ba.data(), ba.size());
+    intrusive_buffer lb(ba.data(), ba.size(), refcount_mode::single_thread);
+
+    WHEN ("each is copied and destroyed many times") {
+      auto copy_time = [] (const auto& b) {
+        std::size_t sz = 0u;
+        auto start = clock::now();
+        chops::repeat(NumCopies, [&b, &sz] { auto c = b; sz += c.size(); } );
+        auto tm = std::chrono::duration_cast<ns>(clock::now() - start).count();
+        REQUIRE (sz == NumCopies * b.size());
+        return tm;
+      };
+      auto sb_time = copy_time(sb);
+      auto ib_time = copy_time(ib);
+      auto lb_time = copy_time(lb);
+      THEN ("the times are reported") {
+        WARN ("Copy cost per buffer, shared: " << sb_time / NumCopies <<
+              " ns, intrusive atomic: " << ib_time / NumCopies <<
+              " ns, intrusive single thread: " << lb_time / NumCopies << " ns");
+        REQUIRE (ib.use_count() == 1u);
+        REQUIRE (lb.use_count() == 1u);
+      }
+    }
+  } // end given
+}
+
@@ -263,7 +263,7 @@ SCENARIO ( "Shared Net IP test utility, io_handler_mock test",
            "[shared_utility] [io_handler_mock]" ) {
   using namespace chops::test;
 
-  io_handler_mock io_mock { };
+  io_handler_mock io_mock;
 
   REQUIRE_FALSE (io_mock.mf_sio_called);
   REQUIRE_FALSE (io_mock.delim_sio_called);